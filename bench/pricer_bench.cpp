@@ -0,0 +1,451 @@
+/*
+ * SUMMARY: Google Benchmark suite for the pricing core.
+ * Covers the normal generators (Mersenne Twister against the engine's
+ * Philox streams), every path model (batch and scalar path generation,
+ * multi-asset baskets of 1-5 assets), every product's cash-flow evaluation
+ * and end-to-end priceAutocall runs over path counts from 1k to 1M and
+ * observation grids from 4 to 260 dates, with early termination off and on
+ * for the substepping models, control variates off and on, and independent,
+ * antithetic or moment-matched normals (with the resulting standard error).
+ * The Heston scheme benchmark times Euler against QE over substep sizes on a
+ * 5-year quarterly Phoenix and reports each one's bias to a fine reference.
+ * The calibration benchmarks time one COS evaluation of a 6 x 10 Heston
+ * surface over node counts and a full Heston fit of that surface.
+ * Each path benchmark reports paths_per_sec and ns_per_path counters.
+ *
+ * Machine-readable output for comparing commits:
+ *   pricer_bench --benchmark_format=json --benchmark_out=bench.json
+ *   (then e.g. tools/compare.py from Google Benchmark on two such files)
+ * Filter with --benchmark_filter=<regex>, e.g. 'BM_Simulate' or 'Heston'.
+ */
+
+#include "AirbagAutocall.hpp"
+#include "BlackScholesMC.hpp"
+#include "Calibration.hpp"
+#include "CliquetCappedCoupons.hpp"
+#include "CliquetMaxReturn.hpp"
+#include "HestonMC.hpp"
+#include "LocalVolMC.hpp"
+#include "MarketData.hpp"
+#include "MemoryPhoenixAutocall.hpp"
+#include "MonteCarloEngine.hpp"
+#include "MultiAssetMC.hpp"
+#include "NormalStream.hpp"
+#include "PhoenixAutocall.hpp"
+#include "PricerRunner.hpp"
+#include "SimdMath.hpp"
+#include "SimpleAutocall.hpp"
+#include "StepDownAutocall.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr double kSpot = 4000.0;
+
+// 'dates' observation dates evenly spread over one year.
+std::vector<double> observationGrid(std::int64_t dates) {
+    std::vector<double> times(static_cast<std::size_t>(dates));
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        times[i] = static_cast<double>(i + 1) / static_cast<double>(dates);
+    }
+    return times;
+}
+
+MarketData benchMarket() {
+    MarketData data;
+    data.setRiskFreeRate(0.02);
+    data.setQuote("SPX", MarketData::Quote{kSpot, 0.20});
+    return data;
+}
+
+std::unique_ptr<PathModelBase> makeModel(ModelType type) {
+    if (type == ModelType::Heston) {
+        return std::make_unique<HestonMC>(0.04, 1.5, 0.04, 0.5, -0.5);
+    }
+    if (type == ModelType::LocalVol) {
+        // A skewed two-expiry surface, so the grid lookup is not trivially flat.
+        return std::make_unique<LocalVolMC>(ImpliedVolSurface(
+            {0.5, 1.0}, {-0.4, -0.2, 0.0, 0.2, 0.4},
+            {0.28, 0.24, 0.20, 0.18, 0.17, 0.27, 0.235, 0.20, 0.185, 0.175}));
+    }
+    return std::make_unique<BlackScholesMC>(0.20);
+}
+
+enum class BenchProduct {
+    Simple, Phoenix, MemoryPhoenix, StepDown, Airbag, CliquetMax, CliquetCapped
+};
+
+std::unique_ptr<StructuredProduct> makeProduct(BenchProduct type,
+                                               const std::vector<double>& times) {
+    switch (type) {
+    case BenchProduct::Simple:
+        return std::make_unique<SimpleAutocall>("SPX", times, kSpot, 1000.0, 0.05,
+                                                4100.0, 3200.0);
+    case BenchProduct::Phoenix:
+        return std::make_unique<PhoenixAutocall>("SPX", times, kSpot, 1000.0, 0.05,
+                                                 4100.0, 3200.0, 3800.0);
+    case BenchProduct::MemoryPhoenix:
+        return std::make_unique<MemoryPhoenixAutocall>("SPX", times, kSpot, 1000.0,
+                                                       0.05, 4100.0, 3200.0, 3800.0);
+    case BenchProduct::StepDown: {
+        std::vector<double> barriers(times.size());
+        for (std::size_t i = 0; i < barriers.size(); ++i) {
+            barriers[i] = 4100.0 - 300.0 * times[i];
+        }
+        return std::make_unique<StepDownAutocall>("SPX", times, kSpot, 1000.0, 0.05,
+                                                  barriers, 3200.0);
+    }
+    case BenchProduct::Airbag:
+        return std::make_unique<AirbagAutocall>("SPX", times, kSpot, 1000.0, 0.05,
+                                                4100.0, 3200.0, 0.7);
+    case BenchProduct::CliquetMax:
+        return std::make_unique<CliquetMaxReturn>("SPX", times, kSpot, 1000.0);
+    case BenchProduct::CliquetCapped:
+        return std::make_unique<CliquetCappedCoupons>("SPX", times, kSpot, 1000.0,
+                                                      1.0, 0.05);
+    }
+    return nullptr;
+}
+
+// Throughput counters shared by every benchmark.
+void reportPaths(benchmark::State& state, double pathsPerIteration) {
+    state.counters["paths_per_sec"] = benchmark::Counter(
+        pathsPerIteration, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["ns_per_path"] = benchmark::Counter(
+        pathsPerIteration * 1e-9,
+        benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+// --- Random numbers ----------------------------------------------------------
+
+// One block's worth of normals per iteration. Arg: count.
+void BM_FillNormalsMersenne(benchmark::State& state) {
+    std::vector<double> z(static_cast<std::size_t>(state.range(0)));
+    std::mt19937 rng = makeBlockRng(1337, 0);
+    for (auto _ : state) {
+        fillStandardNormals(rng, z.data(), z.size());
+        benchmark::DoNotOptimize(z.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_FillNormalsPhilox(benchmark::State& state) {
+    std::vector<double> z(static_cast<std::size_t>(state.range(0)));
+    const PhiloxStream stream = makeBlockStream(1337, 0);
+    std::uint64_t position = 0;
+    for (auto _ : state) {
+        fillPhiloxNormals(stream, position, z.data(), z.size());
+        position += z.size();
+        benchmark::DoNotOptimize(z.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// --- Path models -------------------------------------------------------------
+
+// One engine block of paths through the batch (SIMD) kernel. Arg: dates.
+void BM_SimulatePaths(benchmark::State& state, ModelType type) {
+    const auto model = makeModel(type);
+    const auto times = observationGrid(state.range(0));
+    const MarketData data = benchMarket();
+    PathBatch batch;
+    for (auto _ : state) {
+        PhiloxNormals normals(makeBlockStream(1337, 0));
+        model->simulatePaths(kSpot, times, data, normals, kPathsPerBlock, batch);
+        benchmark::DoNotOptimize(batch.date(0));
+    }
+    reportPaths(state, static_cast<double>(kPathsPerBlock));
+}
+
+// The scalar reference path generator, one path per iteration. Arg: dates.
+void BM_SimulatePath(benchmark::State& state, ModelType type) {
+    const auto model = makeModel(type);
+    const auto times = observationGrid(state.range(0));
+    const MarketData data = benchMarket();
+    std::mt19937 rng(1337);
+    for (auto _ : state) {
+        auto path = model->simulatePath(kSpot, times, data, rng);
+        benchmark::DoNotOptimize(path.data());
+    }
+    reportPaths(state, 1.0);
+}
+
+// Worst-of basket block on 12 dates; the cost should grow about linearly with
+// the asset count. Arg: assets.
+void BM_SimulateBasket(benchmark::State& state) {
+    const std::size_t assets = static_cast<std::size_t>(state.range(0));
+    std::vector<BasketAsset> basket;
+    for (std::size_t a = 0; a < assets; ++a) basket.push_back({"A" + std::to_string(a), 0.20});
+    std::vector<double> correlation(assets * assets, 0.6);
+    for (std::size_t a = 0; a < assets; ++a) correlation[a * assets + a] = 1.0;
+    const MultiAssetMC model(std::move(basket), correlation, BasketType::WorstOf);
+    const auto times = observationGrid(12);
+    const MarketData data = benchMarket();
+    PathBatch batch;
+    for (auto _ : state) {
+        PhiloxNormals normals(makeBlockStream(1337, 0));
+        model.simulatePaths(kSpot, times, data, normals, kPathsPerBlock, batch);
+        benchmark::DoNotOptimize(batch.date(0));
+    }
+    reportPaths(state, static_cast<double>(kPathsPerBlock));
+}
+
+// --- Products ----------------------------------------------------------------
+
+// Cash flows of one block of pre-simulated Black-Scholes paths. Arg: dates.
+void BM_CashFlows(benchmark::State& state, BenchProduct type) {
+    const auto times = observationGrid(state.range(0));
+    const auto product = makeProduct(type, times);
+    const MarketData data = benchMarket();
+    const BlackScholesMC model(0.20);
+    PhiloxNormals normals(makeBlockStream(1337, 0));
+    PathBatch batch;
+    model.simulatePaths(kSpot, times, data, normals, kPathsPerBlock, batch);
+
+    std::vector<std::vector<double>> paths(kPathsPerBlock);
+    for (std::size_t p = 0; p < kPathsPerBlock; ++p) {
+        batch.copyPath(p, paths[p]);
+    }
+    std::vector<CashFlow> flows;
+    for (auto _ : state) {
+        for (const auto& path : paths) {
+            product->fillCashFlows(path, flows);
+            benchmark::DoNotOptimize(flows.data());
+        }
+    }
+    reportPaths(state, static_cast<double>(kPathsPerBlock));
+}
+
+// --- End to end --------------------------------------------------------------
+
+// priceAutocall on a Phoenix (price, delta, gamma, vega). Args: paths, dates.
+void BM_PriceAutocall(benchmark::State& state, ModelType type) {
+    PricingInputs inputs;
+    inputs.autocallType = AutocallType::Phoenix;
+    inputs.modelType = type;
+    inputs.paths = static_cast<std::size_t>(state.range(0));
+    inputs.observationTimes = observationGrid(state.range(1));
+    for (auto _ : state) {
+        const PricingResults results = priceAutocall(inputs);
+        benchmark::DoNotOptimize(results.price);
+    }
+    reportPaths(state, static_cast<double>(inputs.paths));
+}
+
+// Same Phoenix with early termination off (0) or on (1). Args: paths, dates, flag.
+void BM_PriceAutocallEarlyTermination(benchmark::State& state, ModelType type) {
+    PricingInputs inputs;
+    inputs.autocallType = AutocallType::Phoenix;
+    inputs.modelType = type;
+    inputs.paths = static_cast<std::size_t>(state.range(0));
+    inputs.observationTimes = observationGrid(state.range(1));
+    inputs.earlyTermination = state.range(2) != 0;
+    for (auto _ : state) {
+        const PricingResults results = priceAutocall(inputs);
+        benchmark::DoNotOptimize(results.price);
+    }
+    reportPaths(state, static_cast<double>(inputs.paths));
+}
+
+// Same Phoenix with control variates off (0) or on (1). Args: paths, flag.
+// Reports the price's standard error too: the cost of a target error scales
+// with time * std_error^2.
+void BM_PriceAutocallControlVariates(benchmark::State& state, ModelType type) {
+    PricingInputs inputs;
+    inputs.autocallType = AutocallType::Phoenix;
+    inputs.modelType = type;
+    inputs.paths = static_cast<std::size_t>(state.range(0));
+    inputs.controlVariates = state.range(1) != 0;
+    double stdError = 0.0;
+    for (auto _ : state) {
+        const PricingResults results = priceAutocall(inputs);
+        benchmark::DoNotOptimize(results.price);
+        stdError = results.stdError;
+    }
+    reportPaths(state, static_cast<double>(inputs.paths));
+    state.counters["std_error"] = stdError;
+}
+
+// Same Phoenix with independent (0), antithetic (1) or moment-matched (2)
+// normals. Args: paths, scheme. Reports the standard error like the above.
+void BM_PriceAutocallNormalScheme(benchmark::State& state, ModelType type) {
+    PricingInputs inputs;
+    inputs.autocallType = AutocallType::Phoenix;
+    inputs.modelType = type;
+    inputs.paths = static_cast<std::size_t>(state.range(0));
+    inputs.normalScheme = static_cast<NormalScheme>(state.range(1));
+    double stdError = 0.0;
+    for (auto _ : state) {
+        const PricingResults results = priceAutocall(inputs);
+        benchmark::DoNotOptimize(results.price);
+        stdError = results.stdError;
+    }
+    reportPaths(state, static_cast<double>(inputs.paths));
+    state.counters["std_error"] = stdError;
+}
+
+// A 5-year quarterly Phoenix under Heston, as the Heston scheme benchmark
+// prices it with 'steps' substeps per year.
+PricingInputs hestonSchemeInputs(HestonScheme scheme, std::int64_t steps) {
+    PricingInputs inputs;
+    inputs.autocallType = AutocallType::Phoenix;
+    inputs.modelType = ModelType::Heston;
+    inputs.paths = 100000;
+    inputs.observationTimes.clear();
+    for (int quarter = 1; quarter <= 20; ++quarter) {
+        inputs.observationTimes.push_back(0.25 * quarter);
+    }
+    inputs.hestonScheme = scheme;
+    inputs.hestonMaxStep = 1.0 / static_cast<double>(steps);
+    return inputs;
+}
+
+// Reference price of hestonSchemeInputs(): QE at 200 substeps a year on 4x
+// the paths (half the std error) and another seed, computed once.
+double hestonReferencePrice() {
+    static const double price = [] {
+        PricingInputs inputs = hestonSchemeInputs(HestonScheme::QuadraticExponential, 200);
+        inputs.paths *= 4;
+        inputs.seed += 1;
+        return priceAutocall(inputs).price;
+    }();
+    return price;
+}
+
+// Convergence of the Heston schemes in the substep: Euler (0) or QE (1) at
+// 'steps' substeps per year. Args: scheme, steps. Reports the price, its
+// standard error and its bias against the fine reference; a bias within about
+// twice the std error is noise (the reference's included), so the cheapest
+// step per scheme whose bias stays that small can be read off.
+void BM_HestonSchemeConvergence(benchmark::State& state) {
+    const PricingInputs inputs =
+        hestonSchemeInputs(static_cast<HestonScheme>(state.range(0)), state.range(1));
+    const double reference = hestonReferencePrice();
+    PricingResults results;
+    for (auto _ : state) {
+        results = priceAutocall(inputs);
+        benchmark::DoNotOptimize(results.price);
+    }
+    reportPaths(state, static_cast<double>(inputs.paths));
+    state.counters["price"] = results.price;
+    state.counters["std_error"] = results.stdError;
+    state.counters["bias"] = results.price - reference;
+}
+
+// Synthetic market for the calibration benchmarks: the implied vols of a
+// skewed Heston model on 6 expiries (3 months to 5 years) x 10 strikes.
+const std::vector<double> kCalibrationExpiries{0.25, 0.5, 1.0, 2.0, 3.0, 5.0};
+const std::vector<double> kCalibrationMoneyness{-0.5, -0.4, -0.3, -0.2, -0.1,
+                                                0.0,  0.1,  0.2,  0.3,  0.4};
+const HestonParameters kCalibrationTruth{0.03, 2.0, 0.05, 0.6, -0.7};
+
+const ImpliedVolSurface& calibrationSurface() {
+    static const ImpliedVolSurface surface(
+        kCalibrationExpiries, kCalibrationMoneyness,
+        hestonImpliedVols(kCalibrationTruth, kCalibrationExpiries, kCalibrationMoneyness));
+    return surface;
+}
+
+// One evaluation of the surface's prices, i.e. the cost of a residual of the
+// fit. Arg: cosine terms per expiry.
+void BM_HestonFourierPrices(benchmark::State& state) {
+    const HestonFourierPricer pricer(kCalibrationExpiries, kCalibrationMoneyness, 1.0,
+                                     static_cast<std::size_t>(state.range(0)));
+    std::vector<double> prices;
+    for (auto _ : state) {
+        pricer.callPrices(kCalibrationTruth, prices);
+        benchmark::DoNotOptimize(prices.data());
+    }
+    state.counters["quotes_per_sec"] = benchmark::Counter(
+        static_cast<double>(prices.size()) * static_cast<double>(state.iterations()),
+        benchmark::Counter::kIsRate);
+}
+
+// Full Heston fit of the synthetic surface from the default guess. Reports
+// the residual vol error in basis points and the Levenberg-Marquardt iterations.
+void BM_CalibrateHeston(benchmark::State& state) {
+    const ImpliedVolSurface& surface = calibrationSurface();
+    HestonCalibration fit;
+    for (auto _ : state) {
+        fit = calibrateHeston(surface);
+        benchmark::DoNotOptimize(fit);
+    }
+    state.counters["rms_vol_error_bp"] = fit.rmsVolError * 1e4;
+    state.counters["lm_iterations"] = static_cast<double>(fit.iterations);
+}
+
+void gridArgs(benchmark::internal::Benchmark* bench) {
+    for (std::int64_t dates : {4, 12, 52, 260}) bench->Arg(dates);
+}
+} // namespace
+
+BENCHMARK(BM_FillNormalsMersenne)->Arg(1024)->Arg(2048);
+BENCHMARK(BM_FillNormalsPhilox)->Arg(1024)->Arg(2048);
+
+BENCHMARK_CAPTURE(BM_SimulatePaths, BlackScholes, ModelType::BlackScholes)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_SimulatePaths, Heston, ModelType::Heston)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_SimulatePaths, LocalVol, ModelType::LocalVol)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_SimulatePath, BlackScholes, ModelType::BlackScholes)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_SimulatePath, Heston, ModelType::Heston)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_SimulatePath, LocalVol, ModelType::LocalVol)->Apply(gridArgs);
+BENCHMARK(BM_SimulateBasket)->DenseRange(1, 5);
+
+BENCHMARK_CAPTURE(BM_CashFlows, Simple, BenchProduct::Simple)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_CashFlows, Phoenix, BenchProduct::Phoenix)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_CashFlows, MemoryPhoenix, BenchProduct::MemoryPhoenix)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_CashFlows, StepDown, BenchProduct::StepDown)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_CashFlows, Airbag, BenchProduct::Airbag)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_CashFlows, CliquetMaxReturn, BenchProduct::CliquetMax)->Apply(gridArgs);
+BENCHMARK_CAPTURE(BM_CashFlows, CliquetCappedCoupons, BenchProduct::CliquetCapped)
+    ->Apply(gridArgs);
+
+// Black-Scholes covers the whole 1k-1M x 4-260 grid. Heston stops at 100k
+// paths: its 0.01y substeps make the 1M runs take minutes on small machines.
+BENCHMARK_CAPTURE(BM_PriceAutocall, BlackScholes, ModelType::BlackScholes)
+    ->ArgsProduct({{1000, 10000, 100000, 1000000}, {4, 12, 52, 260}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PriceAutocall, Heston, ModelType::Heston)
+    ->ArgsProduct({{1000, 10000, 100000}, {4, 12, 52, 260}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PriceAutocallEarlyTermination, Heston, ModelType::Heston)
+    ->ArgsProduct({{10000, 100000}, {4, 12}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PriceAutocallEarlyTermination, LocalVol, ModelType::LocalVol)
+    ->ArgsProduct({{10000, 100000}, {4, 12}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PriceAutocallControlVariates, BlackScholes, ModelType::BlackScholes)
+    ->ArgsProduct({{10000, 100000}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PriceAutocallControlVariates, Heston, ModelType::Heston)
+    ->ArgsProduct({{10000, 100000}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PriceAutocallNormalScheme, BlackScholes, ModelType::BlackScholes)
+    ->ArgsProduct({{10000, 100000}, {0, 1, 2}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PriceAutocallNormalScheme, Heston, ModelType::Heston)
+    ->ArgsProduct({{10000, 100000}, {0, 1, 2}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_HestonSchemeConvergence)
+    ->ArgsProduct({{0, 1}, {4, 12, 26, 52, 100}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(BM_HestonFourierPrices)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_CalibrateHeston)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
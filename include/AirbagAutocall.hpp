@@ -32,9 +32,10 @@ public:
    * @brief Calculates the stream of cash flows for a given path.
    *
    * @param path Simulated price path of the underlying.
-   * @return std::vector<CashFlow> List of cash flows (amount and time).
+   * @param sink Receives each flow with the index of its payment date.
    */
-  std::vector<CashFlow> cashFlows(const std::vector<double> &path) const override;
+  void emitCashFlows(const std::vector<double> &path,
+                     CashFlowSink &sink) const override;
 
 private:
   /**
@@ -20,7 +20,7 @@ public:
     virtual ~AutocallBase() = default;
 
     // Getters pour les classes dérivées (car les membres sont privés)
-    double notional() const { return notional_; }
+    double notional() const override { return notional_; }
     double couponRate() const { return couponRate_; }
     double callBarrier() const { return callBarrier_; }
     double protectionBarrier() const { return protectionBarrier_; }
@@ -29,7 +29,23 @@ public:
     // Helper pour accéder aux dates d'observation plus facilement
     const std::vector<double>& times() const { return observationTimes(); }
 
+    // Every autocall stops at the first date whose spot reaches the call barrier.
+    bool canTerminateEarly() const override { return true; }
+    bool isTerminated(std::size_t dateIndex, double spot) const override {
+        return spot >= callBarrierAt(dateIndex);
+    }
+
+    double callLevel(std::size_t dateIndex) const override { return callBarrierAt(dateIndex); }
+    double capitalBarrier() const override { return protectionBarrier_; }
+    double capitalStrike() const override { return spot0_; }
+
 protected:
+    // Call barrier of observation date i (constant unless overridden).
+    virtual double callBarrierAt(std::size_t i) const {
+        (void)i;
+        return callBarrier_;
+    }
+
     /**
      * @brief Calculates the terminal redemption amount at maturity.
      * Logic: If FinalSpot >= ProtectionBarrier -> Pay Notional
@@ -6,17 +6,22 @@
  * @brief Black-Scholes Monte Carlo Path Generator.
  *
  * This class implements a path generator based on the Black-Scholes-Merton model.
- * It assumes the underlying asset follows a Geometric Brownian Motion (GBM)
- * with constant volatility and a constant risk-free rate.
+ * It assumes the underlying asset follows a Geometric Brownian Motion (GBM).
+ * Rates, dividends and (when the market has a vol curve for the underlying)
+ * volatility may be time-dependent; they are read per observation interval
+ * from MarketData::forwardGrid().
  */
 class BlackScholesMC : public PathModelBase {
 public:
     /**
      * @brief Constructor.
      *
-     * @param sigma The constant volatility of the underlying asset (e.g., 0.20 for 20%).
+     * @param sigma The constant volatility of the underlying asset (e.g., 0.20 for 20%),
+     *        used unless the market holds a vol curve for 'underlying'.
+     * @param underlying Name whose dividend and vol curves the simulation reads;
+     *        empty for the rate curve alone.
      */
-    explicit BlackScholesMC(double sigma);
+    explicit BlackScholesMC(double sigma, std::string underlying = {});
 
     /**
      * @brief Simulates a single price path using Geometric Brownian Motion.
@@ -30,7 +35,7 @@ public:
      *
      * @param spot0 The initial spot price of the underlying.
      * @param times A vector of time points (in years) where the spot price is observed.
-     * @param data Market data providing the risk-free rate (r).
+     * @param data Market data providing the rate, dividend and vol curves.
      * @param rng The random number generator (Mersenne Twister) used to generate Z.
      * @return std::vector<double> The simulated spot prices at each requested time in 'times'.
      */
@@ -39,6 +44,80 @@ public:
                                      const MarketData& data,
                                      std::mt19937& rng) const override;
 
+    /**
+     * @brief One Brownian factor, stepped on every observation date that moves
+     * the clock (dates with dt <= 1e-8 draw nothing).
+     */
+    BrownianGrid brownianGrid(const std::vector<double>& times) const override;
+
+    /**
+     * @brief Simulates a whole block of paths into a caller-owned SoA batch.
+     *
+     * Same dynamics as simulatePath(), but all paths are advanced together one
+     * date at a time: the drift and sigma*sqrt(dt) terms are computed once per
+     * date, one vector of normals is pulled from the stream per moving date,
+     * and the exponential update runs in AVX2/AVX-512 lanes when the CPU has
+     * them.
+     */
+    void simulatePaths(double spot0,
+                       const std::vector<double>& times,
+                       const MarketData& data,
+                       NormalStream& normals,
+                       std::size_t paths,
+                       PathBatch& batch) const override;
+    using PathModelBase::simulatePaths;
+
+    std::string cacheKey() const override;
+
+    // GBM: every spot is spot0 times a spot-independent factor.
+    bool isSpotHomogeneous() const override { return true; }
+
+    bool supportsPathSensitivities() const override { return true; }
+
+    /**
+     * @brief Forward and log variance of every date: the discretized paths are
+     * exactly lognormal, so Black-Scholes formulas price functionals of them.
+     */
+    SpotMarginals marginals(const std::vector<double>& times,
+                            const MarketData& data) const override;
+
+    /**
+     * @brief simulatePaths() plus the closed-form GBM sensitivities.
+     *
+     * With Z_1 the normal of the first moving step, dt_1 its length and
+     * sigma_j the (forward) vol of step j:
+     * deltaScore = Z_1 / (spot0 sigma_1 sqrt(dt_1)),
+     * gammaScore = (Z_1^2 - 1 - Z_1 sigma_1 sqrt(dt_1)) / (spot0^2 sigma_1^2 dt_1),
+     * vegaScore = sum_j k_j ((Z_j^2 - 1) / sigma_j - Z_j sqrt(dt_j)) and
+     * dS(t)/dsigma = S(t) sum_{t_j <= t} k_j (Z_j sqrt(dt_j) - sigma_j dt_j).
+     * Vega is a parallel shift of the implied vols, as in bump-and-revalue
+     * (TermCurve::shifted() on the vol curve): with I the integral of the vol
+     * curve, k_j = d sigma_j / d shift = (I(t_j) - I(t_j-1)) / (sigma_j dt_j),
+     * which is 1 for a flat vol and differs from it on a sloped curve.
+     */
+    void simulatePathsWithSensitivities(double spot0,
+                                        const std::vector<double>& times,
+                                        const MarketData& data,
+                                        NormalStream& normals,
+                                        std::size_t paths,
+                                        PathBatch& batch,
+                                        PathSensitivities& sensitivities) const override;
+
 private:
+    // Batch kernel behind both simulatePaths() overrides; 'sensitivities' may be null.
+    void simulateBatch(double spot0, const std::vector<double>& times,
+                       const MarketData& data, NormalStream& normalStream,
+                       std::size_t paths, PathBatch& batch,
+                       PathSensitivities* sensitivities) const;
+
+    // Writes one path to out[0], out[stride], out[2 * stride], ...
+    void simulateInto(double spot0, const MarketData::ForwardGrid& forward,
+                      std::mt19937& rng, double* out, std::size_t stride) const;
+
+    // Log drift and volatility of observation interval d, of length dt > 0.
+    void stepParameters(const MarketData::ForwardGrid& forward, std::size_t d,
+                        double dt, double& drift, double& vol) const;
+
     double sigma_; // stored constant volatility
+    std::string underlying_;
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+// Semi-analytic calibration of the Heston and Black-Scholes models to an implied vol surface.
+#pragma once
+
+#include "VolSurface.hpp"
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief The five Heston parameters (see HestonMC).
+ */
+struct HestonParameters {
+    double v0{0.04};
+    double kappa{1.5};
+    double theta{0.04};
+    double xi{0.5};
+    double rho{-0.5};
+};
+
+/**
+ * @brief Heston vanilla prices on a fixed grid of expiries and strikes (COS method).
+ *
+ * Prices are forward-normalized and undiscounted, c(T, k) = E[(S_T / F(T) -
+ * e^k)+] with k = ln(K / F), which under deterministic rates and dividends
+ * depends on the five model parameters alone. Each expiry expands the put
+ * payoff in a cosine series on a fixed log-return interval; the interval,
+ * the frequencies and the payoff coefficients of every (expiry, frequency,
+ * strike) only depend on the grid and are built once. A price evaluation is
+ * then one characteristic-function value per (expiry, frequency) and one
+ * multiply-add per (expiry, frequency, strike), over contiguous strikes.
+ */
+class HestonFourierPricer {
+public:
+    /**
+     * @param expiries Positive expiries (years).
+     * @param logMoneyness Strikes k = ln(K / F), shared by every expiry.
+     * @param maxVol Largest vol the prices should resolve; sets the width of
+     *        the truncation interval (12 standard deviations).
+     * @param nodes Cosine terms per expiry.
+     * @throws std::invalid_argument on an empty grid, a non-positive expiry,
+     *         maxVol or node count.
+     */
+    HestonFourierPricer(std::vector<double> expiries, std::vector<double> logMoneyness,
+                        double maxVol, std::size_t nodes = 1024);
+
+    const std::vector<double>& expiries() const { return expiries_; }
+    const std::vector<double>& logMoneyness() const { return strikes_; }
+
+    // Call prices c(T, k), row-major [expiry][strike], into 'prices'.
+    void callPrices(const HestonParameters& parameters, std::vector<double>& prices) const;
+
+private:
+    std::vector<double> expiries_;
+    std::vector<double> strikes_;
+    std::size_t nodes_;
+    std::vector<double> frequencies_; // [expiry][node]: u_j = j pi / (b - a).
+    std::vector<double> cosShift_;    // [expiry][node]: cos(u_j a).
+    std::vector<double> sinShift_;    // [expiry][node]: sin(u_j a).
+    std::vector<double> payoff_;      // [expiry][node][strike]: put coefficients.
+};
+
+/**
+ * @brief Outcome of calibrateHeston().
+ *
+ * rmsVolError is the root mean square of the price errors divided by the
+ * Black-Scholes vegas of the quotes, i.e. of the implied vol errors to first
+ * order.
+ */
+struct HestonCalibration {
+    HestonParameters parameters;
+    double rmsVolError{};
+    std::size_t iterations{};
+};
+
+/**
+ * @brief Fits the Heston parameters to every vol of 'surface's grid.
+ *
+ * Levenberg-Marquardt on vega-scaled price errors, starting from 'guess',
+ * with v0, kappa, theta and xi kept positive and rho inside (-1, 1) by a
+ * change of variables. Prices come from one HestonFourierPricer built for
+ * the whole fit.
+ *
+ * @throws std::invalid_argument if 'guess' is outside the parameter domain.
+ */
+HestonCalibration calibrateHeston(const ImpliedVolSurface& surface,
+                                  const HestonParameters& guess = {});
+
+/**
+ * @brief The flat Black-Scholes vol closest to 'surface's grid, in the same
+ * vega-scaled price errors as calibrateHeston().
+ */
+double calibrateBlackScholesVol(const ImpliedVolSurface& surface);
+
+/**
+ * @brief Implied vols of the Heston prices on an (expiry x log-moneyness)
+ * grid, row-major like ImpliedVolSurface::vols(). Useful to build test
+ * surfaces and to compare a fit with its market.
+ */
+std::vector<double> hestonImpliedVols(const HestonParameters& parameters,
+                                      const std::vector<double>& expiries,
+                                      const std::vector<double>& logMoneyness);
@@ -7,7 +7,7 @@
  * @brief Base class for Cliquet-style products.
  *
  * Implements the "Template Method" pattern:
- * - cashFlows() handles the timing (payment at maturity).
+ * - emitCashFlows() handles the timing (payment at maturity).
  * - payoffImpl() (virtual) handles the specific math (MaxReturn, Capped, etc.).
  */
 class CliquetBase : public StructuredProduct {
@@ -17,12 +17,16 @@ public:
 
   virtual ~CliquetBase() = default;
 
-  // Adaptation : On renvoie un vecteur contenant 1 seul flux (le payoff final)
-  std::vector<CashFlow> cashFlows(const std::vector<double> &path) const override;
+  // Adaptation : un seul flux (le payoff final), payé à maturité
+  void emitCashFlows(const std::vector<double> &path,
+                     CashFlowSink &sink) const override;
+
+  // Floors and caps on returns keep every cliquet payoff continuous.
+  bool hasContinuousPayoff() const override { return true; }
 
   // Getters (utiles pour les classes dérivées comme MaxReturn ou CappedCoupons)
   double spot0() const { return spot0_; }
-  double notional() const { return notional_; }
+  double notional() const override { return notional_; }
 
 protected:
   // Helper pour accéder aux dates
@@ -10,6 +10,6 @@ public:
                      double notional);
 
 protected:
-    // On implémente la logique spécifique ici, appelée par CliquetBase::cashFlows
+    // On implémente la logique spécifique ici, appelée par CliquetBase::emitCashFlows
     double payoffImpl(const std::vector<double>& path) const override;
 };
\ No newline at end of file
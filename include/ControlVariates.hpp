@@ -0,0 +1,104 @@
+// Analytic control variates for the Monte Carlo price of a structured product.
+#pragma once
+
+#include "MarketData.hpp"
+#include "PathModel.hpp"
+#include "StructuredProduct.hpp"
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief A discounted functional of the observation path with a known mean.
+ *
+ * Forward: the spot at 'dateIndex'. Digital: 1 when that spot is at or above
+ * 'strike'. KnockInPut: (strike - S)+ when S ends below 'barrier', i.e. the
+ * capital-at-risk leg of an autocall. Each value is multiplied by 'discount',
+ * and 'mean' is its expectation under the model (see makeControlVariates).
+ */
+struct ControlVariate {
+    enum class Kind { Forward, Digital, KnockInPut };
+
+    Kind kind;
+    std::size_t dateIndex;
+    double strike;
+    double barrier;
+    double discount;
+    double mean;
+
+    double value(const std::vector<double>& path) const {
+        const double spot = path[dateIndex];
+        switch (kind) {
+        case Kind::Forward:
+            return discount * spot;
+        case Kind::Digital:
+            return spot >= strike ? discount : 0.0;
+        case Kind::KnockInPut:
+            return spot < barrier && spot < strike ? discount * (strike - spot) : 0.0;
+        }
+        return 0.0;
+    }
+};
+
+/**
+ * @brief Control variates of 'product' under 'model', priced in closed form.
+ *
+ * The discounted terminal forward whenever the model knows its forward
+ * (SpotMarginals::forward). When ln S is Gaussian (Black-Scholes) also the
+ * digitals at the call level of up to eight observation dates spread over
+ * the schedule, and the down-and-in put at the capital barrier observed at
+ * maturity, both with their Black-Scholes prices. Empty when the model knows
+ * nothing in closed form or the product has no observation dates.
+ */
+std::vector<ControlVariate> makeControlVariates(const StructuredProduct& product,
+                                                const PathModelBase& model,
+                                                const MarketData& data,
+                                                double spot0);
+
+/**
+ * @brief Means and centred co-moments of a payoff Y and its controls X.
+ *
+ * The multivariate form of RunningStats: add() is Welford's update and
+ * merge() Chan's pairwise combination, so per-block moments merged in a
+ * fixed order give reproducible results without the cancellation of raw
+ * sums of squares. The regression coefficients are fitted on the same paths
+ * they adjust (the usual "same-sample" control variate estimator, whose
+ * O(1/n) bias is far below the statistical error).
+ */
+class ControlMoments {
+public:
+    explicit ControlMoments(std::size_t controls = 0);
+
+    void add(double y, const double* x);
+    void merge(const ControlMoments& other);
+
+    double count() const { return count_; }
+
+    /**
+     * @brief Coefficients minimizing the variance of Y - beta . X.
+     *
+     * Controls that carry no information of their own on these paths (zero
+     * variance, or a combination of the others) get a zero coefficient.
+     */
+    std::vector<double> beta() const;
+
+    // Mean of Y - beta . (X - controls[j].mean) over the paths.
+    double adjustedMean(const std::vector<double>& beta,
+                        const std::vector<ControlVariate>& controls) const;
+
+    // Sum of Y - beta . X over the paths.
+    double residualSum(const std::vector<double>& beta) const;
+
+    // Sample variance of Y - beta . X, with one degree of freedom per control.
+    double residualVariance(const std::vector<double>& beta) const;
+
+private:
+    std::size_t controls_;
+    double count_{0.0};
+    double meanY_{0.0};
+    double m2Y_{0.0};
+    std::vector<double> meanX_;
+    std::vector<double> comXY_; // sum (x_i - mean x_i)(y - mean y)
+    std::vector<double> comXX_; // Lower triangle, row-major controls x controls.
+    std::vector<double> deltaX_; // Scratch of add().
+};
@@ -2,6 +2,18 @@
 
 #include "PathModel.hpp"
 
+/**
+ * @brief Time discretization of the Heston variance (and log-spot) process.
+ *
+ * Euler: full-truncation Euler, which needs small steps (0.01y by default)
+ * to keep its bias down. QuadraticExponential: Andersen's QE scheme with the
+ * martingale correction, accurate at steps of a month to a quarter.
+ */
+enum class HestonScheme { Euler, QuadraticExponential };
+
+// Default largest substep of HestonMC, in years.
+constexpr double kHestonDefaultMaxStep = 0.01;
+
 /**
  * @brief Heston Monte Carlo Model implementation.
  *
@@ -17,17 +29,28 @@ public:
      * @param theta Long-term mean variance.
      * @param xi Volatility of volatility (vol-of-vol).
      * @param rho Correlation between spot and variance Brownian motions.
+     * @param underlying Name whose dividend curve sets the drift with the rate
+     *        curve; empty for the rate curve alone. Market vol curves do not
+     *        apply: the variance is the model's own process.
+     * @param scheme Discretization of each substep.
+     * @param maxStep Largest substep in years; each observation interval is
+     *        split into the fewest equal substeps no longer than this.
+     * @throws std::invalid_argument if maxStep is not positive, or the QE
+     *         scheme is asked for with xi <= 0.
      */
-    HestonMC(double v0, double kappa, double theta, double xi, double rho);
+    HestonMC(double v0, double kappa, double theta, double xi, double rho,
+             std::string underlying = {},
+             HestonScheme scheme = HestonScheme::Euler,
+             double maxStep = kHestonDefaultMaxStep);
 
     /**
      * @brief Simulates a path using the Heston model.
      *
-     * Uses an Euler-Maruyama discretization (or similar scheme) for the coupled SDEs.
+     * Steps the coupled SDEs with the model's scheme on its substep grid.
      *
      * @param spot0 Initial spot price.
      * @param times Observation times required by the product.
-     * @param data Market data (risk-free rate, etc.).
+     * @param data Market data (rate and dividend curves).
      * @param rng Random number generator.
      * @return std::vector<double> The simulated path of the underlying asset.
      */
@@ -36,10 +59,73 @@ public:
                                      const MarketData& data,
                                      std::mt19937& rng) const override;
 
+    /**
+     * @brief Two Brownian factors (spot, then independent variance noise),
+     * stepped on the internal substep grid.
+     */
+    BrownianGrid brownianGrid(const std::vector<double>& times) const override;
+
+    /**
+     * @brief Simulates a whole block of paths into a caller-owned SoA batch.
+     *
+     * Same scheme and substep grid as simulatePath(), but the grid and its
+     * constants are built once per observation schedule and all paths of the
+     * block advance together in vector lanes. Normals
+     * are pulled from the stream in substep-major order, so the paths match
+     * the scalar version statistically, not draw for draw.
+     */
+    void simulatePaths(double spot0,
+                       const std::vector<double>& times,
+                       const MarketData& data,
+                       NormalStream& normals,
+                       std::size_t paths,
+                       PathBatch& batch) const override;
+    using PathModelBase::simulatePaths;
+
+    /**
+     * @brief simulatePaths() that drops terminated paths from the vector lanes.
+     *
+     * After each observation date the surviving paths are compacted to the
+     * front of the lanes, so the substeps only run for paths the
+     * product still reads, and their normals come from NormalStream::nextLive()
+     * so terminated paths draw nothing either.
+     */
+    void simulatePathsUntilTerminated(double spot0,
+                                      const std::vector<double>& times,
+                                      const MarketData& data,
+                                      NormalStream& normals,
+                                      std::size_t paths,
+                                      PathBatch& batch,
+                                      const PathTermination& termination) const override;
+
+    std::string cacheKey() const override;
+
+    // Forward only: each log-spot step is a martingale given the variance
+    // (exactly for Euler, through the martingale correction for QE).
+    SpotMarginals marginals(const std::vector<double>& times,
+                            const MarketData& data) const override;
+
+    // The log-spot update and the variance never depend on the spot level.
+    bool isSpotHomogeneous() const override { return true; }
+
 private:
+    // Batch kernel behind both entry points; 'termination' may be null.
+    void simulateBlock(double spot0, const std::vector<double>& times,
+                       const MarketData& data, NormalStream& normals,
+                       std::size_t paths, PathBatch& batch,
+                       const PathTermination* termination) const;
+
+    // Writes one path to out[0], out[stride], out[2 * stride], ...
+    void simulateInto(double spot0, const MarketData::ForwardGrid& forward,
+                      std::mt19937& rng, double* out, std::size_t stride) const;
+
+
     double v0_;    // Initial variance
     double kappa_; // Mean reversion speed
     double theta_; // Long-term variance
     double xi_;    // Vol of vol
     double rho_;   // Correlation between spot and vol
+    std::string underlying_;
+    HestonScheme scheme_;
+    double maxStep_; // Largest substep (years)
 };
\ No newline at end of file
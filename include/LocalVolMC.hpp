@@ -0,0 +1,113 @@
+#pragma once
+
+#include "PathModel.hpp"
+#include "VolSurface.hpp"
+
+#include <memory>
+
+/**
+ * @brief Dupire local vols sampled on a dense uniform (time, log-moneyness) grid.
+ *
+ * Row a holds sigma_L(a * timeStep, xMin + j * xStep) for j in [0, xNodes),
+ * stored row-major, so one simulation substep reads a single contiguous row
+ * and each path does a linear lookup in it. Rows past the last one repeat it.
+ */
+struct LocalVolGrid {
+    double timeStep;
+    std::size_t timeNodes;
+    double xMin;
+    double xStep;
+    std::size_t xNodes;
+    std::vector<double> vols;
+
+    const double* row(std::size_t a) const { return vols.data() + a * xNodes; }
+};
+
+/**
+ * @brief Local volatility (Dupire) Monte Carlo model.
+ *
+ * The spot follows dS = (r - q) S dt + sigma_L(t, S) S dW with sigma_L
+ * calibrated from an implied vol surface. The log-moneyness x = ln(S / F(t))
+ * is stepped with an Euler scheme on substeps of at most 0.01y; the local vol
+ * is read from a precomputed LocalVolGrid instead of evaluating Dupire's
+ * formula on every step. Rates and dividends come from MarketData like the
+ * other models; market vol curves do not apply.
+ */
+class LocalVolMC : public PathModelBase {
+public:
+    /**
+     * @param surface Implied vols in forward log-moneyness (see ImpliedVolSurface).
+     * @param underlying Name whose dividend curve sets the drift with the rate
+     *        curve; empty for the rate curve alone.
+     * @throws std::invalid_argument as calibrate() does.
+     */
+    explicit LocalVolMC(const ImpliedVolSurface& surface, std::string underlying = {});
+
+    /**
+     * @brief The local-vol grid of 'surface'.
+     *
+     * Calibrated once per surface snapshot and kept in a small process-wide
+     * cache, so rebuilding the model for a repricing (or a scenario sharing
+     * the surface) does no Dupire work.
+     *
+     * @throws std::invalid_argument if the surface has butterfly arbitrage,
+     *         i.e. a non-positive density (denominator of Dupire's formula) at
+     *         a grid node.
+     */
+    static std::shared_ptr<const LocalVolGrid> calibrate(const ImpliedVolSurface& surface);
+
+    std::vector<double> simulatePath(double spot0,
+                                     const std::vector<double>& times,
+                                     const MarketData& data,
+                                     std::mt19937& rng) const override;
+
+    /**
+     * @brief One Brownian factor, stepped on the internal substep grid.
+     */
+    BrownianGrid brownianGrid(const std::vector<double>& times) const override;
+
+    /**
+     * @brief Simulates a whole block of paths into a caller-owned SoA batch.
+     *
+     * Each substep interpolates the grid row of its time once, then advances
+     * every path of the block with the gather-based SimdMath kernel.
+     */
+    void simulatePaths(double spot0,
+                       const std::vector<double>& times,
+                       const MarketData& data,
+                       NormalStream& normals,
+                       std::size_t paths,
+                       PathBatch& batch) const override;
+    using PathModelBase::simulatePaths;
+
+    /**
+     * @brief simulatePaths() that stops stepping terminated paths, as HestonMC does.
+     */
+    void simulatePathsUntilTerminated(double spot0,
+                                      const std::vector<double>& times,
+                                      const MarketData& data,
+                                      NormalStream& normals,
+                                      std::size_t paths,
+                                      PathBatch& batch,
+                                      const PathTermination& termination) const override;
+
+    std::string cacheKey() const override;
+
+    // Forward only: exp(x) stays a martingale under the Euler step in x.
+    SpotMarginals marginals(const std::vector<double>& times,
+                            const MarketData& data) const override;
+
+    // The local vol is a function of S / F(t), which does not move with spot0.
+    bool isSpotHomogeneous() const override { return true; }
+
+private:
+    // Batch kernel behind both entry points; 'termination' may be null.
+    void simulateBlock(double spot0, const std::vector<double>& times,
+                       const MarketData& data, NormalStream& normals,
+                       std::size_t paths, PathBatch& batch,
+                       const PathTermination* termination) const;
+
+    std::shared_ptr<const LocalVolGrid> grid_;
+    std::string surfaceKey_;
+    std::string underlying_;
+};
@@ -1,13 +1,18 @@
 #pragma once
 
+#include "TermCurve.hpp"
+
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 /**
  * @brief Container for market data.
  *
- * Holds risk-free rates and market quotes (spot prices, volatilities)
- * for various underlying assets.
+ * Holds the discount curve and, per underlying asset, the market quote (spot
+ * price, flat volatility) plus optional dividend/repo and implied vol term
+ * structures.
  */
 class MarketData {
 public:
@@ -16,9 +21,38 @@ public:
         double sigma;
     };
 
+    /**
+     * @brief Drift and variance of every observation interval of one grid.
+     *
+     * Interval d runs from times[d - 1] (0 for d = 0) to times[d]. The models
+     * read these flat arrays in their time-stepping loops instead of
+     * interpolating curves on every step.
+     */
+    struct ForwardGrid {
+        std::vector<double> times;
+        std::vector<double> carryRate; // Average r - q over each interval.
+        std::vector<double> variance;  // Integrated sigma^2; empty without a vol curve.
+    };
+
+    MarketData();
+
+    // Flat discount curve at rate 'r' (continuous compounding).
     void setRiskFreeRate(double r);
+    // Short-end zero rate; the flat rate when set through setRiskFreeRate().
     double riskFreeRate() const;
 
+    /**
+     * @brief Sets the discount curve from continuously compounded zero rates.
+     */
+    void setRateCurve(TermCurve zeroRates);
+    const TermCurve& rateCurve() const { return rateCurve_; }
+
+    /**
+     * @brief Continuously compounded discount factor from 0 to 't' (years).
+     * Every discounting in the pricer goes through here (see PaymentSchedule).
+     */
+    double discountFactor(double t) const;
+
     /**
      * @brief Stores a quote for a specific underlying.
      */
@@ -30,7 +64,48 @@ public:
      */
     const Quote& getQuote(const std::string& underlying) const;
 
+    /**
+     * @brief Continuous dividend + repo yield curve of 'underlying' (zero when unset).
+     */
+    void setDividendCurve(const std::string& underlying, TermCurve yields);
+
+    /**
+     * @brief Implied vol term structure of 'underlying'. When set, it replaces
+     * the model's flat vol in the Black-Scholes simulation.
+     * @throws std::invalid_argument if the total variance sigma(t)^2 t decreases.
+     */
+    void setVolCurve(const std::string& underlying, TermCurve vols);
+    // Null when no vol curve was set for 'underlying'.
+    const TermCurve* volCurve(const std::string& underlying) const;
+
+    /**
+     * @brief The ForwardGrid of 'underlying' on 'times'.
+     *
+     * Computed once per (underlying, grid) and kept in a small cache shared by
+     * copies of this MarketData until one of them is modified, so repeated
+     * blocks and scenarios of a pricing reuse the same arrays. An unknown or
+     * empty underlying name gets the rate curve alone.
+     */
+    std::shared_ptr<const ForwardGrid> forwardGrid(const std::string& underlying,
+                                                   const std::vector<double>& times) const;
+
+    /**
+     * @brief Exact identity of every curve that moves the paths of
+     * 'underlying' (rates, dividends, vols), for cache keys.
+     */
+    std::string curveKey(const std::string& underlying) const;
+
 private:
-    double riskFreeRate_{0.0};
+    struct GridCache;
+
+    const TermCurve* dividendCurve(const std::string& underlying) const;
+    // Curves changed: start a fresh grid cache (copies keep the old one).
+    void resetGridCache();
+
+    TermCurve rateCurve_;
     std::unordered_map<std::string, Quote> quotes_;
-};
\ No newline at end of file
+    std::unordered_map<std::string, TermCurve> dividendCurves_;
+    std::unordered_map<std::string, TermCurve> varianceCurves_; // Squared vols.
+    std::unordered_map<std::string, TermCurve> volCurves_;
+    mutable std::shared_ptr<GridCache> gridCache_;
+};
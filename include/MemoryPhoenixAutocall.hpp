@@ -18,7 +18,8 @@ public:
    * @brief Calculates the stream of cash flows.
    * Logic includes the "Memory" effect: accumulating unpaid coupons.
    */
-  std::vector<CashFlow> cashFlows(const std::vector<double> &path) const override;
+  void emitCashFlows(const std::vector<double> &path,
+                     CashFlowSink &sink) const override;
 
 private:
   double couponBarrier_{};
@@ -0,0 +1,307 @@
+// Parallel Monte Carlo driver shared by the pricing entry points.
+#pragma once
+
+#include "MarketData.hpp"
+#include "PathCache.hpp"
+#include "PathModel.hpp"
+#include "QuasiRandom.hpp"
+#include "StructuredProduct.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Number of paths simulated by one task of the parallel engine.
+ *
+ * The path set is always cut into blocks of this size, whatever the thread
+ * count, so that the random streams (and therefore the estimates) only depend
+ * on the seed and the number of paths.
+ */
+constexpr std::size_t kPathsPerBlock = 1024;
+
+/**
+ * @brief Builds the independent random stream owned by one block of paths.
+ *
+ * The stream is seeded from (seed, blockIndex) through std::seed_seq, which
+ * decorrelates neighbouring blocks far better than seed + blockIndex would.
+ */
+std::mt19937 makeBlockRng(unsigned int seed, std::uint64_t blockIndex);
+
+/**
+ * @brief The counter-based stream the engine draws block 'blockIndex' from.
+ *
+ * Keyed by the seed, with the block index in the high counter words: every
+ * block of every run has its own stream, and every (path, step) of a block
+ * its own position in it (see PhiloxNormals).
+ */
+PhiloxStream makeBlockStream(unsigned int seed, std::uint64_t blockIndex);
+
+/**
+ * @brief Monte Carlo estimate together with its standard error.
+ */
+struct MonteCarloEstimate {
+    double value{0.0};
+    double standardError{0.0};
+    // Paths behind the estimate: fewer than requested when an adaptive run
+    // stopped early (see MonteCarloSettings::targetStandardError).
+    std::size_t paths{0};
+};
+
+/**
+ * @brief Progress and cancellation hooks of a running pricing.
+ *
+ * With an observer the engine runs its blocks in waves of growing size (one
+ * block per thread first) instead of all at once. Before each block it polls
+ * cancelled(), from the worker threads; after each wave it calls
+ * onProgress(), on the thread that started the run, with the estimate of the
+ * first estimator (the price) over the blocks done so far. The final
+ * estimates are the same as without an observer.
+ */
+class MonteCarloObserver {
+public:
+    virtual ~MonteCarloObserver() = default;
+
+    // Polled concurrently by the workers: must be thread-safe and cheap.
+    virtual bool cancelled() const { return false; }
+
+    // 'pathsDone' out of 'paths' are in 'price'. Randomized QMC reports
+    // whole blocks of every replication, so the count moves in steps of
+    // replications x kPathsPerBlock.
+    virtual void onProgress(std::size_t pathsDone, std::size_t paths,
+                            const MonteCarloEstimate& price) {
+        (void)pathsDone;
+        (void)paths;
+        (void)price;
+    }
+};
+
+/**
+ * @brief Thrown out of a run whose observer asked for cancellation.
+ */
+class MonteCarloCancelled : public std::runtime_error {
+public:
+    MonteCarloCancelled() : std::runtime_error("Monte Carlo run cancelled") {}
+};
+
+/**
+ * @brief How the engine samples the paths of one pricing.
+ */
+struct MonteCarloSettings {
+    std::size_t paths{20000};
+    unsigned int seed{1337};
+    SamplingMode sampling{SamplingMode::PseudoRandom};
+    // Pseudo-random sampling only: antithetic pairs or moment-matched
+    // steps (see NormalScheme). Antithetic runs round the path count up to
+    // an even number and estimate the error from the pair means;
+    // moment-matched runs estimate it from the spread of the block means,
+    // the independent units once every step is matched across a block.
+    NormalScheme normalScheme{NormalScheme::Independent};
+    QmcScrambling scrambling{QmcScrambling::Owen};
+    // Independent scramblings used for the randomized-QMC error estimate.
+    std::size_t qmcReplications{16};
+    // Optional path cache consulted (and filled) by runMonteCarlo and
+    // runMonteCarloScenarios; single-pass Greeks always simulate.
+    PathCache* cache{nullptr};
+    // Let the model stop simulating paths every product has finished with
+    // (autocalls after their call date, see PathTermination). Prices are
+    // unchanged: the streams hand the paths that go on the values they would
+    // have had anyway (moment matching aside, which matches over the live
+    // paths). Not used when the run reads or fills the path cache, whose
+    // paths are complete.
+    bool earlyTermination{true};
+    // Regress the price on analytic proxies of the product (terminal
+    // forward, call-level digitals, capital-at-risk put; see
+    // ControlVariates.hpp) and report the adjusted mean with its residual
+    // standard error. Pseudo-random sampling only; Greeks and scenario
+    // changes are not adjusted. The controls read whole paths, so early
+    // termination is off with them.
+    bool controlVariates{false};
+    // Optional progress reports and cooperative cancellation (see
+    // MonteCarloObserver). Must outlive the run.
+    MonteCarloObserver* observer{nullptr};
+    // Adaptive runs: with any of the three stopping rules set, the blocks run
+    // in batches of 'batchPaths' (whole blocks; whole blocks of every
+    // replication with Sobol sampling) and the run stops after the first batch
+    // where the price's standard error is at most targetStandardError, or
+    // targetRelativeError times |price|, or once timeBudget seconds have
+    // passed; 'paths' is then the most it simulates. The estimates are those
+    // of a fixed run over the paths used (MonteCarloEstimate::paths), so
+    // error targets stop at the same path count for a given seed and batch
+    // size. Adaptive runs read the path cache but do not fill it.
+    double targetStandardError{0.0};
+    double targetRelativeError{0.0};
+    double timeBudget{0.0};
+    std::size_t batchPaths{16 * kPathsPerBlock};
+};
+
+/**
+ * @brief Redemption amounts are binned in steps of this fraction of the notional.
+ */
+constexpr double kRedemptionBinWidth = 0.1;
+constexpr std::size_t kRedemptionBins = 20;
+
+/**
+ * @brief How the paths of a product end, collected in its pricing pass.
+ *
+ * A path redeems at the first observation date where the product terminates
+ * (StructuredProduct::isTerminated, an autocall's call), or at the last date
+ * when it never does. Its redemption amount is the undiscounted sum of the
+ * flows paid on that date: for an autocall, the notional with the coupon paid
+ * alongside, or what is left of it at maturity. Like the estimates, the
+ * profile covers the paths used and is reduced in block order.
+ */
+struct RedemptionProfile {
+    std::vector<double> probability; // Per observation date; sums to 1.
+    double expectedLife{0.0};        // Sum of probability x date, in years.
+    double meanAmount{0.0};
+    double amountStdDev{0.0};
+    // Probability of an amount in [k, k + 1) x kRedemptionBinWidth x
+    // notional, the first and last bins also catching what falls below and
+    // above. Empty when the product has no notional.
+    std::vector<double> amountHistogram;
+};
+
+/**
+ * @brief Prices a product by Monte Carlo, spreading the paths over a thread pool.
+ *
+ * Pseudo-random sampling: each block of kPathsPerBlock paths draws from its
+ * own stream (see makeBlockStream) and keeps its own partial sums. The partial
+ * sums are merged in block order once every block is done, so price and
+ * standard error are bit-for-bit identical for a given seed regardless of the
+ * pool size. settings.normalScheme makes the block streams antithetic or
+ * moment-matched; the standard error then follows the sampling units.
+ *
+ * Sobol sampling: the paths are split into qmcReplications independently
+ * scrambled copies of the first paths / qmcReplications Sobol points (rounded
+ * up), driven through a Brownian bridge. The price is the mean over the
+ * replications and the standard error the spread of the replication means
+ * (randomized QMC). Without scrambling there is a single replication, which
+ * skips the origin point, and no error estimate (0).
+ *
+ * settings.observer, when set, is told of the converging price after each
+ * wave of blocks and can stop the run (see MonteCarloObserver).
+ *
+ * @param product Product generating the cash flows of each path.
+ * @param data Market snapshot (spot of the underlying, discount rate).
+ * @param model Path generator.
+ * @param settings Path count, seed and sampling scheme.
+ * @param standardError [out] Standard error of the price estimate.
+ * @param pool Thread pool executing the blocks.
+ * @param redemption [out] Optional redemption profile of the paths.
+ * @return double Monte Carlo estimate of the discounted price.
+ * @throws MonteCarloCancelled when the observer cancels the run.
+ */
+double runMonteCarlo(const StructuredProduct& product,
+                     const MarketData& data,
+                     const PathModelBase& model,
+                     const MonteCarloSettings& settings,
+                     double& standardError,
+                     ThreadPool& pool,
+                     RedemptionProfile* redemption = nullptr);
+
+/**
+ * @brief Price and first/second order spot Greeks plus vega from one pass.
+ */
+struct MonteCarloGreeks {
+    MonteCarloEstimate price;
+    MonteCarloEstimate delta;
+    MonteCarloEstimate gamma;
+    MonteCarloEstimate vega;
+};
+
+/**
+ * @brief Whether runMonteCarloGreeks() can handle this product/model pair.
+ *
+ * The model must expose path sensitivities and the schedule must move the
+ * clock at least once (the spot Greeks are read off the first step).
+ */
+bool supportsSinglePassGreeks(const StructuredProduct& product,
+                              const PathModelBase& model);
+
+/**
+ * @brief Prices a product and its delta, gamma and vega from the same paths.
+ *
+ * Continuous payoffs (StructuredProduct::hasContinuousPayoff) are
+ * differentiated pathwise along the model's spot and vol tangents, with gamma
+ * from the mixed pathwise/likelihood-ratio estimator. Payoffs with digital
+ * triggers (autocall barriers) use likelihood-ratio weights, centred on the
+ * value of the forward path to keep their variance down. Every estimator is
+ * unbiased, gets its own standard error, and follows the same sampling,
+ * blocking and reduction rules as runMonteCarlo(), so the price matches it
+ * exactly. 'redemption', when given, receives the redemption profile of the
+ * paths.
+ *
+ * @throws std::invalid_argument when supportsSinglePassGreeks() is false.
+ */
+MonteCarloGreeks runMonteCarloGreeks(const StructuredProduct& product,
+                                     const MarketData& data,
+                                     const PathModelBase& model,
+                                     const MonteCarloSettings& settings,
+                                     ThreadPool& pool,
+                                     RedemptionProfile* redemption = nullptr);
+
+/**
+ * @brief One market state of a fused bump-and-revalue run.
+ *
+ * Both pointers must outlive the run. 'model' may be shared between scenarios.
+ */
+struct MonteCarloScenario {
+    const MarketData* data{nullptr};
+    const PathModelBase* model{nullptr};
+};
+
+/**
+ * @brief Value of one scenario and its change from the base scenario.
+ *
+ * Both estimates come from the same paths, so the standard error of the change
+ * only reflects the noise that survives common random numbers.
+ */
+struct ScenarioEstimate {
+    MonteCarloEstimate value;
+    MonteCarloEstimate changeFromBase;
+};
+
+/**
+ * @brief Prices a product under several market states in one pass.
+ *
+ * Each block draws its normals once, with scenario 0 (the base), and replays
+ * them for every other scenario, so all states share common random numbers
+ * by construction. A scenario with the base model and rate, on a model that
+ * isSpotHomogeneous(), is not simulated at all: the base paths are rescaled
+ * by its spot ratio, so spot bumps (central differences, gamma ladders) cost
+ * one payoff evaluation per path. Scenario 0 reproduces runMonteCarlo()
+ * exactly, and 'redemption', when given, receives the redemption profile of
+ * its paths.
+ *
+ * @throws std::invalid_argument if a scenario lacks data or a model, or its
+ * model has a different Brownian grid from the base one.
+ */
+std::vector<ScenarioEstimate> runMonteCarloScenarios(
+    const StructuredProduct& product,
+    const std::vector<MonteCarloScenario>& scenarios,
+    const MonteCarloSettings& settings,
+    ThreadPool& pool,
+    RedemptionProfile* redemption = nullptr);
+
+/**
+ * @brief runMonteCarloScenarios() for several products sharing one set of paths.
+ *
+ * The paths of every scenario are generated once per block and each product
+ * is valued on them, so the simulation cost is paid once for the whole list.
+ * result[k][s] is product k in scenario s; product k alone would get exactly
+ * the same numbers. 'redemptions', when given, receives one redemption
+ * profile per product, from the base scenario.
+ *
+ * @throws std::invalid_argument as the single-product overload, or if the
+ * products do not share the underlying and observation times.
+ */
+std::vector<std::vector<ScenarioEstimate>> runMonteCarloScenarios(
+    const std::vector<const StructuredProduct*>& products,
+    const std::vector<MonteCarloScenario>& scenarios,
+    const MonteCarloSettings& settings,
+    ThreadPool& pool,
+    std::vector<RedemptionProfile>* redemptions = nullptr);
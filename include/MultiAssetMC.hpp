@@ -0,0 +1,159 @@
+#pragma once
+
+#include "PathModel.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief How a multi-asset product reads its basket of underlyings.
+ */
+enum class BasketType { WorstOf, BestOf, Average };
+
+/**
+ * @brief What the basket level combines on each observation date.
+ *
+ * Performance: the worst (best, average) of the performances S_a(t) / S_a(0),
+ * for payoffs on the level itself (autocalls, max-return cliquets).
+ * PeriodReturns: the level compounds, date after date, the worst (best,
+ * average) of the assets' returns since the previous date, so a payoff on
+ * the level's period returns (a ratchet cliquet) reads those of the basket.
+ */
+enum class BasketObservation { Performance, PeriodReturns };
+
+/**
+ * @brief One asset of a basket: its market name and flat Black-Scholes vol.
+ */
+struct BasketAsset {
+    std::string underlying;
+    double sigma;
+};
+
+/**
+ * @brief Caller-owned block of multi-asset paths, assets x dates x paths.
+ *
+ * Values are performances S_i(t) / S_i(0), laid out asset-major and then
+ * date-major: at(a, d, p) = values[(a * dates() + d) * paths() + p]. Like
+ * PathBatch, resize() keeps the capacity.
+ */
+class MultiAssetBatch {
+public:
+    void resize(std::size_t assets, std::size_t paths, std::size_t dates) {
+        assets_ = assets;
+        paths_ = paths;
+        dates_ = dates;
+        values_.resize(assets * dates * paths);
+    }
+
+    std::size_t assets() const { return assets_; }
+    std::size_t paths() const { return paths_; }
+    std::size_t dates() const { return dates_; }
+
+    // Row of all path values of asset a at observation date d.
+    double* row(std::size_t a, std::size_t d) {
+        return values_.data() + (a * dates_ + d) * paths_;
+    }
+    const double* row(std::size_t a, std::size_t d) const {
+        return values_.data() + (a * dates_ + d) * paths_;
+    }
+
+    double at(std::size_t a, std::size_t d, std::size_t p) const {
+        return values_[(a * dates_ + d) * paths_ + p];
+    }
+
+private:
+    std::size_t assets_{0};
+    std::size_t paths_{0};
+    std::size_t dates_{0};
+    std::vector<double> values_;
+};
+
+/**
+ * @brief Correlated multi-asset Black-Scholes model read through a basket.
+ *
+ * Every asset follows its own GBM, with the rate curve, its dividend curve
+ * and (when the market has one) its vol curve, as in BlackScholesMC. The
+ * Brownian motions are correlated with a Cholesky factor computed once in the
+ * constructor. As a PathModelBase it produces the basket level
+ * spot0 * B(t), where B combines the assets as set by BasketType and
+ * BasketObservation. The single-asset payoffs priced on that path become
+ * their worst-of, best-of or basket variants, with barriers read relative to
+ * spot0; cliquets on period returns need BasketObservation::PeriodReturns.
+ */
+class MultiAssetMC : public PathModelBase {
+public:
+    /**
+     * @param assets The basket, at least one asset.
+     * @param correlation Row-major assets x assets correlation matrix.
+     * @param type How the performances are combined into the basket level.
+     * @param observation Whether the level combines performances or period returns.
+     * @throws std::invalid_argument if the matrix has the wrong size, is not
+     *         symmetric with a unit diagonal, or is not positive definite.
+     */
+    MultiAssetMC(std::vector<BasketAsset> assets, const std::vector<double>& correlation,
+                 BasketType type,
+                 BasketObservation observation = BasketObservation::Performance);
+
+    std::size_t assetCount() const { return assets_.size(); }
+    // Row-major lower-triangular Cholesky factor of the correlation matrix.
+    const std::vector<double>& choleskyFactor() const { return cholesky_; }
+
+    /**
+     * @brief Simulates the performances of every asset for a block of paths.
+     *
+     * One next() call per moving date, asking for assets x paths normals that
+     * are correlated in place across the whole block.
+     */
+    void simulateAssets(const std::vector<double>& times,
+                        const MarketData& data,
+                        NormalStream& normals,
+                        std::size_t paths,
+                        MultiAssetBatch& batch) const;
+
+    std::vector<double> simulatePath(double spot0,
+                                     const std::vector<double>& times,
+                                     const MarketData& data,
+                                     std::mt19937& rng) const override;
+
+    /**
+     * @brief One factor per asset, stepped on every date that moves the clock.
+     */
+    BrownianGrid brownianGrid(const std::vector<double>& times) const override;
+
+    /**
+     * @brief Basket level paths: simulateAssets() reduced date by date.
+     */
+    void simulatePaths(double spot0,
+                       const std::vector<double>& times,
+                       const MarketData& data,
+                       NormalStream& normals,
+                       std::size_t paths,
+                       PathBatch& batch) const override;
+    using PathModelBase::simulatePaths;
+
+    std::string cacheKey() const override;
+
+    // Curves of every asset: the basket name itself carries none.
+    std::string curveKey(const MarketData& data,
+                         const std::string& underlying) const override;
+
+    // Forward of the average basket (the mean of the asset forwards, or of
+    // their period growths compounded); nothing for worst-of and best-of,
+    // whose law has no simple closed form.
+    SpotMarginals marginals(const std::vector<double>& times,
+                            const MarketData& data) const override;
+
+    // Performances do not depend on spot0, which only scales the level.
+    bool isSpotHomogeneous() const override { return true; }
+
+private:
+    // Drift and vol of asset a over date interval d, as BlackScholesMC does.
+    void stepParameters(std::size_t a, const MarketData::ForwardGrid& forward,
+                        std::size_t d, double dt, double& drift, double& vol) const;
+
+    std::vector<BasketAsset> assets_;
+    std::vector<double> correlation_;
+    std::vector<double> cholesky_;
+    BasketType type_;
+    BasketObservation observation_;
+};
@@ -0,0 +1,165 @@
+// Sources of standard normal draws consumed by the batch path generators.
+#pragma once
+
+#include "SimdMath.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Brownian drivers consumed by a model over one observation schedule.
+ *
+ * For every step j the model draws 'factors' standard normals per path, the
+ * standardized increments of independent Brownian motions over
+ * (stepTimes[j-1], stepTimes[j]] (stepTimes[-1] = 0). Knowing the grid lets a
+ * quasi-random source rebuild those increments through a Brownian bridge.
+ */
+struct BrownianGrid {
+    std::vector<double> stepTimes;
+    std::size_t factors{1};
+};
+
+/**
+ * @brief How a pseudo-random block turns its draws into path normals.
+ *
+ * Independent: every value is a fresh draw. Antithetic: paths (2j, 2j + 1)
+ * of a block see opposite normals at every step, so half as many values are
+ * drawn. MomentMatched: each step's draws are shifted and scaled to an exact
+ * zero mean and unit second moment across the paths of the block.
+ */
+enum class NormalScheme { Independent, Antithetic, MomentMatched };
+
+/**
+ * @brief Sequential supplier of normals for a block of paths.
+ *
+ * The model calls next() once per step of its BrownianGrid, in order, asking
+ * for factors * paths values laid out factor-major: z[f * paths + p]. Models
+ * that drop terminated paths call nextLive() for those steps instead.
+ */
+class NormalStream {
+public:
+    virtual ~NormalStream() = default;
+
+    virtual void next(double* z, std::size_t count) = 0;
+
+    /**
+     * @brief next() for the paths of the block a model still advances.
+     *
+     * 'live' holds 'lanes' increasing path indices below 'paths'; z receives
+     * factors * lanes values, factor-major over the live lanes. The default
+     * draws the whole step and keeps the live lanes, so the values are those
+     * next() would give; streams that can skip the other paths override it.
+     */
+    virtual void nextLive(double* z, std::size_t factors, std::size_t paths,
+                          const std::size_t* live, std::size_t lanes) {
+        scratch_.resize(factors * paths);
+        next(scratch_.data(), scratch_.size());
+        for (std::size_t f = 0; f < factors; ++f) {
+            for (std::size_t k = 0; k < lanes; ++k) {
+                z[f * lanes + k] = scratch_[f * paths + live[k]];
+            }
+        }
+    }
+
+private:
+    std::vector<double> scratch_;
+};
+
+/**
+ * @brief Plain pseudo-random normals drawn on demand from a Mersenne Twister.
+ *
+ * Behind the std::mt19937 convenience overloads; the engine's blocks read
+ * PhiloxNormals instead.
+ */
+class PseudoRandomNormals : public NormalStream {
+public:
+    explicit PseudoRandomNormals(std::mt19937& rng) : rng_(rng) {}
+
+    void next(double* z, std::size_t count) override {
+        fillStandardNormals(rng_, z, count);
+    }
+
+    // Draws for the live paths only: terminated paths cost no random numbers,
+    // at the price of a sequence that differs from next() once some have.
+    void nextLive(double* z, std::size_t factors, std::size_t, const std::size_t*,
+                  std::size_t lanes) override {
+        fillStandardNormals(rng_, z, factors * lanes);
+    }
+
+private:
+    std::mt19937& rng_;
+};
+
+/**
+ * @brief Pseudo-random normals read off a counter-based Philox stream.
+ *
+ * The k-th value the block consumes is normal number k of its PhiloxStream,
+ * counting every next() value and every factors * paths step of nextLive().
+ * nextLive() reads exactly the positions next() would give its live lanes,
+ * so terminated paths cost no random numbers and change no other path.
+ */
+class PhiloxNormals : public NormalStream {
+public:
+    explicit PhiloxNormals(const PhiloxStream& stream) : stream_(stream) {}
+
+    void next(double* z, std::size_t count) override;
+    void nextLive(double* z, std::size_t factors, std::size_t paths,
+                  const std::size_t* live, std::size_t lanes) override;
+
+private:
+    PhiloxStream stream_;
+    std::uint64_t position_{0};
+    std::vector<std::uint64_t> positions_;
+};
+
+/**
+ * @brief Pseudo-random normals in antithetic pairs.
+ *
+ * Within each factor row of a block of 'paths' paths, path 2j + 1 receives
+ * the negated draw of path 2j (an odd last path draws alone), so a row reads
+ * (paths + 1) / 2 values of its Philox stream. nextLive() gives the live
+ * lanes the values next() would, and the pairs stay independent sampling
+ * units whichever of their paths terminate.
+ */
+class AntitheticNormals : public NormalStream {
+public:
+    AntitheticNormals(const PhiloxStream& stream, std::size_t paths)
+        : stream_(stream), paths_(paths) {}
+
+    void next(double* z, std::size_t count) override;
+    void nextLive(double* z, std::size_t factors, std::size_t paths,
+                  const std::size_t* live, std::size_t lanes) override;
+
+private:
+    PhiloxStream stream_;
+    std::size_t paths_;
+    std::uint64_t position_{0};
+    std::vector<double> draws_;
+    std::vector<std::uint64_t> positions_;
+};
+
+/**
+ * @brief Pseudo-random normals moment-matched step by step.
+ *
+ * Each factor row of a step (the 'paths' values of next(), the live lanes
+ * of nextLive()) is read off the Philox stream, then shifted and scaled so
+ * that its sample mean is 0 and its mean square 1. Paths of a block are then
+ * no longer independent; the block is the sampling unit.
+ */
+class MomentMatchedNormals : public NormalStream {
+public:
+    MomentMatchedNormals(const PhiloxStream& stream, std::size_t paths)
+        : stream_(stream), paths_(paths) {}
+
+    void next(double* z, std::size_t count) override;
+    void nextLive(double* z, std::size_t factors, std::size_t paths,
+                  const std::size_t* live, std::size_t lanes) override;
+
+private:
+    PhiloxStream stream_;
+    std::size_t paths_;
+    std::uint64_t position_{0};
+    std::vector<std::uint64_t> positions_;
+};
@@ -0,0 +1,120 @@
+// Bounded LRU cache of simulated path sets, shared between pricings.
+#pragma once
+
+#include "PathModel.hpp"
+#include "QuasiRandom.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Everything but the observation grid that determines a path set.
+ *
+ * 'model' is PathModelBase::cacheKey(); an empty string means the model does
+ * not support caching.
+ */
+struct PathCacheKey {
+    std::string model;
+    double spot{0.0};
+    double rate{0.0};
+    unsigned int seed{0};
+    std::size_t paths{0};
+    SamplingMode sampling{SamplingMode::PseudoRandom};
+    NormalScheme normalScheme{NormalScheme::Independent};
+    QmcScrambling scrambling{QmcScrambling::None};
+    std::size_t qmcReplications{0};
+
+    std::size_t hash() const;
+    bool operator==(const PathCacheKey& other) const;
+};
+
+/**
+ * @brief Paths of one simulation, kept block by block as the engine made them.
+ *
+ * blocks[task] is the batch of Monte Carlo task 'task' (see runMonteCarlo),
+ * with one date per entry of 'times'.
+ */
+struct CachedPaths {
+    std::vector<double> times;
+    std::vector<PathBatch> blocks;
+
+    std::size_t bytes() const;
+};
+
+/**
+ * @brief Thread-safe LRU cache of CachedPaths under a byte budget.
+ *
+ * Entries are looked up by key and observation grid. With superset reuse on,
+ * a product whose dates all appear in a cached grid is served the matching
+ * columns of that entry instead of simulating again. Its price is then a valid
+ * estimate on other random draws than a fresh run, so results depend on what
+ * was priced before. Turn it off when bit-reproducibility matters.
+ */
+class PathCache {
+public:
+    static constexpr std::size_t kDefaultByteBudget = 256u * 1024u * 1024u;
+
+    /**
+     * @brief Columns of a cached entry answering one lookup.
+     *
+     * 'columns' maps each requested date to its date index in paths->times;
+     * it is empty when the grids are identical.
+     */
+    struct Hit {
+        std::shared_ptr<const CachedPaths> paths;
+        std::vector<std::size_t> columns;
+    };
+
+    explicit PathCache(std::size_t byteBudget = kDefaultByteBudget,
+                       bool reuseSupersetGrids = true);
+
+    /**
+     * @brief Finds paths for 'key' on 'times', preferring an exact grid match.
+     *
+     * @param exactGridOnly Ignore superset grids for this lookup.
+     */
+    std::optional<Hit> find(const PathCacheKey& key, const std::vector<double>& times,
+                            bool exactGridOnly = false);
+
+    /**
+     * @brief Stores a path set, evicting least recently used entries to fit.
+     *
+     * Sets larger than the whole budget are not stored.
+     */
+    void insert(const PathCacheKey& key, std::shared_ptr<const CachedPaths> paths);
+
+    void clear();
+    std::size_t bytes() const;
+    std::size_t entries() const;
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+    /**
+     * @brief Process-wide cache used when PricingInputs::usePathCache is set.
+     */
+    static PathCache& shared();
+
+private:
+    struct Entry {
+        PathCacheKey key;
+        std::size_t hash;
+        std::shared_ptr<const CachedPaths> paths;
+        std::size_t bytes;
+    };
+
+    void evictToFit();
+
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_; // Most recently used first.
+    std::size_t byteBudget_;
+    bool reuseSupersetGrids_;
+    std::size_t bytes_{0};
+    std::size_t hits_{0};
+    std::size_t misses_{0};
+};
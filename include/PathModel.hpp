@@ -2,10 +2,96 @@
 #pragma once
 
 #include "MarketData.hpp"
+#include "NormalStream.hpp"
 
+#include <cstddef>
 #include <random>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
+/**
+ * @brief Caller-owned block of simulated paths, stored structure-of-arrays.
+ *
+ * Spots are laid out date-major: the values of every path at one observation
+ * date are contiguous, i.e. at(d, p) = values[d * paths() + p]. resize() keeps
+ * the existing capacity, so a batch reused from one block to the next does not
+ * touch the heap once it has reached its largest size.
+ */
+class PathBatch {
+public:
+    void resize(std::size_t paths, std::size_t dates) {
+        paths_ = paths;
+        dates_ = dates;
+        values_.resize(paths * dates);
+    }
+
+    std::size_t paths() const { return paths_; }
+    std::size_t dates() const { return dates_; }
+
+    // Row of all path values at observation date d.
+    double* date(std::size_t d) { return values_.data() + d * paths_; }
+    const double* date(std::size_t d) const { return values_.data() + d * paths_; }
+
+    double& at(std::size_t d, std::size_t p) { return values_[d * paths_ + p]; }
+    double at(std::size_t d, std::size_t p) const { return values_[d * paths_ + p]; }
+
+    /**
+     * @brief Gathers path p into 'out' (reusing its capacity).
+     */
+    void copyPath(std::size_t p, std::vector<double>& out) const {
+        out.resize(dates_);
+        for (std::size_t d = 0; d < dates_; ++d) {
+            out[d] = values_[d * paths_ + p];
+        }
+    }
+
+private:
+    std::size_t paths_{0};
+    std::size_t dates_{0};
+    std::vector<double> values_;
+};
+
+/**
+ * @brief Per-path derivative information for single-pass Greeks.
+ *
+ * The scores are likelihood-ratio weights of the simulated path density:
+ * deltaScore = d log p / d spot0, gammaScore = (d^2 p / d spot0^2) / p and
+ * vegaScore = d log p / d sigma. vegaTangent holds the pathwise derivatives
+ * dS(t_d) / d sigma, laid out like the spots of the PathBatch.
+ */
+struct PathSensitivities {
+    std::vector<double> deltaScore;
+    std::vector<double> gammaScore;
+    std::vector<double> vegaScore;
+    PathBatch vegaTangent;
+};
+
+/**
+ * @brief Early-termination rule handed to a path model by the engine.
+ *
+ * isTerminated(d, spot) is true when every payoff reading a path has finished
+ * with it at observation date d, given the path's spot there. No later date
+ * of such a path is ever read, so the model may stop advancing it.
+ */
+class PathTermination {
+public:
+    virtual ~PathTermination() = default;
+    virtual bool isTerminated(std::size_t dateIndex, double spot) const = 0;
+};
+
+/**
+ * @brief What a model knows in closed form about its spot at given dates.
+ *
+ * forward[i] = E[S(times[i])] / spot0 and, when ln S(times[i]) is Gaussian,
+ * logVariance[i] = Var[ln S(times[i])]. Either vector is empty when the model
+ * has no such formula. The engine prices its control variates from them.
+ */
+struct SpotMarginals {
+    std::vector<double> forward;
+    std::vector<double> logVariance;
+};
+
 class PathModelBase {
 public:
     virtual ~PathModelBase() = default;
@@ -15,4 +101,119 @@ public:
         const std::vector<double>& times,
         const MarketData& data,
         std::mt19937& rng) const = 0;
+
+    /**
+     * @brief Brownian drivers consumed by simulatePaths() for this schedule.
+     */
+    virtual BrownianGrid brownianGrid(const std::vector<double>& times) const = 0;
+
+    /**
+     * @brief Simulates 'paths' paths at once into a caller-owned batch.
+     *
+     * The batch is resized to paths x times.size(). The model pulls its
+     * normals from 'normals', one next() call per step of brownianGrid(times),
+     * so the same kernel serves pseudo-random and quasi-random sampling.
+     */
+    virtual void simulatePaths(double spot0,
+                               const std::vector<double>& times,
+                               const MarketData& data,
+                               NormalStream& normals,
+                               std::size_t paths,
+                               PathBatch& batch) const = 0;
+
+    // Pseudo-random convenience overload drawing from 'rng'.
+    void simulatePaths(double spot0,
+                       const std::vector<double>& times,
+                       const MarketData& data,
+                       std::mt19937& rng,
+                       std::size_t paths,
+                       PathBatch& batch) const {
+        PseudoRandomNormals normals(rng);
+        simulatePaths(spot0, times, data, normals, paths, batch);
+    }
+
+    /**
+     * @brief simulatePaths() that may stop advancing the paths 'termination'
+     * reports as finished.
+     *
+     * Steps taken after some paths terminated draw through
+     * NormalStream::nextLive() for the remaining ones, so the paths match
+     * simulatePaths() exactly when the stream's nextLive() keeps next()'s
+     * values (quasi-random, PhiloxNormals) and are equally distributed
+     * otherwise. Dates
+     * after a path's termination repeat its spot there. The default simulates
+     * every path in full; models with expensive substepping override it.
+     */
+    virtual void simulatePathsUntilTerminated(double spot0,
+                                              const std::vector<double>& times,
+                                              const MarketData& data,
+                                              NormalStream& normals,
+                                              std::size_t paths,
+                                              PathBatch& batch,
+                                              const PathTermination& termination) const {
+        (void)termination;
+        simulatePaths(spot0, times, data, normals, paths, batch);
+    }
+
+    /**
+     * @brief Closed-form marginals of the simulated spot (none by default).
+     *
+     * Must hold for the discretized paths, not just the continuous model, or
+     * control variates built on them would bias the price.
+     */
+    virtual SpotMarginals marginals(const std::vector<double>& times,
+                                    const MarketData& data) const {
+        (void)times;
+        (void)data;
+        return {};
+    }
+
+    /**
+     * @brief Identifies the model and its exact parameters for the path cache.
+     *
+     * Two models with equal keys must simulate identical paths from identical
+     * inputs. The default (empty) marks paths that must not be cached.
+     */
+    virtual std::string cacheKey() const { return {}; }
+
+    /**
+     * @brief The term structures of 'data' the paths of 'underlying' read,
+     * for cache keys (MarketData::curveKey() of the underlying by default).
+     */
+    virtual std::string curveKey(const MarketData& data,
+                                 const std::string& underlying) const {
+        return data.curveKey(underlying);
+    }
+
+    /**
+     * @brief True when simulated spots scale linearly with spot0.
+     *
+     * That is S(t) = spot0 * X(t) with X independent of spot0, so a scenario
+     * that only moves the spot can rescale already simulated paths.
+     */
+    virtual bool isSpotHomogeneous() const { return false; }
+
+    /**
+     * @brief Whether simulatePathsWithSensitivities() is implemented.
+     */
+    virtual bool supportsPathSensitivities() const { return false; }
+
+    /**
+     * @brief simulatePaths() that also fills the Greek sensitivities of every path.
+     *
+     * Consumes the normal stream exactly like simulatePaths(), so the spots
+     * are identical. Models without closed-form scores leave the default,
+     * which throws std::logic_error.
+     */
+    virtual void simulatePathsWithSensitivities(double spot0,
+                                                const std::vector<double>& times,
+                                                const MarketData& data,
+                                                NormalStream& normals,
+                                                std::size_t paths,
+                                                PathBatch& batch,
+                                                PathSensitivities& sensitivities) const {
+        (void)spot0; (void)times; (void)data; (void)normals; (void)paths;
+        (void)batch; (void)sensitivities;
+        throw std::logic_error("This model does not provide path sensitivities");
+    }
 };
@@ -0,0 +1,39 @@
+// Payment dates of one pricing as integer indices with precomputed discounting.
+#pragma once
+
+#include "MarketData.hpp"
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief A product's observation dates turned into indices 0..size()-1, with
+ * the discount factor of each date computed once.
+ *
+ * Payoffs report flows by date index (see CashFlowSink), so the pricing loop
+ * reads discountFactor(i) from a table instead of evaluating exp(-r * t) for
+ * every flow of every path. Factors come from MarketData::discountFactor, the
+ * single place a term-structure discount curve has to plug into.
+ *
+ * An index past the last date stands for "paid now": time 0, factor 1.
+ */
+class PaymentSchedule {
+public:
+    PaymentSchedule() = default;
+    PaymentSchedule(std::vector<double> times, const MarketData& data);
+
+    std::size_t size() const { return times_.size(); }
+    const std::vector<double>& times() const { return times_; }
+    const std::vector<double>& discountFactors() const { return discountFactors_; }
+
+    double time(std::size_t index) const {
+        return index < times_.size() ? times_[index] : 0.0;
+    }
+    double discountFactor(std::size_t index) const {
+        return index < discountFactors_.size() ? discountFactors_[index] : 1.0;
+    }
+
+private:
+    std::vector<double> times_;
+    std::vector<double> discountFactors_;
+};
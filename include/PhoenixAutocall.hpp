@@ -36,9 +36,10 @@ public:
    * 2. If not autocalled, check Coupon: If Spot >= CouponBarrier -> Pay Coupon only.
    *
    * @param path Simulated price path of the underlying.
-   * @return std::vector<CashFlow> List of cash flows.
+   * @param sink Receives each flow with the index of its payment date.
    */
-  std::vector<CashFlow> cashFlows(const std::vector<double> &path) const override;
+  void emitCashFlows(const std::vector<double> &path,
+                     CashFlowSink &sink) const override;
 
 private:
   double couponBarrier_;
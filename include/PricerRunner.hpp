@@ -1,27 +1,82 @@
 // Public-facing pricing inputs/results plus product/model enums used by the runner.
 #pragma once
 
+#include "HestonMC.hpp"
+#include "MultiAssetMC.hpp"
+#include "QuasiRandom.hpp"
+
 #include <cstddef>
 #include <string>
 #include <vector>
 
+class MonteCarloObserver;
+
 enum class ProductFamily { Autocall, Cliquet };
 enum class AutocallType { Simple, Phoenix, MemoryPhoenix, StepDown, Airbag };
 enum class CliquetType { MaxReturn, CappedCoupons };
-enum class ModelType { BlackScholes, Heston };
+enum class ModelType { BlackScholes, Heston, LocalVol };
+// BumpAndRevalue reprices on bumped inputs; SinglePass estimates the Greeks
+// from the base paths (Black-Scholes only, other models fall back to bumps).
+enum class GreekMethod { BumpAndRevalue, SinglePass };
 
 struct PricingInputs {
     std::string underlying{"SPX"};
     double spot{4000.0};
     double sigma{0.20};
     double rate{0.02};
+    // Optional term structures, one value per pillar of 'curveTimes' (years).
+    // Empty vectors keep the flat 'rate' / 'sigma' and no dividends.
+    std::vector<double> curveTimes;
+    std::vector<double> rateCurve;     // Continuously compounded zero rates.
+    std::vector<double> dividendCurve; // Dividend + repo yields.
+    std::vector<double> volCurve;      // Implied vols (Black-Scholes only).
+    // Implied vol surface of the local-vol model: vols row-major
+    // [expiry][strike], strikes as forward log-moneyness ln(K / F). Empty
+    // vectors give a flat surface at 'sigma'.
+    std::vector<double> surfaceExpiries;
+    std::vector<double> surfaceMoneyness;
+    std::vector<double> surfaceVols;
+    // Multi-asset basket. When 'basketUnderlyings' is non-empty the product is
+    // priced on the basket level spot * B(t), B the worst, best or average
+    // performance of the assets, so its barriers are read relative to 'spot'
+    // and 'underlying' names the basket. Capped-coupon cliquets read the worst
+    // (best, average) of the assets' period returns. Correlated Black-Scholes
+    // only.
+    std::vector<std::string> basketUnderlyings;
+    std::vector<double> basketVols;        // One flat vol per asset.
+    std::vector<double> basketCorrelation; // Row-major assets x assets.
+    // Optional term structures of each asset, indexed like basketUnderlyings:
+    // pillars, dividend yields and implied vols (an empty or missing entry
+    // keeps no dividends or the flat basketVols value). The rate curve is the
+    // one above.
+    std::vector<std::vector<double>> basketCurveTimes;
+    std::vector<std::vector<double>> basketDividendCurves;
+    std::vector<std::vector<double>> basketVolCurves;
+    BasketType basketType{BasketType::WorstOf};
     double notional{1000.0};
     double coupon{0.05};
     double autocallBarrier{4100.0};
     double protectionBarrier{3200.0};
     std::vector<double> observationTimes{0.25, 0.5, 0.75, 1.0};
-    std::size_t paths{20000};
+    std::size_t paths{20000}; // The most an adaptive run simulates.
     unsigned int seed{1337};
+    // Adaptive path count: simulate in batches of 'batchPaths' until the
+    // price's standard error is at most targetStdError or targetRelativeError
+    // times the price, or timeBudgetSeconds have passed (0 = rule unused; all
+    // three 0 = fixed 'paths'). See MonteCarloSettings.
+    double targetStdError{0.0};
+    double targetRelativeError{0.0};
+    double timeBudgetSeconds{0.0};
+    std::size_t batchPaths{16384};
+    std::size_t threads{0}; // Monte Carlo worker threads, 0 = all hardware threads.
+    SamplingMode sampling{SamplingMode::PseudoRandom};
+    NormalScheme normalScheme{NormalScheme::Independent}; // Antithetic / moment matching.
+    QmcScrambling qmcScrambling{QmcScrambling::Owen};
+    std::size_t qmcReplications{16}; // Scrambled copies for the RQMC std error.
+    GreekMethod greekMethod{GreekMethod::BumpAndRevalue};
+    bool usePathCache{false}; // Reuse paths across calls via PathCache::shared().
+    bool earlyTermination{true}; // Stop simulating autocall paths once called.
+    bool controlVariates{false}; // Adjust the price with analytic control variates.
     double spreadFraction{0.005};
     ProductFamily productFamily{ProductFamily::Autocall};
     AutocallType autocallType{AutocallType::Simple};
@@ -35,6 +90,11 @@ struct PricingInputs {
     double hestonTheta{0.04};
     double hestonXi{0.5};
     double hestonRho{-0.5};
+    // Heston discretization: QE prices accurately at steps of 0.1-0.25y.
+    HestonScheme hestonScheme{HestonScheme::Euler};
+    double hestonMaxStep{kHestonDefaultMaxStep}; // Largest substep (years).
+    // Fit the model to the surface* vols before pricing (see calibrateModel()).
+    bool calibrateToSurface{false};
     double cliquetParticipation{1.0};
     double cliquetCap{0.05};
 };
@@ -46,6 +106,89 @@ struct PricingResults {
     double vega{};
     double bid{};
     double ask{};
+    double gamma{};
+    // Standard errors of the Greeks; only estimated by GreekMethod::SinglePass
+    // (left at 0 for bump-and-revalue).
+    double deltaStdError{};
+    double gammaStdError{};
+    double vegaStdError{};
+    std::size_t pathsUsed{}; // Paths simulated: below 'paths' when an adaptive run converged.
+    // Redemption diagnostics from the same paths (see RedemptionProfile):
+    // probability of redeeming on each observation date, expected life in
+    // years, mean and standard deviation of the amount paid at redemption,
+    // and its distribution in bins of 10% of the notional.
+    std::vector<double> redemptionProbabilities;
+    double expectedLife{};
+    double redemptionMean{};
+    double redemptionStdDev{};
+    std::vector<double> redemptionHistogram;
+};
+
+/**
+ * @brief 'inputs' with its model fitted to its implied vol surface.
+ *
+ * Heston: v0, kappa, theta, xi and rho by calibrateHeston(), starting from
+ * the current values. Black-Scholes: sigma by calibrateBlackScholesVol().
+ * Local vol already reads the surface and is returned unchanged. The result
+ * has calibrateToSurface cleared; priceAutocall() and pricePortfolio() call
+ * this for inputs that set it.
+ *
+ * @throws std::invalid_argument if the inputs hold no surface or a basket.
+ */
+PricingInputs calibrateModel(const PricingInputs& inputs);
+
+/**
+ * @brief Prices one product with its Greeks, bid and ask.
+ *
+ * 'observer', when given, receives the converging price as the blocks finish
+ * and may cancel the run, which then throws MonteCarloCancelled (see
+ * MonteCarloEngine.hpp). It must outlive the call.
+ */
+PricingResults priceAutocall(const PricingInputs& inputs,
+                             MonteCarloObserver* observer = nullptr);
+
+/**
+ * @brief One position of a book: the trade description and its size.
+ */
+struct PortfolioTrade {
+    PricingInputs inputs;
+    double quantity{1.0};
+};
+
+/**
+ * @brief Quantity-weighted value and risk of the trades on one underlying.
+ */
+struct UnderlyingRisk {
+    std::string underlying;
+    double value{};
+    double delta{};
+    double gamma{};
+    double vega{};
+};
+
+struct PortfolioResults {
+    std::vector<PricingResults> trades; // Per unit of quantity, in input order.
+    std::vector<UnderlyingRisk> byUnderlying; // Sorted by underlying name.
+    double totalValue{};
+    double totalVega{};
+    std::size_t simulations{}; // Number of Monte Carlo runs.
 };
 
-PricingResults priceAutocall(const PricingInputs& inputs);
+/**
+ * @brief Prices a whole book, sharing simulated paths between trades.
+ *
+ * Trades are grouped by everything that determines their paths (underlying,
+ * market quote, rate and curves, model and its parameters, observation grid,
+ * path count, seed and sampling settings) and by the settings of their run
+ * (Greek method, path cache, early termination, control variates). Each
+ * group is simulated once, with its base, vol-up and spot-up/down scenarios
+ * fused as in bump-and-revalue priceAutocall(), and every trade of the group
+ * is valued on those paths; trades asking for single-pass Greeks that their
+ * model supports are simulated one at a time instead. All simulations run on
+ * one shared thread pool of 'threads' workers (0 = all hardware threads).
+ * Each trade gets the same results as priceAutocall(), except with an
+ * adaptive path count, where a group runs until every one of its trades
+ * meets the target and so may use more paths than the trade would alone.
+ */
+PortfolioResults pricePortfolio(const std::vector<PortfolioTrade>& trades,
+                                std::size_t threads = 0);
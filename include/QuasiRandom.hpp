@@ -0,0 +1,127 @@
+// Quasi-Monte Carlo building blocks: Sobol points, scrambling and Brownian bridge.
+#pragma once
+
+#include "NormalStream.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+enum class SamplingMode { PseudoRandom, Sobol };
+
+/**
+ * @brief Randomization applied to the Sobol points.
+ *
+ * None: the raw sequence (deterministic, no error estimate).
+ * DigitalShift: XOR of every coordinate with a random 32-bit word.
+ * Owen: hash-based nested uniform scrambling (Burley 2020), which randomizes
+ * every digit conditionally on the previous ones.
+ */
+enum class QmcScrambling { None, DigitalShift, Owen };
+
+/**
+ * @brief Sobol low-discrepancy sequence (Antonov-Saleev Gray-code order).
+ *
+ * Direction numbers come from the Joe-Kuo "new-joe-kuo-6.21201" table for
+ * dimensions 1 to kMaxDimensions. Points are returned as 32-bit integers so
+ * scrambling can act on the digits before conversion to (0, 1).
+ */
+class SobolSequence {
+public:
+    static constexpr std::size_t kMaxDimensions = 37;
+    static constexpr std::size_t kBits = 32;
+
+    SobolSequence();
+
+    /**
+     * @brief Writes coordinate 'dim' of points first .. first + count - 1.
+     */
+    void coordinates(std::size_t dim, std::uint64_t first, std::size_t count,
+                     std::uint32_t* out) const;
+
+private:
+    // directions_[dim * kBits + k]: k-th direction number of dimension dim.
+    std::vector<std::uint32_t> directions_;
+};
+
+/**
+ * @brief Brownian bridge construction over an arbitrary time grid.
+ *
+ * Coordinate 0 fixes the terminal value, the next ones fill the midpoints of
+ * the largest remaining gaps. Feeding it the leading (best distributed)
+ * quasi-random coordinates concentrates the variance of path-dependent
+ * payoffs on them, which is what makes Sobol effective on long schedules.
+ */
+class BrownianBridge {
+public:
+    explicit BrownianBridge(const std::vector<double>& times);
+
+    std::size_t size() const { return bridgeIndex_.size(); }
+
+    /**
+     * @brief Maps bridge-ordered normals to standardized increments, for a whole block.
+     *
+     * @param z Input normals, z[c * paths + p] for bridge coordinate c.
+     * @param increments [out] increments[j * paths + p] = dW_j / sqrt(dt_j),
+     * again standard normal and independent across j.
+     * @param work Scratch buffer (resized to size() * paths).
+     */
+    void transform(const double* z, double* increments, std::size_t paths,
+                   std::vector<double>& work) const;
+
+private:
+    std::vector<double> times_;
+    std::vector<double> sqrtDt_;
+    std::vector<std::size_t> bridgeIndex_;
+    std::vector<std::size_t> leftIndex_;
+    std::vector<std::size_t> rightIndex_;
+    std::vector<double> leftWeight_;
+    std::vector<double> rightWeight_;
+    std::vector<double> stdDev_;
+};
+
+/**
+ * @brief Normal stream backed by scrambled Sobol points and a Brownian bridge.
+ *
+ * The bridge coordinates of all factors are interleaved (coordinate c of
+ * factor f uses Sobol dimension c * factors + f), so the terminal values and
+ * coarse midpoints of every factor get the leading dimensions. Coordinates
+ * beyond SobolSequence::kMaxDimensions are padded with pseudo-random normals
+ * from the Philox stream 'pad' (hybrid QMC). The whole block is generated up front into a
+ * per-thread buffer, so at most one instance may be live per thread.
+ */
+class QuasiRandomNormals : public NormalStream {
+public:
+    /**
+     * @param grid Brownian grid of the model.
+     * @param bridge Bridge built on grid.stepTimes.
+     * @param sobol Sobol generator.
+     * @param scrambling Randomization of the points.
+     * @param scrambleSeeds One 32-bit seed per Sobol dimension (ignored for None).
+     * @param firstPoint Index of the first Sobol point of this block.
+     * @param paths Number of paths in the block.
+     * @param pad Stream used for the coordinates past the Sobol dimensions.
+     */
+    QuasiRandomNormals(const BrownianGrid& grid,
+                       const BrownianBridge& bridge,
+                       const SobolSequence& sobol,
+                       QmcScrambling scrambling,
+                       const std::vector<std::uint32_t>& scrambleSeeds,
+                       std::uint64_t firstPoint,
+                       std::size_t paths,
+                       const PhiloxStream& pad);
+
+    void next(double* z, std::size_t count) override;
+
+private:
+    const double* increments_{nullptr};
+    std::size_t size_{0};
+    std::size_t offset_{0};
+};
+
+/**
+ * @brief Draws the per-dimension scrambling seeds of one RQMC replication.
+ */
+std::vector<std::uint32_t> makeScrambleSeeds(unsigned int seed,
+                                             std::size_t replication);
@@ -0,0 +1,53 @@
+// Numerically stable running mean and variance of a stream of samples.
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+/**
+ * @brief Count, mean and centred sum of squares of the samples seen so far.
+ *
+ * add() is Welford's update and merge() the pairwise combination of Chan,
+ * Golub and LeVeque, so partial statistics of blocks merged in a fixed order
+ * give reproducible results. Neither forms sum(x^2) - n mean^2, which loses
+ * its digits when the spread of the samples is small next to their mean.
+ */
+class RunningStats {
+public:
+    void add(double x) {
+        count_ += 1.0;
+        const double delta = x - mean_;
+        mean_ += delta / count_;
+        m2_ += delta * (x - mean_);
+    }
+
+    void merge(const RunningStats& other) {
+        if (other.count_ == 0.0) return;
+        if (count_ == 0.0) {
+            *this = other;
+            return;
+        }
+        const double count = count_ + other.count_;
+        const double delta = other.mean_ - mean_;
+        mean_ += delta * (other.count_ / count);
+        m2_ += other.m2_ + delta * delta * (count_ * other.count_ / count);
+        count_ = count;
+    }
+
+    double count() const { return count_; }
+    double mean() const { return mean_; }
+    double sum() const { return mean_ * count_; }
+
+    // Sample variance (n - 1 denominator); 0 below two samples.
+    double variance() const { return count_ > 1.0 ? m2_ / (count_ - 1.0) : 0.0; }
+
+    // Standard error of the mean; 0 below two samples.
+    double standardError() const {
+        return count_ > 1.0 ? std::sqrt(variance() / count_) : 0.0;
+    }
+
+private:
+    double count_{0.0};
+    double mean_{0.0};
+    double m2_{0.0};
+};
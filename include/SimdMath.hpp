@@ -0,0 +1,191 @@
+// Vectorized math kernels used by the path generators, with runtime CPU dispatch.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+/**
+ * @brief Instruction sets the kernels are compiled for.
+ *
+ * Every level evaluates the same polynomial/rational approximations in the same
+ * order (with fused multiply-adds), so results are bit-identical whichever
+ * level the dispatcher picks.
+ */
+enum class SimdLevel { Scalar, AVX2, AVX512 };
+
+/**
+ * @brief Widest level supported by both this build and the running CPU.
+ *
+ * Detected once. Setting the environment variable PRICER_SIMD to "scalar",
+ * "avx2" or "avx512" caps the level (useful for benchmarks and debugging).
+ */
+SimdLevel activeSimdLevel();
+
+const char* simdLevelName(SimdLevel level);
+
+/**
+ * @brief out[i] = base[i] * exp(a + b * z[i]) for i in [0, n).
+ *
+ * This is the log-Euler spot update of every path model. 'out' may alias 'base'.
+ */
+void scaledExp(const double* base, const double* z, double a, double b,
+               double* out, std::size_t n);
+
+/**
+ * @brief Constants of one full-truncation Euler Heston substep (see HestonMC).
+ *
+ * Everything that depends only on the time grid and the model parameters is
+ * folded in here, so the per-path work is a handful of fused multiply-adds, a
+ * square root and an exp.
+ */
+struct HestonStepConstants {
+    double kappaDt;     // kappa * dt
+    double theta;       // long-term variance
+    double xiSqrtDt;    // xi * sqrt(dt)
+    double rho;         // spot/variance correlation
+    double rhoBar;      // sqrt(1 - rho^2)
+    double rDt;         // r * dt
+    double minusHalfDt; // -0.5 * dt
+    double sqrtDt;      // sqrt(dt)
+};
+
+/**
+ * @brief Advances n (spot, variance) pairs by one full-truncation Euler substep.
+ *
+ * With v+ = max(v, 0):
+ *   v    += kappa (theta - v+) dt + xi sqrt(v+) sqrt(dt) (rho z1 + rhoBar z2)
+ *   spot *= exp((r - v+/2) dt + sqrt(v+) sqrt(dt) z1)
+ */
+void hestonEulerStep(double* spot, double* variance, const double* z1,
+                     const double* z2, const HestonStepConstants& c,
+                     std::size_t n);
+
+/**
+ * @brief Constants of one Andersen quadratic-exponential Heston step.
+ *
+ * The variance moves to a draw matched to the first two conditional moments
+ * of the CIR transition, m = theta + (v - theta) decay and
+ * s^2 = v s2PerV + s2Const. The log-spot uses the central discretization of
+ * the integrated variance, with K0 replaced path by path by the martingale
+ * correction so that E[S(t + dt)] = S(t) exp(rDt) exactly.
+ */
+struct HestonQeStepConstants {
+    double decay;         // exp(-kappa dt)
+    double theta;         // long-term variance
+    double s2PerV;        // xi^2 decay (1 - decay) / kappa
+    double s2Const;       // theta xi^2 (1 - decay)^2 / (2 kappa)
+    double k0;            // -rho kappa theta dt / xi
+    double k1;            // dt/2 (kappa rho / xi - 1/2) - rho / xi
+    double k2;            // dt/2 (kappa rho / xi - 1/2) + rho / xi
+    double k3;            // dt/2 (1 - rho^2)
+    double rDt;           // r * dt
+};
+
+/**
+ * @brief Advances n (spot, variance) pairs by one QE step.
+ *
+ * z1 drives the spot, z2 the variance: its normal quantile in the quadratic
+ * regime (psi = s^2 / m^2 <= 1.5), its uniform Phi(z2) in the exponential
+ * one. Scalar only: the exponential regime needs log and the normal CDF per
+ * lane, and the step count it saves dwarfs the lane width.
+ */
+void hestonQeStep(double* spot, double* variance, const double* z1,
+                  const double* z2, const HestonQeStepConstants& c,
+                  std::size_t n);
+
+/**
+ * @brief One substep of the local-vol Euler scheme (see LocalVolMC).
+ *
+ * 'vols' is the local-vol row of the substep's time, sampled at the uniform
+ * log-moneyness nodes x0 + j / invDx, j in [0, nodes), nodes >= 2.
+ */
+struct LocalVolStepConstants {
+    const double* vols;
+    std::size_t nodes;
+    double x0;
+    double invDx;
+    double minusHalfDt; // -0.5 * dt
+    double sqrtDt;      // sqrt(dt)
+};
+
+/**
+ * @brief Advances n log-moneyness values x by one local-vol Euler substep.
+ *
+ * sigma = linear interpolation of the row at x (held flat outside the grid),
+ *   x += -sigma^2 dt / 2 + sigma sqrt(dt) z
+ * The row lookups are vector gathers on the AVX2/AVX-512 levels.
+ */
+void localVolStep(double* x, const double* z, const LocalVolStepConstants& c,
+                  std::size_t n);
+
+/**
+ * @brief Correlates 'factors' rows of n independent normals in place.
+ *
+ * z holds the rows factor-major (z[f * n + p]); 'lower' is the row-major
+ * lower-triangular Cholesky factor L of the correlation matrix. Afterwards
+ * row i holds sum_{k <= i} L[i][k] * z_k, so the work per path is one fused
+ * multiply-add per non-zero entry of L, run across paths in vector lanes.
+ */
+void correlateNormals(const double* lower, std::size_t factors, double* z,
+                      std::size_t n);
+
+/**
+ * @brief z[i] = inverse standard normal CDF of u[i], u[i] in (0, 1).
+ *
+ * Acklam's rational approximation (relative error below 1.2e-9). The central
+ * region is evaluated in vector registers; the rare tail lanes (about 5%) fall
+ * back on a scalar log/sqrt. 'z' may alias 'u'.
+ */
+void inverseNormal(const double* u, double* z, std::size_t n);
+
+/**
+ * @brief Draws n standard normals from 'rng'.
+ *
+ * Two 32-bit outputs are combined into one 53-bit uniform in (0, 1), which is
+ * then mapped through inverseNormal(). Unlike std::normal_distribution this has
+ * no rejection loop and consumes exactly 2 * n engine outputs.
+ */
+void fillStandardNormals(std::mt19937& rng, double* z, std::size_t n);
+
+/**
+ * @brief One Philox4x32-10 counter-based random stream (Salmon et al. 2011).
+ *
+ * Output c of the stream is ten rounds of multiply/xor over the 128-bit
+ * counter (c, stream) under 'key'. Nothing carries over from one output to
+ * the next, so any position is reached in O(1), any split of the work
+ * reproduces the same numbers, and the kernel runs one counter per vector
+ * lane (8 on AVX2, 16 on AVX-512, bit-identical to the scalar flavour).
+ */
+struct PhiloxStream {
+    std::uint32_t key[2];
+    std::uint64_t stream;
+};
+
+/**
+ * @brief The raw Philox4x32-10 blocks of 'stream' at counters[i].
+ *
+ * The input block is (counter low, counter high, stream low, stream high)
+ * 32-bit words under 'key'; word j of output block i goes to words[j * n + i].
+ * The normal fills below are built on it; it is exposed for known-answer
+ * tests against the Random123 vectors.
+ */
+void philoxWords(const PhiloxStream& stream, const std::uint64_t* counters, std::size_t n,
+                 std::uint32_t* words);
+
+/**
+ * @brief z[i] = standard normal number first + i of 'stream'.
+ *
+ * Counter c supplies normals 2c and 2c + 1, one 53-bit uniform from each
+ * 64-bit half of its output, mapped through inverseNormal(): no rejection
+ * and no branches on the random bits.
+ */
+void fillPhiloxNormals(const PhiloxStream& stream, std::uint64_t first, double* z,
+                       std::size_t n);
+
+/**
+ * @brief z[i] = standard normal number positions[i] of 'stream', i.e. the
+ * value fillPhiloxNormals() puts at that position.
+ */
+void gatherPhiloxNormals(const PhiloxStream& stream, const std::uint64_t* positions,
+                         double* z, std::size_t n);
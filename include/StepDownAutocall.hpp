@@ -33,9 +33,13 @@ public:
    * - If yes -> Pay Notional + Coupon & Terminate.
    *
    * @param path Simulated price path.
-   * @return std::vector<CashFlow> List of cash flows.
+   * @param sink Receives each flow with the index of its payment date.
    */
-  std::vector<CashFlow> cashFlows(const std::vector<double> &path) const override;
+  void emitCashFlows(const std::vector<double> &path,
+                     CashFlowSink &sink) const override;
+
+protected:
+  double callBarrierAt(std::size_t i) const override;
 
 private:
   std::vector<double> callBarriers_;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -9,6 +10,16 @@ struct CashFlow {
     double time;
 };
 
+// Receives the cash flows of one path as the payoff generates them. Flows are
+// addressed by the index of their payment date in observationTimes(), so a
+// sink can look up precomputed per-date data (e.g. discount factors) instead
+// of working from raw times. An index past the last date means "paid now".
+class CashFlowSink {
+public:
+    virtual ~CashFlowSink() = default;
+    virtual void onCashFlow(std::size_t dateIndex, double amount) = 0;
+};
+
 class StructuredProduct {
 public:
     StructuredProduct(std::string underlying,
@@ -19,14 +30,85 @@ public:
     virtual ~StructuredProduct() = default;
 
     // NEW SIGNATURE: Returns a list of cash flows instead of a single discounted double
-    virtual std::vector<CashFlow> cashFlows(const std::vector<double> &path) const = 0;
+    std::vector<CashFlow> cashFlows(const std::vector<double> &path) const {
+        std::vector<CashFlow> flows;
+        fillCashFlows(path, flows);
+        return flows;
+    }
+
+    // Clears 'flows' and refills it, reusing the buffer's capacity. Used for
+    // reporting and charting; the Monte Carlo engine streams into a sink.
+    void fillCashFlows(const std::vector<double> &path,
+                       std::vector<CashFlow> &flows) const;
+
+    // Hot-loop variant: sends each flow of 'path' to 'sink', in payment
+    // order, without building any container.
+    virtual void emitCashFlows(const std::vector<double> &path,
+                               CashFlowSink &sink) const = 0;
+
+    // True when the payoff is Lipschitz-continuous in the path (no digital
+    // triggers), so single-pass Greeks may differentiate it pathwise.
+    virtual bool hasContinuousPayoff() const { return false; }
+
+    // Early termination (autocalls): true when a path whose spot at date
+    // 'dateIndex' is 'spot' ends there, i.e. emitCashFlows() reads no later
+    // date. The engine uses it to stop simulating finished paths.
+    virtual bool canTerminateEarly() const { return false; }
+    virtual bool isTerminated(std::size_t dateIndex, double spot) const {
+        (void)dateIndex; (void)spot;
+        return false;
+    }
+
+    // Levels the payoff switches at, read by the engine's analytic control
+    // variates (see ControlVariates.hpp); 0 when the product has none. The
+    // capital is at risk when the final spot ends below capitalBarrier(),
+    // losing in proportion to capitalStrike() - S_T.
+    virtual double callLevel(std::size_t dateIndex) const {
+        (void)dateIndex;
+        return 0.0;
+    }
+    virtual double capitalBarrier() const { return 0.0; }
+    virtual double capitalStrike() const { return 0.0; }
+
+    // Face amount the payoff is quoted on, which scales the engine's
+    // redemption histogram (see RedemptionProfile); 0 when there is none.
+    virtual double notional() const { return 0.0; }
 
     const std::vector<double> &observationTimes() const {
         return observationTimes_;
     }
     const std::string &underlying() const { return underlying_; }
 
+protected:
+    // Index of the last observation date, where maturity flows are paid.
+    std::size_t maturityIndex() const {
+        return observationTimes_.empty() ? 0 : observationTimes_.size() - 1;
+    }
+
 private:
     std::string underlying_;
     std::vector<double> observationTimes_;
-};
\ No newline at end of file
+};
+
+inline void StructuredProduct::fillCashFlows(const std::vector<double> &path,
+                                             std::vector<CashFlow> &flows) const {
+    // Maps date indices back to payment times.
+    class Collector : public CashFlowSink {
+    public:
+        Collector(const std::vector<double> &times, std::vector<CashFlow> &flows)
+            : times_(times), flows_(flows) {}
+
+        void onCashFlow(std::size_t dateIndex, double amount) override {
+            const double time = dateIndex < times_.size() ? times_[dateIndex] : 0.0;
+            flows_.push_back({amount, time});
+        }
+
+    private:
+        const std::vector<double> &times_;
+        std::vector<CashFlow> &flows_;
+    };
+
+    flows.clear();
+    Collector collector(observationTimes_, flows);
+    emitCashFlows(path, collector);
+}
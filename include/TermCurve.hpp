@@ -0,0 +1,52 @@
+// Piecewise term structure (zero rates, dividend yields, implied vols).
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A term structure given by pillar values, read as averages over [0, t].
+ *
+ * values[i] is the average of the curve's instantaneous (forward) quantity up
+ * to times[i]: a zero rate for a discount curve, a continuous yield for
+ * dividends/repo, a squared implied vol for variance. The integral value(t) * t
+ * is interpolated linearly between pillars, i.e. forwards are flat between
+ * pillars; before the first and after the last pillar the average is held flat.
+ * A curve built from one number is flat everywhere and reproduces the constant
+ * case exactly.
+ */
+class TermCurve {
+public:
+    TermCurve() = default;
+    explicit TermCurve(double flatValue);
+
+    /**
+     * @throws std::invalid_argument if the vectors are empty, differ in size,
+     * or the times are not positive and strictly increasing.
+     */
+    TermCurve(std::vector<double> times, std::vector<double> values);
+
+    bool isFlat() const { return times_.empty(); }
+    const std::vector<double>& times() const { return times_; }
+    const std::vector<double>& values() const { return values_; }
+
+    // Average over [0, t] (the zero rate / implied vol convention).
+    double value(double t) const;
+    // Integral over [0, t] of the forward quantity: value(t) * t.
+    double integral(double t) const;
+    // Average forward over [t0, t1]; the instantaneous forward when t1 <= t0.
+    double forward(double t0, double t1) const;
+
+    // Same pillars, every value moved by 'amount' (parallel bump).
+    TermCurve shifted(double amount) const;
+    // Same pillars, every value squared (implied vols -> variances).
+    TermCurve squared() const;
+
+    // Exact textual identity of the curve, for cache keys.
+    std::string key() const;
+
+private:
+    std::vector<double> times_;    // Empty for a flat curve.
+    std::vector<double> values_;   // values_[0] is the flat value.
+};
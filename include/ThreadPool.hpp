@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size fork/join thread pool used by the Monte Carlo engines.
+ *
+ * The pool keeps (size - 1) worker threads alive; the calling thread joins in
+ * as the last worker during parallelFor(). Tasks are identified by an index and
+ * pulled from a shared atomic counter, so callers that need deterministic
+ * results must make each task's output depend on its index only.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Constructor.
+     * @param threads Total number of threads (including the caller). 0 = use all hardware threads.
+     */
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Runs task(0) ... task(taskCount - 1) and blocks until all are done.
+     *
+     * The first exception thrown by a task stops the remaining tasks and is
+     * rethrown on the calling thread. Not reentrant: a task must not call
+     * parallelFor() on the same pool.
+     */
+    void parallelFor(std::size_t taskCount,
+                     const std::function<void(std::size_t)>& task);
+
+    std::size_t size() const { return workers_.size() + 1; }
+
+    // Maps a user-facing thread count (0 = auto) to an actual thread count.
+    static std::size_t resolveThreadCount(std::size_t requested);
+
+private:
+    void workerLoop();
+    void drain();
+
+    std::vector<std::thread> workers_;
+    std::mutex runMutex_; // Serializes concurrent parallelFor() callers.
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    const std::function<void(std::size_t)>* task_{nullptr};
+    std::size_t taskCount_{0};
+    std::atomic<std::size_t> next_{0};
+    std::size_t busy_{0};
+    std::uint64_t generation_{0};
+    bool stopping_{false};
+    std::exception_ptr error_;
+};
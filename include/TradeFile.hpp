@@ -0,0 +1,99 @@
+// CSV readers/writers for headless batch pricing (trades, market, results).
+#pragma once
+
+#include "PricerRunner.hpp"
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Market state and model of one underlying, as read from a market file.
+ */
+struct UnderlyingMarket {
+    double spot{0.0};
+    double sigma{0.20};
+    double rate{0.0};
+    ModelType model{ModelType::BlackScholes};
+    double hestonV0{0.04};
+    double hestonKappa{1.5};
+    double hestonTheta{0.04};
+    double hestonXi{0.5};
+    double hestonRho{-0.5};
+    HestonScheme hestonScheme{HestonScheme::Euler};
+    double hestonMaxStep{kHestonDefaultMaxStep};
+    std::vector<double> curveTimes; // Pillars shared by the curves below.
+    std::vector<double> rateCurve;
+    std::vector<double> dividendCurve;
+    std::vector<double> volCurve;
+    // Implied vol surface of the local-vol model (see PricingInputs).
+    std::vector<double> surfaceExpiries;
+    std::vector<double> surfaceMoneyness;
+    std::vector<double> surfaceVols;
+    bool calibrate{false}; // Fit sigma or the Heston parameters to the surface.
+};
+
+using MarketFile = std::map<std::string, UnderlyingMarket>;
+
+/**
+ * @brief A trade read from a trade file, with its identifier.
+ */
+struct TradeRecord {
+    std::string id;
+    PortfolioTrade trade;
+};
+
+/**
+ * @brief Reads a market CSV file.
+ *
+ * Header row required. Columns: underlying, spot, sigma, rate (mandatory) and
+ * model (bs|heston|localvol), v0, kappa, theta, xi, rho (optional, Heston
+ * defaults of PricingInputs when absent), scheme (euler|qe) and step (the
+ * largest Heston substep in years). Term structures are optional too:
+ * curve_times (';'-separated pillars in years) with any of zero_rates,
+ * dividend_yields and vols, each holding one ';'-separated value per pillar.
+ * The local-vol surface is given by surface_expiries, surface_moneyness
+ * (ln(K / F)) and surface_vols (row-major, one row per expiry); without it
+ * the surface is flat at sigma. A non-zero calibrate replaces sigma (bs) or
+ * the Heston parameters (heston, the given ones being the initial guess) by
+ * their fit to that surface, which it then requires.
+ *
+ * @throws std::runtime_error on I/O or format errors (with the line number).
+ */
+MarketFile readMarketFile(const std::string& path);
+MarketFile readMarketCsv(std::istream& in, const std::string& source);
+
+/**
+ * @brief Reads a trade CSV file and attaches each trade's market from 'market'.
+ *
+ * Header row required. Mandatory columns: id, underlying, family
+ * (autocall|cliquet), type (simple|phoenix|memory_phoenix|step_down|airbag or
+ * max_return|capped_coupons), times (';'-separated years). Optional columns:
+ * quantity, notional, coupon, autocall_barrier, protection_barrier,
+ * coupon_barrier, call_barriers (';'-separated), airbag_floor, participation,
+ * cap, spread. Missing optional values keep the PricingInputs defaults, and
+ * coupon_barrier defaults to autocall_barrier.
+ *
+ * An underlying given as a ';'-separated list makes a basket trade, priced
+ * with correlated Black-Scholes on each asset's sigma or vol curve and its
+ * dividend curve (the first asset supplies the rate and rate curve). A
+ * capped_coupons cliquet then reads the worst (best, average) of the assets'
+ * period returns. Its barriers are levels of reference_level (default 100)
+ * times the basket performance; basket is worst_of (default), best_of or
+ * average, and correlation is one pairwise value or the full row-major matrix
+ * (default 0).
+ *
+ * @throws std::runtime_error on I/O or format errors, or on an underlying
+ * missing from 'market'.
+ */
+std::vector<TradeRecord> readTradeFile(const std::string& path, const MarketFile& market);
+std::vector<TradeRecord> readTradeCsv(std::istream& in, const std::string& source,
+                                      const MarketFile& market);
+
+/**
+ * @brief Writes one CSV row per trade: id, price, std error and Greeks, bid/ask
+ * the number of paths used and the expected life in years.
+ */
+void writeResultsCsv(std::ostream& out, const std::vector<TradeRecord>& trades,
+                     const PortfolioResults& results);
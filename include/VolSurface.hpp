@@ -0,0 +1,65 @@
+// Implied volatility surface (expiry x log-moneyness) for local-vol calibration.
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Implied vols quoted on a grid of expiries and forward log-moneyness.
+ *
+ * Each expiry's smile is a natural cubic spline in k = ln(K / F(T)), held flat
+ * beyond the first and last strike. Between expiries the total variance
+ * w = sigma^2 T is interpolated linearly in T at fixed k; before the first
+ * expiry the first smile applies, after the last one the last smile. A surface
+ * with a single vol is flat and gives the Black-Scholes dynamics.
+ */
+class ImpliedVolSurface {
+public:
+    // Total variance and its derivatives at one (T, k) point.
+    struct Point {
+        double w;   // sigma^2 T
+        double dwdT;
+        double dwdk;
+        double d2wdk2;
+    };
+
+    // Flat surface at 'sigma'.
+    explicit ImpliedVolSurface(double sigma = 0.2);
+
+    /**
+     * @param expiries Strictly increasing positive expiries (years).
+     * @param logMoneyness Strictly increasing strikes k = ln(K / F).
+     * @param vols Row-major [expiry][strike] implied vols.
+     * @throws std::invalid_argument on inconsistent sizes, unordered axes,
+     *         non-positive vols or decreasing total variance (calendar arbitrage).
+     */
+    ImpliedVolSurface(std::vector<double> expiries, std::vector<double> logMoneyness,
+                      std::vector<double> vols);
+
+    const std::vector<double>& expiries() const { return expiries_; }
+    const std::vector<double>& logMoneyness() const { return strikes_; }
+    const std::vector<double>& vols() const { return vols_; }
+
+    double vol(double T, double k) const;
+    Point totalVariance(double T, double k) const;
+
+    double lastExpiry() const { return expiries_.back(); }
+    double maxVol() const;
+
+    // Same axes, every vol moved by 'amount' (parallel vega bump).
+    ImpliedVolSurface shifted(double amount) const;
+
+    // Exact textual identity of the surface, for cache keys.
+    std::string key() const;
+
+private:
+    // Vol and its first two k-derivatives on the smile of expiry i.
+    void smile(std::size_t i, double k, double& v, double& dv, double& d2v) const;
+    void buildSplines();
+
+    std::vector<double> expiries_;
+    std::vector<double> strikes_;
+    std::vector<double> vols_;
+    std::vector<double> curvature_; // Spline second derivatives, like vols_.
+};
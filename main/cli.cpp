@@ -0,0 +1,209 @@
+// Headless batch pricer: reads trade and market CSV files, prices the book on
+// the parallel Monte Carlo engine and writes one result row per trade.
+#include "PricerRunner.hpp"
+#include "TradeFile.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+struct CliOptions {
+  std::string tradesPath;
+  std::string marketPath;
+  std::string outPath; // Empty = stdout.
+  std::size_t paths{PricingInputs{}.paths};
+  unsigned int seed{PricingInputs{}.seed};
+  std::size_t threads{0};
+  SamplingMode sampling{SamplingMode::PseudoRandom};
+  NormalScheme normals{NormalScheme::Independent};
+  bool controlVariates{false};
+  double targetStdError{0.0};
+  double targetRelativeError{0.0};
+  double timeBudgetSeconds{0.0};
+  std::size_t batchPaths{PricingInputs{}.batchPaths};
+  bool quiet{false};
+};
+
+void printUsage(std::ostream &out) {
+  out << "Usage: pricer_cli --trades FILE --market FILE [options]\n"
+         "\n"
+         "Options:\n"
+         "  --out FILE         Result CSV (default: stdout)\n"
+         "  --paths N          Monte Carlo paths per trade (default 20000); the\n"
+         "                     most an adaptive run simulates\n"
+         "  --seed N           Random seed (default 1337)\n"
+         "  --threads N        Worker threads, 0 = all cores (default 0)\n"
+         "  --sampling MODE    pseudo | sobol (default pseudo)\n"
+         "  --normals MODE     independent | antithetic | moment-matched\n"
+         "                     (pseudo only, default independent)\n"
+         "  --control-variates Regress prices on analytic proxies (pseudo only)\n"
+         "  --target-se X      Stop once the std error is at most X\n"
+         "  --target-rel X     Stop once the std error is at most X * |price|\n"
+         "  --time-budget S    Stop each simulation after the batch that ends\n"
+         "                     past S seconds\n"
+         "  --batch N          Paths per batch of an adaptive run (default 16384)\n"
+         "  --quiet            No risk summary on stderr\n"
+         "  --help             Show this message\n";
+}
+
+std::size_t parseCount(const std::string &flag, const std::string &value) {
+  try {
+    std::size_t used = 0;
+    const unsigned long long parsed = std::stoull(value, &used);
+    if (used == value.size()) {
+      return static_cast<std::size_t>(parsed);
+    }
+  } catch (const std::exception &) {
+  }
+  throw std::invalid_argument("invalid value '" + value + "' for " + flag);
+}
+
+double parseNonNegative(const std::string &flag, const std::string &value) {
+  try {
+    std::size_t used = 0;
+    const double parsed = std::stod(value, &used);
+    if (used == value.size() && parsed >= 0.0) {
+      return parsed;
+    }
+  } catch (const std::exception &) {
+  }
+  throw std::invalid_argument("invalid value '" + value + "' for " + flag);
+}
+
+CliOptions parseArguments(int argc, char **argv) {
+  CliOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string flag = argv[i];
+    if (flag == "--help" || flag == "-h") {
+      printUsage(std::cout);
+      std::exit(EXIT_SUCCESS);
+    }
+    if (flag == "--quiet") {
+      options.quiet = true;
+      continue;
+    }
+    if (flag == "--control-variates") {
+      options.controlVariates = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      throw std::invalid_argument("missing value for " + flag);
+    }
+    const std::string value = argv[++i];
+    if (flag == "--trades") {
+      options.tradesPath = value;
+    } else if (flag == "--market") {
+      options.marketPath = value;
+    } else if (flag == "--out") {
+      options.outPath = value;
+    } else if (flag == "--paths") {
+      options.paths = parseCount(flag, value);
+    } else if (flag == "--seed") {
+      options.seed = static_cast<unsigned int>(parseCount(flag, value));
+    } else if (flag == "--threads") {
+      options.threads = parseCount(flag, value);
+    } else if (flag == "--target-se") {
+      options.targetStdError = parseNonNegative(flag, value);
+    } else if (flag == "--target-rel") {
+      options.targetRelativeError = parseNonNegative(flag, value);
+    } else if (flag == "--time-budget") {
+      options.timeBudgetSeconds = parseNonNegative(flag, value);
+    } else if (flag == "--batch") {
+      options.batchPaths = parseCount(flag, value);
+    } else if (flag == "--sampling") {
+      if (value == "pseudo") {
+        options.sampling = SamplingMode::PseudoRandom;
+      } else if (value == "sobol") {
+        options.sampling = SamplingMode::Sobol;
+      } else {
+        throw std::invalid_argument("unknown sampling '" + value + "'");
+      }
+    } else if (flag == "--normals") {
+      if (value == "independent") {
+        options.normals = NormalScheme::Independent;
+      } else if (value == "antithetic") {
+        options.normals = NormalScheme::Antithetic;
+      } else if (value == "moment-matched") {
+        options.normals = NormalScheme::MomentMatched;
+      } else {
+        throw std::invalid_argument("unknown normals '" + value + "'");
+      }
+    } else {
+      throw std::invalid_argument("unknown option " + flag);
+    }
+  }
+  if (options.tradesPath.empty() || options.marketPath.empty()) {
+    throw std::invalid_argument("--trades and --market are required");
+  }
+  return options;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  CliOptions options;
+  try {
+    options = parseArguments(argc, argv);
+  } catch (const std::exception &error) {
+    std::cerr << "pricer_cli: " << error.what() << "\n\n";
+    printUsage(std::cerr);
+    return 2;
+  }
+
+  try {
+    const MarketFile market = readMarketFile(options.marketPath);
+    std::vector<TradeRecord> records = readTradeFile(options.tradesPath, market);
+
+    std::vector<PortfolioTrade> book;
+    book.reserve(records.size());
+    for (TradeRecord &record : records) {
+      record.trade.inputs.paths = options.paths;
+      record.trade.inputs.seed = options.seed;
+      record.trade.inputs.sampling = options.sampling;
+      record.trade.inputs.normalScheme = options.normals;
+      record.trade.inputs.controlVariates = options.controlVariates;
+      record.trade.inputs.targetStdError = options.targetStdError;
+      record.trade.inputs.targetRelativeError = options.targetRelativeError;
+      record.trade.inputs.timeBudgetSeconds = options.timeBudgetSeconds;
+      record.trade.inputs.batchPaths = options.batchPaths;
+      book.push_back(record.trade);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const PortfolioResults results = pricePortfolio(book, options.threads);
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+
+    if (options.outPath.empty()) {
+      writeResultsCsv(std::cout, records, results);
+    } else {
+      std::ofstream out(options.outPath);
+      if (!out) {
+        throw std::runtime_error("Cannot write " + options.outPath);
+      }
+      writeResultsCsv(out, records, results);
+    }
+
+    if (!options.quiet) {
+      std::cerr << "Priced " << records.size() << " trades in "
+                << results.simulations << " simulations, " << seconds
+                << " s\n";
+      for (const UnderlyingRisk &risk : results.byUnderlying) {
+        std::cerr << "  " << risk.underlying << ": value " << risk.value
+                  << ", delta " << risk.delta << ", gamma " << risk.gamma
+                  << ", vega " << risk.vega << '\n';
+      }
+      std::cerr << "  Total: value " << results.totalValue << ", vega "
+                << results.totalVega << '\n';
+    }
+  } catch (const std::exception &error) {
+    std::cerr << "pricer_cli: " << error.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
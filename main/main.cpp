@@ -3,6 +3,7 @@
 #include "CliquetMaxReturn.hpp"
 #include "InputUtils.hpp"
 #include "MemoryPhoenixAutocall.hpp"
+#include "MonteCarloEngine.hpp"
 #include "PhoenixAutocall.hpp"
 #include "PricerRunner.hpp"
 #include "SimpleAutocall.hpp"
@@ -10,6 +11,7 @@
 #include "StructuredProduct.hpp"
 
 #include <QApplication>
+#include <QCheckBox>
 #include <QCloseEvent>
 #include <QComboBox>
 #include <QFormLayout>
@@ -20,12 +22,14 @@
 #include <QLayout>
 #include <QLineEdit>
 #include <QMessageBox>
+#include <QMetaObject>
 #include <QPen>
 #include <QPushButton>
 #include <QScrollArea>
 #include <QSettings>
 #include <QSizePolicy>
 #include <QString>
+#include <QThread>
 #include <QVBoxLayout>
 #include <QWidget>
 #include <QtCharts/QAbstractAxis>
@@ -36,25 +40,59 @@
 #include <QtCharts/QValueAxis>
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
+// One background pricing: carries the cancel flag the engine's workers poll
+// and forwards its progress reports to the window.
+class PricingRun : public MonteCarloObserver {
+public:
+  using ProgressCallback = std::function<void(
+      std::size_t pathsDone, std::size_t paths, const MonteCarloEstimate &price)>;
+
+  explicit PricingRun(ProgressCallback progress)
+      : progress_(std::move(progress)) {}
+
+  void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+  bool cancelled() const override {
+    return cancelled_.load(std::memory_order_relaxed);
+  }
+
+  void onProgress(std::size_t pathsDone, std::size_t paths,
+                  const MonteCarloEstimate &price) override {
+    progress_(pathsDone, paths, price);
+  }
+
+private:
+  ProgressCallback progress_;
+  std::atomic<bool> cancelled_{false};
+};
+
 // Minimal Qt window: handles user inputs, instantiates the chosen
-// product/model, runs pricing via PricerRunner, and renders a simple payoff
-// chart.
+// product/model, runs pricing via PricerRunner on a background thread (the
+// price and its error converge in the labels as blocks of paths finish), and
+// renders a simple payoff chart.
 class PricerWindow : public QWidget {
   Q_OBJECT
 
 public:
   PricerWindow(QWidget *parent = nullptr);
+  ~PricerWindow() override;
 
 protected:
   void closeEvent(QCloseEvent *event) override;
 
 private slots:
   void handlePrice();
+  void cancelPricing();
+  void dropStaleRun();
 
 private:
   static QString doubleToQString(double value);
@@ -66,6 +104,12 @@ private:
   unsigned int readUInt(QLineEdit *edit, unsigned int fallback) const;
 
   void updateResults(const PricingResults &results);
+  void showProgress(std::uint64_t generation, std::size_t pathsDone,
+                    std::size_t paths, const MonteCarloEstimate &price);
+  void finishPricing(std::uint64_t generation, const PricingResults &results);
+  void failPricing(std::uint64_t generation, const QString &message);
+  void setRunning(bool running);
+  void stopWorkers();
   void showError(const QString &message);
   PricingInputs gatherInputs() const;
   void updatePayoffChart();
@@ -78,6 +122,12 @@ private:
   void saveSettings() const;
 
   PricingInputs defaults_;
+  // The run the labels follow. Every new or abandoned run bumps generation_,
+  // so reports from older workers, still unwinding, are ignored.
+  std::shared_ptr<PricingRun> run_;
+  std::uint64_t generation_{0};
+  std::vector<QThread *> workers_;
+
   QWidget *inputContainer_{};
   QScrollArea *inputScroll_{};
 
@@ -97,6 +147,11 @@ private:
   QLineEdit *timesEdit_{};
   QLineEdit *pathsEdit_{};
   QLineEdit *seedEdit_{};
+  QComboBox *samplingCombo_{};
+  QComboBox *normalsCombo_{};
+  QComboBox *greeksCombo_{};
+  QComboBox *hestonSchemeCombo_{};
+  QCheckBox *controlVariatesCheck_{};
   QLineEdit *spreadEdit_{};
   QLineEdit *airbagEdit_{};
   QLineEdit *cliquetParticipationEdit_{};
@@ -106,13 +161,20 @@ private:
   QLineEdit *hestonThetaEdit_{};
   QLineEdit *hestonXiEdit_{};
   QLineEdit *hestonRhoEdit_{};
+  QLineEdit *hestonStepEdit_{};
 
+  QPushButton *priceButton_{};
+  QPushButton *cancelButton_{};
+  QLabel *progressLabel_{};
   QLabel *priceLabel_{};
   QLabel *stdErrorLabel_{};
   QLabel *deltaLabel_{};
+  QLabel *gammaLabel_{};
   QLabel *vegaLabel_{};
   QLabel *bidLabel_{};
   QLabel *askLabel_{};
+  QLabel *lifeLabel_{};
+  QLabel *redemptionLabel_{};
   QLabel *chartLabel_{};
   QChartView *chartView_{};
 
@@ -135,6 +197,8 @@ private:
   QWidget *hestonThetaLabel_{};
   QWidget *hestonXiLabel_{};
   QWidget *hestonRhoLabel_{};
+  QWidget *hestonSchemeLabel_{};
+  QWidget *hestonStepLabel_{};
 
   void updateProductSpecificFields();
 };
@@ -175,6 +239,7 @@ PricerWindow::PricerWindow(QWidget *parent) : QWidget(parent) {
   modelCombo_ = new QComboBox();
   modelCombo_->addItem("Black-Scholes");
   modelCombo_->addItem("Heston");
+  modelCombo_->addItem("Local Vol (flat surface at sigma)");
   spotEdit_ = new QLineEdit(doubleToQString(defaults_.spot));
   volEdit_ = new QLineEdit(doubleToQString(defaults_.sigma));
   rateEdit_ = new QLineEdit(doubleToQString(defaults_.rate));
@@ -189,6 +254,17 @@ PricerWindow::PricerWindow(QWidget *parent) : QWidget(parent) {
       QString::fromStdString(vectorToString(defaults_.observationTimes)));
   pathsEdit_ = new QLineEdit(sizeToQString(defaults_.paths));
   seedEdit_ = new QLineEdit(uintToQString(defaults_.seed));
+  samplingCombo_ = new QComboBox();
+  samplingCombo_->addItem("Pseudo-random");
+  samplingCombo_->addItem("Sobol (Owen-scrambled RQMC)");
+  normalsCombo_ = new QComboBox();
+  normalsCombo_->addItem("Independent");
+  normalsCombo_->addItem("Antithetic pairs");
+  normalsCombo_->addItem("Moment matched");
+  greeksCombo_ = new QComboBox();
+  greeksCombo_->addItem("Bump and revalue");
+  greeksCombo_->addItem("Single pass (pathwise / LR)");
+  controlVariatesCheck_ = new QCheckBox("Analytic control variates (pseudo-random)");
   spreadEdit_ = new QLineEdit(doubleToQString(defaults_.spreadFraction));
 
   generalForm->addRow("Product family", familyCombo_);
@@ -206,6 +282,10 @@ PricerWindow::PricerWindow(QWidget *parent) : QWidget(parent) {
   generalForm->addRow("Observation times", timesEdit_);
   generalForm->addRow("MC paths", pathsEdit_);
   generalForm->addRow("Seed", seedEdit_);
+  generalForm->addRow("Sampling", samplingCombo_);
+  generalForm->addRow("Normals (pseudo-random)", normalsCombo_);
+  generalForm->addRow("Greeks", greeksCombo_);
+  generalForm->addRow("Variance reduction", controlVariatesCheck_);
   generalForm->addRow("Spread (fraction)", spreadEdit_);
   leftLayout->addWidget(generalGroup);
 
@@ -257,28 +337,49 @@ PricerWindow::PricerWindow(QWidget *parent) : QWidget(parent) {
   hestonXiLabel_ = modelLayout_->labelForField(hestonXiEdit_);
   modelLayout_->addRow("Heston rho", hestonRhoEdit_);
   hestonRhoLabel_ = modelLayout_->labelForField(hestonRhoEdit_);
+  hestonSchemeCombo_ = new QComboBox();
+  hestonSchemeCombo_->addItem("Euler (full truncation)");
+  hestonSchemeCombo_->addItem("Quadratic-exponential");
+  hestonStepEdit_ = new QLineEdit(doubleToQString(defaults_.hestonMaxStep));
+  modelLayout_->addRow("Heston scheme", hestonSchemeCombo_);
+  hestonSchemeLabel_ = modelLayout_->labelForField(hestonSchemeCombo_);
+  modelLayout_->addRow("Heston step (y)", hestonStepEdit_);
+  hestonStepLabel_ = modelLayout_->labelForField(hestonStepEdit_);
   leftLayout->addWidget(modelGroup_);
 
-  // Action button to trigger pricing.
-  auto *button = new QPushButton("Price");
-  leftLayout->addWidget(button);
+  // Action buttons: start a pricing, or stop the one in progress.
+  auto *buttonLayout = new QHBoxLayout();
+  priceButton_ = new QPushButton("Price");
+  cancelButton_ = new QPushButton("Cancel");
+  cancelButton_->setEnabled(false);
+  buttonLayout->addWidget(priceButton_);
+  buttonLayout->addWidget(cancelButton_);
+  leftLayout->addLayout(buttonLayout);
 
   // Display area for pricing outputs.
   auto *resultsLayout = new QFormLayout();
   resultsLayout->setSpacing(8);
+  progressLabel_ = new QLabel("-");
   priceLabel_ = new QLabel("-");
   stdErrorLabel_ = new QLabel("-");
   deltaLabel_ = new QLabel("-");
+  gammaLabel_ = new QLabel("-");
   vegaLabel_ = new QLabel("-");
   bidLabel_ = new QLabel("-");
   askLabel_ = new QLabel("-");
+  lifeLabel_ = new QLabel("-");
+  redemptionLabel_ = new QLabel("-");
 
+  resultsLayout->addRow("Paths", progressLabel_);
   resultsLayout->addRow("Price", priceLabel_);
   resultsLayout->addRow("Std error", stdErrorLabel_);
   resultsLayout->addRow("Delta", deltaLabel_);
+  resultsLayout->addRow("Gamma", gammaLabel_);
   resultsLayout->addRow("Vega", vegaLabel_);
   resultsLayout->addRow("Bid", bidLabel_);
   resultsLayout->addRow("Ask", askLabel_);
+  resultsLayout->addRow("Expected life", lifeLabel_);
+  resultsLayout->addRow("Redemption", redemptionLabel_);
 
   leftLayout->addLayout(resultsLayout);
   leftLayout->addStretch();
@@ -308,7 +409,10 @@ PricerWindow::PricerWindow(QWidget *parent) : QWidget(parent) {
   mainLayout->setStretch(0, 2);
   mainLayout->setStretch(1, 3);
 
-  connect(button, &QPushButton::clicked, this, &PricerWindow::handlePrice);
+  connect(priceButton_, &QPushButton::clicked, this,
+          &PricerWindow::handlePrice);
+  connect(cancelButton_, &QPushButton::clicked, this,
+          &PricerWindow::cancelPricing);
   connect(familyCombo_, &QComboBox::currentIndexChanged, this,
           &PricerWindow::updateProductSpecificFields);
   connect(autocallCombo_, &QComboBox::currentIndexChanged, this,
@@ -405,8 +509,17 @@ PricingInputs PricerWindow::gatherInputs() const {
                              ? CliquetType::CappedCoupons
                              : CliquetType::MaxReturn;
   }
-  inputs.modelType = modelCombo_->currentIndex() == 1 ? ModelType::Heston
-                                                      : ModelType::BlackScholes;
+  switch (modelCombo_->currentIndex()) {
+  case 1:
+    inputs.modelType = ModelType::Heston;
+    break;
+  case 2:
+    inputs.modelType = ModelType::LocalVol;
+    break;
+  default:
+    inputs.modelType = ModelType::BlackScholes;
+    break;
+  }
   inputs.spot = readDouble(spotEdit_, defaults_.spot);
   inputs.sigma = readDouble(volEdit_, defaults_.sigma);
   inputs.rate = readDouble(rateEdit_, defaults_.rate);
@@ -437,34 +550,200 @@ PricingInputs PricerWindow::gatherInputs() const {
     inputs.hestonTheta = readDouble(hestonThetaEdit_, defaults_.hestonTheta);
     inputs.hestonXi = readDouble(hestonXiEdit_, defaults_.hestonXi);
     inputs.hestonRho = readDouble(hestonRhoEdit_, defaults_.hestonRho);
+    inputs.hestonScheme = hestonSchemeCombo_->currentIndex() == 1
+                              ? HestonScheme::QuadraticExponential
+                              : HestonScheme::Euler;
+    inputs.hestonMaxStep = readDouble(hestonStepEdit_, defaults_.hestonMaxStep);
   }
 
   inputs.observationTimes = parseTimesList(
       timesEdit_->text().trimmed().toStdString(), defaults_.observationTimes);
   inputs.paths = readSizeT(pathsEdit_, defaults_.paths);
   inputs.seed = readUInt(seedEdit_, defaults_.seed);
+  inputs.sampling = samplingCombo_->currentIndex() == 1
+                        ? SamplingMode::Sobol
+                        : SamplingMode::PseudoRandom;
+  switch (normalsCombo_->currentIndex()) {
+  case 1:
+    inputs.normalScheme = NormalScheme::Antithetic;
+    break;
+  case 2:
+    inputs.normalScheme = NormalScheme::MomentMatched;
+    break;
+  default:
+    inputs.normalScheme = NormalScheme::Independent;
+    break;
+  }
+  // Repricing the same market state (or several products observing a subset
+  // of its dates) reuses the simulated paths.
+  inputs.usePathCache = true;
+  inputs.controlVariates = controlVariatesCheck_->isChecked();
+  inputs.greekMethod = greeksCombo_->currentIndex() == 1
+                           ? GreekMethod::SinglePass
+                           : GreekMethod::BumpAndRevalue;
   inputs.spreadFraction = readDouble(spreadEdit_, defaults_.spreadFraction);
   return inputs;
 }
 
+// Starts a pricing on a worker thread, replacing any run in progress. The
+// worker only talks to the window through queued calls tagged with the run's
+// generation.
 void PricerWindow::handlePrice() {
+  PricingInputs inputs;
   try {
-    PricingInputs inputs = gatherInputs();
-    const PricingResults results = priceAutocall(inputs);
-    updateResults(results);
-    updatePayoffChart();
+    inputs = gatherInputs();
   } catch (const std::exception &ex) {
     showError(QString::fromStdString(ex.what()));
+    return;
   }
+  dropStaleRun();
+
+  const std::uint64_t generation = ++generation_;
+  run_ = std::make_shared<PricingRun>(
+      [this, generation](std::size_t pathsDone, std::size_t paths,
+                         const MonteCarloEstimate &price) {
+        QMetaObject::invokeMethod(
+            this,
+            [this, generation, pathsDone, paths, price] {
+              showProgress(generation, pathsDone, paths, price);
+            },
+            Qt::QueuedConnection);
+      });
+
+  QThread *worker = QThread::create([this, run = run_, inputs, generation] {
+    try {
+      const PricingResults results = priceAutocall(inputs, run.get());
+      QMetaObject::invokeMethod(
+          this, [this, generation, results] { finishPricing(generation, results); },
+          Qt::QueuedConnection);
+    } catch (const MonteCarloCancelled &) {
+      // Whoever cancelled the run has already moved the window on.
+    } catch (const std::exception &ex) {
+      const QString message = QString::fromStdString(ex.what());
+      QMetaObject::invokeMethod(
+          this, [this, generation, message] { failPricing(generation, message); },
+          Qt::QueuedConnection);
+    }
+  });
+  connect(worker, &QThread::finished, this, [this, worker] {
+    // Absent once stopWorkers() has waited for (and deleted) the thread.
+    const auto it = std::find(workers_.begin(), workers_.end(), worker);
+    if (it == workers_.end()) {
+      return;
+    }
+    workers_.erase(it);
+    worker->deleteLater();
+  });
+  workers_.push_back(worker);
+
+  progressLabel_->setText("Starting...");
+  for (QLabel *label : {priceLabel_, stdErrorLabel_, deltaLabel_, gammaLabel_,
+                        vegaLabel_, bidLabel_, askLabel_, lifeLabel_,
+                        redemptionLabel_}) {
+    label->setText("-");
+  }
+  setRunning(true);
+  worker->start();
+}
+
+void PricerWindow::cancelPricing() {
+  if (!run_) {
+    return;
+  }
+  run_->cancel();
+  run_.reset();
+  ++generation_;
+  setRunning(false);
+  progressLabel_->setText(progressLabel_->text() + " (cancelled)");
+}
+
+// Input edits make the run in progress meaningless: stop it and blank the
+// partial figures rather than let them pass for the new inputs.
+void PricerWindow::dropStaleRun() {
+  if (!run_) {
+    return;
+  }
+  run_->cancel();
+  run_.reset();
+  ++generation_;
+  setRunning(false);
+  progressLabel_->setText("-");
+  priceLabel_->setText("-");
+  stdErrorLabel_->setText("-");
+}
+
+void PricerWindow::showProgress(std::uint64_t generation, std::size_t pathsDone,
+                                std::size_t paths,
+                                const MonteCarloEstimate &price) {
+  if (generation != generation_) {
+    return;
+  }
+  progressLabel_->setText(sizeToQString(pathsDone) + " / " +
+                          sizeToQString(paths));
+  priceLabel_->setText(QString::number(price.value, 'f', 4));
+  stdErrorLabel_->setText(QString::number(price.standardError, 'f', 4));
+}
+
+void PricerWindow::finishPricing(std::uint64_t generation,
+                                 const PricingResults &results) {
+  if (generation != generation_) {
+    return;
+  }
+  run_.reset();
+  setRunning(false);
+  updateResults(results);
+  updatePayoffChart();
+}
+
+void PricerWindow::failPricing(std::uint64_t generation,
+                               const QString &message) {
+  if (generation != generation_) {
+    return;
+  }
+  run_.reset();
+  setRunning(false);
+  progressLabel_->setText("-");
+  showError(message);
+}
+
+void PricerWindow::setRunning(bool running) {
+  cancelButton_->setEnabled(running);
+}
+
+// Cancels the current run and waits for every worker, so none outlives the
+// window it reports to.
+void PricerWindow::stopWorkers() {
+  if (run_) {
+    run_->cancel();
+    run_.reset();
+  }
+  ++generation_;
+  for (QThread *worker : workers_) {
+    worker->wait();
+    delete worker;
+  }
+  workers_.clear();
 }
 
 void PricerWindow::updateResults(const PricingResults &results) {
   priceLabel_->setText(QString::number(results.price, 'f', 4));
   stdErrorLabel_->setText(QString::number(results.stdError, 'f', 4));
-  deltaLabel_->setText(QString::number(results.delta, 'f', 4));
-  vegaLabel_->setText(QString::number(results.vega, 'f', 4));
+  // Greeks carry their standard error when the method estimates one.
+  auto withError = [](double value, double error, int digits) {
+    QString text = QString::number(value, 'f', digits);
+    if (error > 0.0) {
+      text += QString::fromUtf8(" \u00b1 ") + QString::number(error, 'f', digits);
+    }
+    return text;
+  };
+  deltaLabel_->setText(withError(results.delta, results.deltaStdError, 4));
+  gammaLabel_->setText(withError(results.gamma, results.gammaStdError, 6));
+  vegaLabel_->setText(withError(results.vega, results.vegaStdError, 4));
   bidLabel_->setText(QString::number(results.bid, 'f', 4));
   askLabel_->setText(QString::number(results.ask, 'f', 4));
+  lifeLabel_->setText(QString::number(results.expectedLife, 'f', 2) + " y");
+  redemptionLabel_->setText(withError(results.redemptionMean,
+                                      results.redemptionStdDev, 2));
 }
 
 void PricerWindow::showError(const QString &message) {
@@ -518,6 +797,10 @@ void PricerWindow::updateProductSpecificFields() {
   hestonXiEdit_->setVisible(isHeston);
   hestonRhoLabel_->setVisible(isHeston);
   hestonRhoEdit_->setVisible(isHeston);
+  hestonSchemeLabel_->setVisible(isHeston);
+  hestonSchemeCombo_->setVisible(isHeston);
+  hestonStepLabel_->setVisible(isHeston);
+  hestonStepEdit_->setVisible(isHeston);
   modelGroup_->setVisible(true);
 
   if (inputContainer_) {
@@ -550,6 +833,7 @@ std::vector<double> PricerWindow::defaultCallBarrierList() const {
 void PricerWindow::connectInputField(QLineEdit *edit) {
   connect(edit, &QLineEdit::editingFinished, this,
           &PricerWindow::updatePayoffChart);
+  connect(edit, &QLineEdit::textEdited, this, &PricerWindow::dropStaleRun);
 }
 
 void PricerWindow::connectInputs() {
@@ -574,9 +858,21 @@ void PricerWindow::connectInputs() {
   connectInputField(hestonThetaEdit_);
   connectInputField(hestonXiEdit_);
   connectInputField(hestonRhoEdit_);
+  connectInputField(hestonStepEdit_);
+  for (QComboBox *combo :
+       {familyCombo_, autocallCombo_, cliquetCombo_, modelCombo_,
+        samplingCombo_, normalsCombo_, greeksCombo_, hestonSchemeCombo_}) {
+    connect(combo, &QComboBox::currentIndexChanged, this,
+            &PricerWindow::dropStaleRun);
+  }
+  connect(controlVariatesCheck_, &QCheckBox::toggled, this,
+          &PricerWindow::dropStaleRun);
 }
 
+PricerWindow::~PricerWindow() { stopWorkers(); }
+
 void PricerWindow::closeEvent(QCloseEvent *event) {
+  stopWorkers();
   saveSettings();
   QWidget::closeEvent(event);
 }
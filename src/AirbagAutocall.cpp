@@ -18,23 +18,22 @@ AirbagAutocall::AirbagAutocall(std::string underlying,
                    notional, couponRate, callBarrier, protectionBarrier),
       airbagFloor_(airbagFloor) {}
 
-std::vector<CashFlow> AirbagAutocall::cashFlows(const std::vector<double>& path) const {
-    std::vector<CashFlow> flows;
+void AirbagAutocall::emitCashFlows(const std::vector<double>& path,
+                                   CashFlowSink& sink) const {
     const auto& obs = times();
     const std::size_t steps = std::min(path.size(), obs.size());
 
     // Check for early redemption (autocall event) at each observation step.
     for (std::size_t i = 0; i < steps; ++i) {
         if (path[i] >= callBarrier()) {
-            flows.push_back({notional() * (1.0 + couponRate()), obs[i]});
-            return flows; // The product terminates immediately.
+            sink.onCashFlow(i, notional() * (1.0 + couponRate()));
+            return; // The product terminates immediately.
         }
     }
 
     // If we survived until maturity, calculate the final payoff.
     const double finalSpot = (steps > 0) ? path[steps - 1] : spot0();
-    flows.push_back({terminalRedemption(finalSpot), obs.back()});
-    return flows;
+    sink.onCashFlow(maturityIndex(), terminalRedemption(finalSpot));
 }
 
 double AirbagAutocall::terminalRedemption(double spotT) const {
@@ -1,32 +1,220 @@
 /*
  * SUMMARY: Implements the standard Black-Scholes path generator.
- * It assumes constant volatility (Geometric Brownian Motion) to simulate 
- * asset trajectories, serving as the baseline model for pricing.
+ * It assumes Geometric Brownian Motion to simulate asset trajectories, with
+ * deterministic rate, dividend and volatility term structures taken from the
+ * market's per-interval forward grid, serving as the baseline model for pricing.
+ * The batch entry point advances whole blocks of paths date by date with the
+ * vectorized exp/normal kernels of SimdMath.
  */
 
 #include "BlackScholesMC.hpp"
 #include "MarketData.hpp"
+#include "SimdMath.hpp"
 #include <cmath>
 #include <random>
 #include <algorithm>
+#include <sstream>
+#include <utility>
 
-// Constructor just stores the constant volatility.
-BlackScholesMC::BlackScholesMC(double sigma) : sigma_(sigma) {}
+// Constructor just stores the constant volatility and the underlying's name.
+BlackScholesMC::BlackScholesMC(double sigma, std::string underlying)
+    : sigma_(sigma), underlying_(std::move(underlying)) {}
 
 std::vector<double> BlackScholesMC::simulatePath(double spot0,
                                                  const std::vector<double>& times,
                                                  const MarketData& data,
                                                  std::mt19937& rng) const {
-    std::vector<double> path;
-    path.reserve(times.size());
+    std::vector<double> path(times.size());
+    simulateInto(spot0, *data.forwardGrid(underlying_, times), rng, path.data(), 1);
+    return path;
+}
+
+std::string BlackScholesMC::cacheKey() const {
+    // Hex floats keep every bit of the parameter in the key.
+    std::ostringstream key;
+    key << "BlackScholes:" << std::hexfloat << sigma_ << ':' << underlying_;
+    return key.str();
+}
+
+BrownianGrid BlackScholesMC::brownianGrid(const std::vector<double>& times) const {
+    // Same rule as the simulation loops: only dates that advance the clock
+    // draw a normal. Step times are the cumulative Brownian clock.
+    BrownianGrid grid;
+    double currentTime = 0.0;
+    double clock = 0.0;
+    for (double t : times) {
+        const double dt = t - currentTime;
+        if (dt > 1e-8) {
+            clock += dt;
+            grid.stepTimes.push_back(clock);
+        }
+        currentTime = t;
+    }
+    return grid;
+}
+
+void BlackScholesMC::simulatePaths(double spot0,
+                                   const std::vector<double>& times,
+                                   const MarketData& data,
+                                   NormalStream& normalStream,
+                                   std::size_t paths,
+                                   PathBatch& batch) const {
+    simulateBatch(spot0, times, data, normalStream, paths, batch, nullptr);
+}
+
+void BlackScholesMC::simulatePathsWithSensitivities(
+    double spot0,
+    const std::vector<double>& times,
+    const MarketData& data,
+    NormalStream& normalStream,
+    std::size_t paths,
+    PathBatch& batch,
+    PathSensitivities& sensitivities) const {
+    simulateBatch(spot0, times, data, normalStream, paths, batch, &sensitivities);
+}
+
+void BlackScholesMC::simulateBatch(double spot0,
+                                   const std::vector<double>& times,
+                                   const MarketData& data,
+                                   NormalStream& normalStream,
+                                   std::size_t paths,
+                                   PathBatch& batch,
+                                   PathSensitivities* sensitivities) const {
+    batch.resize(paths, times.size());
+    if (sensitivities) {
+        sensitivities->deltaScore.assign(paths, 0.0);
+        sensitivities->gammaScore.assign(paths, 0.0);
+        sensitivities->vegaScore.assign(paths, 0.0);
+        sensitivities->vegaTangent.resize(paths, times.size());
+    }
+    if (times.empty() || paths == 0) return;
+
+    // Per-thread buffer holding one date's worth of normals for every path,
+    // plus the running sum_j k_j sqrt(dt_j) Z_j when sensitivities are requested.
+    thread_local std::vector<double> normals;
+    thread_local std::vector<double> brownian;
+    normals.resize(paths);
+    if (sensitivities) brownian.assign(paths, 0.0);
+
+    const auto forward = data.forwardGrid(underlying_, times);
+    const TermCurve* vols = forward->variance.empty() ? nullptr : data.volCurve(underlying_);
+    double currentTime = 0.0;
+    double volClock = 0.0; // sum_j k_j sigma_j dt_j
+    bool firstStep = true;
+
+    // Advance all paths together, one observation date at a time: the drift
+    // and sigma*sqrt(dt) terms depend only on the grid, so they are computed
+    // once per date (from the precomputed forward grid) instead of once per
+    // path and date.
+    for (std::size_t d = 0; d < times.size(); ++d) {
+        double* row = batch.date(d);
+        const double* previous = d == 0 ? nullptr : batch.date(d - 1);
+        if (previous) {
+            std::copy(previous, previous + paths, row);
+        } else {
+            std::fill(row, row + paths, spot0);
+        }
 
+        const double dt = std::max(times[d] - currentTime, 0.0);
+        if (dt > 1e-8) {
+            double drift = 0.0;
+            double vol = 0.0;
+            stepParameters(*forward, d, dt, drift, vol);
+            normalStream.next(normals.data(), paths);
+            scaledExp(row, normals.data(), drift, vol * std::sqrt(dt), row, paths);
+
+            if (sensitivities) {
+                // k = d sigma_j / d epsilon when every implied vol pillar moves
+                // by epsilon: the total variance then moves by 2 epsilon times
+                // the integral of the vol curve, so the step's forward variance
+                // by 2 epsilon (I(t_j) - I(t_j-1)). 1 for a flat vol.
+                const double k = vols ? (vols->integral(times[d]) - vols->integral(currentTime)) /
+                                            (vol * dt)
+                                      : 1.0;
+                const double sqrtDt = std::sqrt(dt);
+                const double volSqrtDt = vol * sqrtDt;
+                volClock += k * vol * dt;
+                for (std::size_t p = 0; p < paths; ++p) {
+                    const double z = normals[p];
+                    brownian[p] += k * sqrtDt * z;
+                    sensitivities->vegaScore[p] += k * ((z * z - 1.0) / vol - z * sqrtDt);
+                }
+                if (firstStep) {
+                    const double spotVol = spot0 * volSqrtDt;
+                    for (std::size_t p = 0; p < paths; ++p) {
+                        const double z = normals[p];
+                        sensitivities->deltaScore[p] = z / spotVol;
+                        sensitivities->gammaScore[p] =
+                            (z * z - 1.0 - z * volSqrtDt) / (spotVol * spotVol);
+                    }
+                }
+            }
+            firstStep = false;
+        }
+
+        if (sensitivities) {
+            double* tangent = sensitivities->vegaTangent.date(d);
+            for (std::size_t p = 0; p < paths; ++p) {
+                tangent[p] = row[p] * (brownian[p] - volClock);
+            }
+        }
+        currentTime = times[d];
+    }
+}
+
+SpotMarginals BlackScholesMC::marginals(const std::vector<double>& times,
+                                       const MarketData& data) const {
+    // Same dates and step parameters as the simulation: each moving date
+    // multiplies the spot by an independent lognormal factor.
+    const auto forward = data.forwardGrid(underlying_, times);
+    SpotMarginals marginals;
+    marginals.forward.resize(times.size());
+    marginals.logVariance.resize(times.size());
+    double growth = 0.0;
+    double variance = 0.0;
+    double currentTime = 0.0;
+    for (std::size_t d = 0; d < times.size(); ++d) {
+        const double dt = std::max(times[d] - currentTime, 0.0);
+        if (dt > 1e-8) {
+            double drift = 0.0;
+            double vol = 0.0;
+            stepParameters(*forward, d, dt, drift, vol);
+            growth += forward->carryRate[d] * dt;
+            variance += vol * vol * dt;
+        }
+        marginals.forward[d] = std::exp(growth);
+        marginals.logVariance[d] = variance;
+        currentTime = times[d];
+    }
+    return marginals;
+}
+
+void BlackScholesMC::stepParameters(const MarketData::ForwardGrid& forward,
+                                    std::size_t d, double dt, double& drift,
+                                    double& vol) const {
+    if (forward.variance.empty()) {
+        // Flat vol: same arithmetic as the constant-parameter model.
+        vol = sigma_;
+        drift = (forward.carryRate[d] - 0.5 * sigma_ * sigma_) * dt;
+    } else {
+        vol = std::sqrt(forward.variance[d] / dt);
+        drift = forward.carryRate[d] * dt - 0.5 * forward.variance[d];
+    }
+}
+
+void BlackScholesMC::simulateInto(double spot0,
+                                  const MarketData::ForwardGrid& forward,
+                                  std::mt19937& rng,
+                                  double* out,
+                                  std::size_t stride) const {
+    const std::vector<double>& times = forward.times;
     double currentSpot = spot0;
     double currentTime = 0.0;
-    const double r = data.riskFreeRate();
 
     std::normal_distribution<double> dist(0.0, 1.0);
 
-    for (double t : times) {
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        const double t = times[i];
         double dt = t - currentTime;
         
         // Safety check: prevent negative time steps.
@@ -35,14 +223,14 @@ std::vector<double> BlackScholesMC::simulatePath(double spot0,
         // Only move the spot if time has actually advanced.
         if (dt > 1e-8) {
             const double z = dist(rng);
-            const double drift = (r - 0.5 * sigma_ * sigma_) * dt;
-            const double diffusion = sigma_ * std::sqrt(dt) * z;
+            double drift = 0.0;
+            double vol = 0.0;
+            stepParameters(forward, i, dt, drift, vol);
+            const double diffusion = vol * std::sqrt(dt) * z;
             currentSpot *= std::exp(drift + diffusion);
         }
 
-        path.push_back(currentSpot);
+        out[i * stride] = currentSpot;
         currentTime = t;
     }
-
-    return path;
-}
\ No newline at end of file
+}
@@ -0,0 +1,367 @@
+/*
+ * SUMMARY: Semi-analytic model calibration to an implied vol surface.
+ * Heston vanillas are priced with the COS method (Fang & Oosterlee): the put
+ * payoff is expanded in a cosine series of the log-return on a truncation
+ * interval fixed per expiry, so its coefficients are computed once per grid
+ * and each price evaluation reduces to characteristic-function values (the
+ * "little trap" form of Albrecher et al., stable for long expiries) and a
+ * dense multiply-add over the strikes; calls follow from put-call parity.
+ * A small Levenberg-Marquardt solver with forward-difference Jacobians fits
+ * the parameters to vega-scaled price errors, which approximate implied vol
+ * errors without inverting a single price.
+ */
+
+#include "Calibration.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+// Half width of the COS interval, in standard deviations at maxVol.
+constexpr double kTruncationWidth = 12.0;
+// Vegas below this (per unit vol, forward-normalized) stop weighing more,
+// so far-wing quotes with next to no optionality cannot dominate the fit.
+constexpr double kMinVega = 1e-4;
+constexpr std::size_t kMaxIterations = 200;
+constexpr double kNegligibleCharacteristic = 1e-16;
+
+double normalCdf(double x) { return 0.5 * std::erfc(-x / std::sqrt(2.0)); }
+
+double normalPdf(double x) { return std::exp(-0.5 * x * x) / std::sqrt(2.0 * kPi); }
+
+// Forward-normalized Black-Scholes call E[(S_T / F - e^k)+] at total variance w.
+double blackCall(double k, double w) {
+    if (!(w > 0.0)) return std::max(1.0 - std::exp(k), 0.0);
+    const double sd = std::sqrt(w);
+    const double d1 = (-k + 0.5 * w) / sd;
+    return normalCdf(d1) - std::exp(k) * normalCdf(d1 - sd);
+}
+
+// d blackCall / d sigma at expiry T.
+double blackVega(double k, double T, double sigma) {
+    const double sd = sigma * std::sqrt(T);
+    return std::sqrt(T) * normalPdf((-k + 0.5 * sd * sd) / sd);
+}
+
+// The vol at which blackCall() matches 'price', by bisection; clamped to the
+// search interval when the price is outside the arbitrage bounds.
+double impliedVol(double price, double k, double T) {
+    double lo = 1e-4;
+    double hi = 5.0;
+    for (int i = 0; i < 100 && hi - lo > 1e-12; ++i) {
+        const double mid = 0.5 * (lo + hi);
+        if (blackCall(k, mid * mid * T) < price) lo = mid;
+        else hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+// E[exp(i u ln(S_T / F))] under Heston.
+std::complex<double> hestonCharacteristic(double u, double T, const HestonParameters& p) {
+    using Complex = std::complex<double>;
+    const Complex iu(0.0, u);
+    const Complex beta = p.kappa - p.rho * p.xi * iu;
+    const Complex d = std::sqrt(beta * beta + p.xi * p.xi * (iu + u * u));
+    const Complex g = (beta - d) / (beta + d);
+    const Complex decay = std::exp(-d * T);
+    const double xi2 = p.xi * p.xi;
+    const Complex c = p.kappa * p.theta / xi2 *
+                      ((beta - d) * T - 2.0 * std::log((1.0 - g * decay) / (1.0 - g)));
+    const Complex dv = (beta - d) / xi2 * (1.0 - decay) / (1.0 - g * decay);
+    return std::exp(c + dv * p.v0);
+}
+
+// Unconstrained coordinates of the parameters: logs of the positive ones and
+// atanh of rho.
+std::vector<double> toCoordinates(const HestonParameters& p) {
+    return {std::log(p.v0), std::log(p.kappa), std::log(p.theta), std::log(p.xi),
+            std::atanh(p.rho)};
+}
+
+HestonParameters fromCoordinates(const std::vector<double>& x) {
+    return {std::exp(x[0]), std::exp(x[1]), std::exp(x[2]), std::exp(x[3]),
+            std::tanh(x[4])};
+}
+
+// Solves the n x n system a x = b in place by Gaussian elimination with
+// partial pivoting; false when a is singular.
+bool solveLinear(std::vector<double>& a, std::vector<double>& b, std::size_t n) {
+    for (std::size_t col = 0; col < n; ++col) {
+        std::size_t pivot = col;
+        for (std::size_t r = col + 1; r < n; ++r) {
+            if (std::abs(a[r * n + col]) > std::abs(a[pivot * n + col])) pivot = r;
+        }
+        if (!(std::abs(a[pivot * n + col]) > 0.0)) return false;
+        if (pivot != col) {
+            for (std::size_t c = 0; c < n; ++c) std::swap(a[col * n + c], a[pivot * n + c]);
+            std::swap(b[col], b[pivot]);
+        }
+        for (std::size_t r = col + 1; r < n; ++r) {
+            const double factor = a[r * n + col] / a[col * n + col];
+            for (std::size_t c = col; c < n; ++c) a[r * n + c] -= factor * a[col * n + c];
+            b[r] -= factor * b[col];
+        }
+    }
+    for (std::size_t r = n; r-- > 0;) {
+        for (std::size_t c = r + 1; c < n; ++c) b[r] -= a[r * n + c] * b[c];
+        b[r] /= a[r * n + r];
+    }
+    return true;
+}
+
+using Residuals = std::function<void(const std::vector<double>&, std::vector<double>&)>;
+
+double squaredNorm(const std::vector<double>& r) {
+    double sum = 0.0;
+    for (double value : r) sum += value * value;
+    return sum;
+}
+
+// Minimizes |residuals(x)|^2 from 'x' (updated in place) with Marquardt's
+// diagonal scaling; returns the iteration count.
+std::size_t levenbergMarquardt(std::vector<double>& x, std::size_t residualCount,
+                               const Residuals& residuals) {
+    const std::size_t n = x.size();
+    std::vector<double> r(residualCount);
+    std::vector<double> trialResiduals(residualCount);
+    std::vector<double> jacobian(residualCount * n); // Row-major [residual][parameter].
+    std::vector<double> normal(n * n);
+    std::vector<double> gradient(n);
+    std::vector<double> trial(n);
+    residuals(x, r);
+    double cost = squaredNorm(r);
+    double lambda = 1e-3;
+
+    std::size_t iteration = 0;
+    while (iteration < kMaxIterations && cost > 0.0) {
+        ++iteration;
+        for (std::size_t j = 0; j < n; ++j) {
+            const double step = 1e-6 * std::max(1.0, std::abs(x[j]));
+            trial = x;
+            trial[j] += step;
+            residuals(trial, trialResiduals);
+            for (std::size_t i = 0; i < residualCount; ++i) {
+                jacobian[i * n + j] = (trialResiduals[i] - r[i]) / step;
+            }
+        }
+        std::fill(normal.begin(), normal.end(), 0.0);
+        std::fill(gradient.begin(), gradient.end(), 0.0);
+        for (std::size_t i = 0; i < residualCount; ++i) {
+            const double* row = jacobian.data() + i * n;
+            for (std::size_t a = 0; a < n; ++a) {
+                gradient[a] += row[a] * r[i];
+                for (std::size_t b = 0; b <= a; ++b) normal[a * n + b] += row[a] * row[b];
+            }
+        }
+        for (std::size_t a = 0; a < n; ++a) {
+            for (std::size_t b = 0; b < a; ++b) normal[b * n + a] = normal[a * n + b];
+        }
+
+        // Raise the damping until a step lowers the cost.
+        bool improved = false;
+        double trialCost = cost;
+        while (lambda < 1e12) {
+            std::vector<double> system = normal;
+            std::vector<double> step(n);
+            for (std::size_t a = 0; a < n; ++a) {
+                system[a * n + a] += lambda * std::max(normal[a * n + a], 1e-12);
+                step[a] = -gradient[a];
+            }
+            if (solveLinear(system, step, n)) {
+                for (std::size_t a = 0; a < n; ++a) trial[a] = x[a] + step[a];
+                residuals(trial, trialResiduals);
+                trialCost = squaredNorm(trialResiduals);
+                if (trialCost < cost) {
+                    improved = true;
+                    break;
+                }
+            }
+            lambda *= 4.0;
+        }
+        if (!improved) break;
+
+        double largestStep = 0.0;
+        for (std::size_t a = 0; a < n; ++a) {
+            largestStep = std::max(largestStep, std::abs(trial[a] - x[a]));
+        }
+        const bool converged = cost - trialCost <= 1e-12 * cost || largestStep < 1e-10;
+        x = trial;
+        r.swap(trialResiduals);
+        cost = trialCost;
+        lambda = std::max(lambda / 3.0, 1e-12);
+        if (converged) break;
+    }
+    return iteration;
+}
+
+// Market call prices and vegas of every node of 'surface'.
+void marketQuotes(const ImpliedVolSurface& surface, std::vector<double>& prices,
+                  std::vector<double>& vegas) {
+    const std::vector<double>& expiries = surface.expiries();
+    const std::vector<double>& strikes = surface.logMoneyness();
+    const std::vector<double>& vols = surface.vols();
+    prices.resize(vols.size());
+    vegas.resize(vols.size());
+    for (std::size_t e = 0; e < expiries.size(); ++e) {
+        for (std::size_t s = 0; s < strikes.size(); ++s) {
+            const std::size_t q = e * strikes.size() + s;
+            const double sigma = vols[q];
+            prices[q] = blackCall(strikes[s], sigma * sigma * expiries[e]);
+            vegas[q] = std::max(blackVega(strikes[s], expiries[e], sigma), kMinVega);
+        }
+    }
+}
+} // namespace
+
+HestonFourierPricer::HestonFourierPricer(std::vector<double> expiries,
+                                         std::vector<double> logMoneyness, double maxVol,
+                                         std::size_t nodes)
+    : expiries_(std::move(expiries)), strikes_(std::move(logMoneyness)), nodes_(nodes) {
+    if (expiries_.empty() || strikes_.empty() || nodes_ == 0 || !(maxVol > 0.0)) {
+        throw std::invalid_argument(
+            "HestonFourierPricer: need expiries, strikes, nodes and a positive vol");
+    }
+    const std::size_t strikeCount = strikes_.size();
+    frequencies_.resize(expiries_.size() * nodes_);
+    cosShift_.resize(frequencies_.size());
+    sinShift_.resize(frequencies_.size());
+    payoff_.resize(frequencies_.size() * strikeCount);
+    for (std::size_t e = 0; e < expiries_.size(); ++e) {
+        const double T = expiries_[e];
+        if (!(T > 0.0)) {
+            throw std::invalid_argument("HestonFourierPricer: expiries must be positive");
+        }
+        // Centred on the log-return's mean at maxVol.
+        const double sd = maxVol * std::sqrt(T);
+        const double a = -0.5 * sd * sd - kTruncationWidth * sd;
+        const double b = -0.5 * sd * sd + kTruncationWidth * sd;
+        for (std::size_t j = 0; j < nodes_; ++j) {
+            const double u = static_cast<double>(j) * kPi / (b - a);
+            const std::size_t node = e * nodes_ + j;
+            frequencies_[node] = u;
+            cosShift_[node] = std::cos(u * a);
+            sinShift_[node] = std::sin(u * a);
+
+            // Put payoff (e^k - e^y)+ on [a, min(k, b)]: 2 / (b - a) times
+            // e^k psi_j - chi_j, the cosine integrals of 1 and e^y.
+            double* row = payoff_.data() + node * strikeCount;
+            for (std::size_t s = 0; s < strikeCount; ++s) {
+                const double k = strikes_[s];
+                const double d = std::min(k, b);
+                if (!(d > a)) {
+                    row[s] = 0.0;
+                    continue;
+                }
+                const double psi = j == 0 ? d - a : std::sin(u * (d - a)) / u;
+                const double chi = (std::cos(u * (d - a)) * std::exp(d) - std::exp(a) +
+                                    u * std::sin(u * (d - a)) * std::exp(d)) /
+                                   (1.0 + u * u);
+                row[s] = 2.0 / (b - a) * (std::exp(k) * psi - chi);
+                if (j == 0) row[s] *= 0.5; // The series' first term has half weight.
+            }
+        }
+    }
+}
+
+void HestonFourierPricer::callPrices(const HestonParameters& parameters,
+                                     std::vector<double>& prices) const {
+    const std::size_t strikeCount = strikes_.size();
+    prices.assign(expiries_.size() * strikeCount, 0.0);
+    for (std::size_t e = 0; e < expiries_.size(); ++e) {
+        double* price = prices.data() + e * strikeCount;
+        for (std::size_t j = 0; j < nodes_; ++j) {
+            const std::size_t node = e * nodes_ + j;
+            // Re[phi(u) exp(-i u a)].
+            const std::complex<double> phi =
+                hestonCharacteristic(frequencies_[node], expiries_[e], parameters);
+            // |phi| decays with u; the remaining terms are below rounding.
+            if (std::abs(phi) < kNegligibleCharacteristic) break;
+            const double weight =
+                phi.real() * cosShift_[node] + phi.imag() * sinShift_[node];
+            const double* row = payoff_.data() + node * strikeCount;
+            for (std::size_t s = 0; s < strikeCount; ++s) price[s] += weight * row[s];
+        }
+        // Put-call parity on forward-normalized prices.
+        for (std::size_t s = 0; s < strikeCount; ++s) {
+            price[s] += 1.0 - std::exp(strikes_[s]);
+        }
+    }
+}
+
+HestonCalibration calibrateHeston(const ImpliedVolSurface& surface,
+                                  const HestonParameters& guess) {
+    if (!(guess.v0 > 0.0) || !(guess.kappa > 0.0) || !(guess.theta > 0.0) ||
+        !(guess.xi > 0.0) || !(std::abs(guess.rho) < 1.0)) {
+        throw std::invalid_argument(
+            "calibrateHeston: the guess needs v0, kappa, theta, xi > 0 and |rho| < 1");
+    }
+    std::vector<double> market;
+    std::vector<double> vegas;
+    marketQuotes(surface, market, vegas);
+    const HestonFourierPricer pricer(surface.expiries(), surface.logMoneyness(),
+                                     surface.maxVol());
+
+    std::vector<double> model;
+    const Residuals residuals = [&](const std::vector<double>& x, std::vector<double>& r) {
+        pricer.callPrices(fromCoordinates(x), model);
+        for (std::size_t q = 0; q < r.size(); ++q) r[q] = (model[q] - market[q]) / vegas[q];
+    };
+    std::vector<double> x = toCoordinates(guess);
+    HestonCalibration result;
+    result.iterations = levenbergMarquardt(x, market.size(), residuals);
+    result.parameters = fromCoordinates(x);
+
+    std::vector<double> r(market.size());
+    residuals(x, r);
+    result.rmsVolError = std::sqrt(squaredNorm(r) / static_cast<double>(r.size()));
+    return result;
+}
+
+double calibrateBlackScholesVol(const ImpliedVolSurface& surface) {
+    std::vector<double> market;
+    std::vector<double> vegas;
+    marketQuotes(surface, market, vegas);
+    const std::vector<double>& expiries = surface.expiries();
+    const std::vector<double>& strikes = surface.logMoneyness();
+
+    const Residuals residuals = [&](const std::vector<double>& x, std::vector<double>& r) {
+        const double variance = std::exp(2.0 * x[0]);
+        for (std::size_t e = 0; e < expiries.size(); ++e) {
+            for (std::size_t s = 0; s < strikes.size(); ++s) {
+                const std::size_t q = e * strikes.size() + s;
+                r[q] = (blackCall(strikes[s], variance * expiries[e]) - market[q]) / vegas[q];
+            }
+        }
+    };
+    // Start from the mean vol, already close for any reasonable surface.
+    double mean = 0.0;
+    for (double vol : surface.vols()) mean += vol;
+    std::vector<double> x{std::log(mean / static_cast<double>(surface.vols().size()))};
+    levenbergMarquardt(x, market.size(), residuals);
+    return std::exp(x[0]);
+}
+
+std::vector<double> hestonImpliedVols(const HestonParameters& parameters,
+                                      const std::vector<double>& expiries,
+                                      const std::vector<double>& logMoneyness) {
+    // Wide enough for the variance the process reaches, with vol-of-vol tails.
+    const double maxVol =
+        std::sqrt(std::max({parameters.v0, parameters.theta, 0.0025})) + 0.5 * parameters.xi;
+    // Diagnostics only, so nodes to spare: wing prices near 1e-8 keep their digits.
+    const HestonFourierPricer pricer(expiries, logMoneyness, maxVol, 8192);
+    std::vector<double> prices;
+    pricer.callPrices(parameters, prices);
+    std::vector<double> vols(prices.size());
+    for (std::size_t e = 0; e < expiries.size(); ++e) {
+        for (std::size_t s = 0; s < logMoneyness.size(); ++s) {
+            const std::size_t q = e * logMoneyness.size() + s;
+            vols[q] = impliedVol(prices[q], logMoneyness[s], expiries[e]);
+        }
+    }
+    return vols;
+}
@@ -14,16 +14,14 @@ CliquetBase::CliquetBase(std::string underlying,
     : StructuredProduct(std::move(underlying), std::move(observationTimes)),
       spot0_(spot0), notional_(notional) {}
 
-std::vector<CashFlow> CliquetBase::cashFlows(const std::vector<double>& path) const {
+void CliquetBase::emitCashFlows(const std::vector<double>& path,
+                                CashFlowSink& sink) const {
     // Delegate the specific path-dependent math (e.g., Sum of Caps, Max Return)
     // to the derived class implementation.
     double amount = payoffImpl(path); 
     
     // Cliquets usually have a single cash flow at the very end (maturity).
-    // We access the observation times via the base class method.
-    const auto& times = observationTimes();
-    double payTime = times.empty() ? 0.0 : times.back();
-    return {{amount, payTime}};
+    sink.onCashFlow(maturityIndex(), amount);
 }
 
 // Note: observationTimes() and underlying() are handled by the base class StructuredProduct.
\ No newline at end of file
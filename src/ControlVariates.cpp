@@ -0,0 +1,210 @@
+/*
+ * SUMMARY: Analytic control variates for the Monte Carlo engine.
+ * Each control is a simple functional of the observation path (terminal
+ * forward, call-level digitals, capital-at-risk put) whose mean is known in
+ * closed form from the model's marginals. The engine accumulates the payoff
+ * and its controls per block, as means and centred co-moments (Welford
+ * updates, Chan merges); the regression coefficients are then fitted on all
+ * paths at once (a small Cholesky solve) and the price is corrected by
+ * beta . (mean(X) - E[X]), which removes the part of the noise the controls
+ * explain.
+ */
+
+#include "ControlVariates.hpp"
+#include "PaymentSchedule.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Digitals beyond this count add little and cost controls^2 per path.
+constexpr std::size_t kMaxDigitalControls = 8;
+
+double normalCdf(double x) { return 0.5 * std::erfc(-x / std::sqrt(2.0)); }
+
+// P(S >= level) for ln S Gaussian with mean forward and log variance w > 0.
+double digitalProbability(double forward, double level, double w) {
+    const double sd = std::sqrt(w);
+    return normalCdf((std::log(forward / level) - 0.5 * w) / sd);
+}
+
+// E[(strike - S) 1{S < min(barrier, strike)}] for the same lognormal S.
+double knockInPutValue(double forward, double strike, double barrier, double w) {
+    const double level = std::min(barrier, strike);
+    const double sd = std::sqrt(w);
+    const double d1 = (std::log(forward / level) + 0.5 * w) / sd;
+    return strike * normalCdf(-(d1 - sd)) - forward * normalCdf(-d1);
+}
+} // namespace
+
+std::vector<ControlVariate> makeControlVariates(const StructuredProduct& product,
+                                                const PathModelBase& model,
+                                                const MarketData& data,
+                                                double spot0) {
+    std::vector<ControlVariate> controls;
+    const std::vector<double>& times = product.observationTimes();
+    if (times.empty() || !(spot0 > 0.0)) return controls;
+    const SpotMarginals marginals = model.marginals(times, data);
+    if (marginals.forward.size() != times.size()) return controls;
+
+    const PaymentSchedule schedule(times, data);
+    const std::size_t last = times.size() - 1;
+    const double lastForward = spot0 * marginals.forward[last];
+    controls.push_back({ControlVariate::Kind::Forward, last, 0.0, 0.0,
+                        schedule.discountFactor(last),
+                        schedule.discountFactor(last) * lastForward});
+
+    if (marginals.logVariance.size() != times.size()) return controls;
+
+    std::vector<std::size_t> callDates;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        if (product.callLevel(i) > 0.0 && marginals.logVariance[i] > 0.0) {
+            callDates.push_back(i);
+        }
+    }
+    const std::size_t digitals = std::min(callDates.size(), kMaxDigitalControls);
+    for (std::size_t j = 0; j < digitals; ++j) {
+        // Evenly spread over the call dates, always keeping the first and last.
+        const std::size_t pick =
+            digitals == 1 ? 0 : j * (callDates.size() - 1) / (digitals - 1);
+        const std::size_t i = callDates[pick];
+        const double level = product.callLevel(i);
+        const double df = schedule.discountFactor(i);
+        controls.push_back({ControlVariate::Kind::Digital, i, level, 0.0, df,
+                            df * digitalProbability(spot0 * marginals.forward[i], level,
+                                                    marginals.logVariance[i])});
+    }
+
+    const double barrier = product.capitalBarrier();
+    const double strike = product.capitalStrike();
+    if (barrier > 0.0 && strike > 0.0 && marginals.logVariance[last] > 0.0) {
+        const double df = schedule.discountFactor(last);
+        controls.push_back({ControlVariate::Kind::KnockInPut, last, strike, barrier, df,
+                            df * knockInPutValue(lastForward, strike, barrier,
+                                                 marginals.logVariance[last])});
+    }
+    return controls;
+}
+
+ControlMoments::ControlMoments(std::size_t controls)
+    : controls_(controls), meanX_(controls, 0.0), comXY_(controls, 0.0),
+      comXX_(controls * controls, 0.0), deltaX_(controls, 0.0) {}
+
+void ControlMoments::add(double y, const double* x) {
+    count_ += 1.0;
+    const double inverse = 1.0 / count_;
+    const double deltaY = y - meanY_;
+    meanY_ += deltaY * inverse;
+    const double residualY = y - meanY_;
+    m2Y_ += deltaY * residualY;
+    for (std::size_t i = 0; i < controls_; ++i) {
+        deltaX_[i] = x[i] - meanX_[i];
+        meanX_[i] += deltaX_[i] * inverse;
+    }
+    // Co-moments pair the old deviation of one variable with the new one
+    // of the other, as in the univariate update.
+    for (std::size_t i = 0; i < controls_; ++i) {
+        comXY_[i] += deltaX_[i] * residualY;
+        double* row = comXX_.data() + i * controls_;
+        for (std::size_t j = 0; j <= i; ++j) row[j] += deltaX_[i] * (x[j] - meanX_[j]);
+    }
+}
+
+void ControlMoments::merge(const ControlMoments& other) {
+    if (other.count_ == 0.0) return;
+    if (count_ == 0.0) {
+        *this = other;
+        return;
+    }
+    const double count = count_ + other.count_;
+    const double weight = count_ * other.count_ / count;
+    const double share = other.count_ / count;
+    const double deltaY = other.meanY_ - meanY_;
+    for (std::size_t i = 0; i < controls_; ++i) deltaX_[i] = other.meanX_[i] - meanX_[i];
+
+    m2Y_ += other.m2Y_ + weight * deltaY * deltaY;
+    for (std::size_t i = 0; i < controls_; ++i) {
+        comXY_[i] += other.comXY_[i] + weight * deltaX_[i] * deltaY;
+        double* row = comXX_.data() + i * controls_;
+        const double* otherRow = other.comXX_.data() + i * controls_;
+        for (std::size_t j = 0; j <= i; ++j) {
+            row[j] += otherRow[j] + weight * deltaX_[i] * deltaX_[j];
+        }
+    }
+    meanY_ += share * deltaY;
+    for (std::size_t i = 0; i < controls_; ++i) meanX_[i] += share * deltaX_[i];
+    count_ = count;
+}
+
+std::vector<double> ControlMoments::beta() const {
+    const std::size_t m = controls_;
+    std::vector<double> beta(m, 0.0);
+    if (m == 0 || count_ < 2.0) return beta;
+    const std::vector<double>& cxx = comXX_;
+    const std::vector<double>& cxy = comXY_;
+
+    // Cholesky of C_xx, dropping the controls whose pivot vanishes relative
+    // to their own variance (constant, or spanned by earlier controls).
+    std::vector<double> lower(m * m, 0.0);
+    std::vector<bool> used(m, false);
+    for (std::size_t i = 0; i < m; ++i) {
+        const double variance = cxx[i * m + i];
+        double pivot = variance;
+        for (std::size_t k = 0; k < i; ++k) pivot -= lower[i * m + k] * lower[i * m + k];
+        if (!(variance > 0.0) || !(pivot > 1e-10 * variance)) continue;
+        used[i] = true;
+        lower[i * m + i] = std::sqrt(pivot);
+        for (std::size_t r = i + 1; r < m; ++r) {
+            double value = cxx[r * m + i];
+            for (std::size_t k = 0; k < i; ++k) value -= lower[r * m + k] * lower[i * m + k];
+            lower[r * m + i] = value / lower[i * m + i];
+        }
+    }
+
+    // L L^T beta = C_xy over the kept controls.
+    std::vector<double> y(m, 0.0);
+    for (std::size_t i = 0; i < m; ++i) {
+        if (!used[i]) continue;
+        double value = cxy[i];
+        for (std::size_t k = 0; k < i; ++k) value -= lower[i * m + k] * y[k];
+        y[i] = value / lower[i * m + i];
+    }
+    for (std::size_t i = m; i-- > 0;) {
+        if (!used[i]) continue;
+        double value = y[i];
+        for (std::size_t k = i + 1; k < m; ++k) value -= lower[k * m + i] * beta[k];
+        beta[i] = value / lower[i * m + i];
+    }
+    return beta;
+}
+
+double ControlMoments::adjustedMean(const std::vector<double>& beta,
+                                    const std::vector<ControlVariate>& controls) const {
+    if (count_ == 0.0) return 0.0;
+    double mean = meanY_;
+    for (std::size_t i = 0; i < controls_; ++i) {
+        mean -= beta[i] * (meanX_[i] - controls[i].mean);
+    }
+    return mean;
+}
+
+double ControlMoments::residualSum(const std::vector<double>& beta) const {
+    double mean = meanY_;
+    for (std::size_t i = 0; i < controls_; ++i) mean -= beta[i] * meanX_[i];
+    return count_ * mean;
+}
+
+double ControlMoments::residualVariance(const std::vector<double>& beta) const {
+    const double dof = count_ - 1.0 - static_cast<double>(controls_);
+    if (!(dof > 0.0)) return 0.0;
+    // sum (r - mean(r))^2 for r = y - beta . x, from the centred moments.
+    double m2 = m2Y_;
+    for (std::size_t i = 0; i < controls_; ++i) {
+        m2 -= 2.0 * beta[i] * comXY_[i];
+        for (std::size_t j = 0; j < controls_; ++j) {
+            const double xx = j <= i ? comXX_[i * controls_ + j] : comXX_[j * controls_ + i];
+            m2 += beta[i] * beta[j] * xx;
+        }
+    }
+    return std::max(m2 / dof, 0.0);
+}
@@ -6,75 +6,311 @@
  *
  * It uses a correlation parameter (rho) to link spot and vol shocks (leverage effect)
  * and employs 'sub-stepping' (fine time grid) to ensure numerical stability.
+ * Each substep is either full-truncation Euler (fine steps) or Andersen's
+ * quadratic-exponential scheme with martingale correction, which samples the
+ * variance from a moment-matched law and stays accurate at steps 10-25 times
+ * longer.
+ *
+ * The batch entry point precomputes the substep grid and its constants once
+ * per observation schedule and advances every path of a block together with
+ * the step kernels of SimdMath. Given an early-termination rule it
+ * keeps only the paths the product still reads in the vector lanes and asks
+ * the normal stream for their draws alone.
  */
 
 #include "HestonMC.hpp"
+#include "SimdMath.hpp"
 
 #include <algorithm>
 #include <cmath>
 #include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+// Substep schedule of one observation grid, with every per-step constant of
+// the scheme already folded in (only the vector of the grid's scheme is
+// filled). observationEnd[i] is one past the last substep leading to
+// observation i. The remaining fields are the cache key; carryRate holds the
+// drift r - q of each observation interval.
+struct HestonStepGrid {
+    std::vector<HestonStepConstants> steps;
+    std::vector<HestonQeStepConstants> qeSteps;
+    std::vector<double> stepTimes; // End time of each substep.
+    std::vector<std::size_t> observationEnd;
+
+    std::vector<double> times;
+    std::vector<double> carryRate;
+    HestonScheme scheme{HestonScheme::Euler};
+    double maxStep{}, kappa{}, theta{}, xi{}, rho{};
+    bool valid{false};
+};
+
+HestonQeStepConstants qeConstants(double dt, double kappa, double theta, double xi,
+                                  double rho, double r) {
+    const double decay = std::exp(-kappa * dt);
+    const double growth = -std::expm1(-kappa * dt);            // 1 - decay
+    const double perKappa = kappa != 0.0 ? growth / kappa : dt; // -> dt as kappa -> 0
+    const double tilt = 0.5 * dt * (kappa * rho / xi - 0.5);
+    return {decay,
+            theta,
+            xi * xi * decay * perKappa,
+            0.5 * theta * xi * xi * growth * perKappa,
+            -rho * kappa * theta * dt / xi,
+            tilt - rho / xi,
+            tilt + rho / xi,
+            0.5 * dt * (1.0 - rho * rho),
+            r * dt};
+}
+
+// Builds (or reuses) the calling thread's step grid, shared by the batch and
+// the scalar paths. Each observation interval is cut into the fewest equal
+// substeps no longer than 'maxStep'. 'carryRate' may be empty
+// (brownianGrid() only needs the step times).
+const HestonStepGrid& stepGridFor(const std::vector<double>& times, HestonScheme scheme,
+                                  double maxStep, double kappa, double theta, double xi,
+                                  double rho, const std::vector<double>& carryRate) {
+    thread_local HestonStepGrid grid;
+    if (grid.valid && grid.times == times && grid.scheme == scheme &&
+        grid.maxStep == maxStep && grid.kappa == kappa && grid.theta == theta &&
+        grid.xi == xi && grid.rho == rho && grid.carryRate == carryRate) {
+        return grid;
+    }
+
+    grid.steps.clear();
+    grid.qeSteps.clear();
+    grid.stepTimes.clear();
+    grid.observationEnd.clear();
+    const double rhoBar = std::sqrt(1.0 - rho * rho);
+    double prevTime = 0.0;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        const double span = times[i] - prevTime;
+        const double r = carryRate.empty() ? 0.0 : carryRate[i];
+        if (span > 1e-8) {
+            // The tolerance keeps e.g. 0.25 / 0.01 at 25 substeps, not 26.
+            const std::size_t count = static_cast<std::size_t>(
+                std::max(1.0, std::ceil(span / maxStep - 1e-9)));
+            const double dt = span / static_cast<double>(count);
+            const double sqrtDt = std::sqrt(dt);
+            for (std::size_t k = 1; k <= count; ++k) {
+                if (scheme == HestonScheme::QuadraticExponential) {
+                    grid.qeSteps.push_back(qeConstants(dt, kappa, theta, xi, rho, r));
+                } else {
+                    grid.steps.push_back({kappa * dt, theta, xi * sqrtDt, rho, rhoBar,
+                                          r * dt, -0.5 * dt, sqrtDt});
+                }
+                grid.stepTimes.push_back(
+                    k == count ? times[i] : prevTime + static_cast<double>(k) * dt);
+            }
+        }
+        grid.observationEnd.push_back(grid.stepTimes.size());
+        prevTime = times[i];
+    }
 
-HestonMC::HestonMC(double v0, double kappa, double theta, double xi, double rho)
-    : v0_(v0), kappa_(kappa), theta_(theta), xi_(xi), rho_(rho) {}
+    grid.times = times;
+    grid.carryRate = carryRate;
+    grid.scheme = scheme;
+    grid.maxStep = maxStep;
+    grid.kappa = kappa;
+    grid.theta = theta;
+    grid.xi = xi;
+    grid.rho = rho;
+    grid.valid = true;
+    return grid;
+}
+
+// Advances n paths by substep 'step' of 'grid'.
+void advance(const HestonStepGrid& grid, std::size_t step, double* spot, double* variance,
+             const double* z1, const double* z2, std::size_t n) {
+    if (grid.scheme == HestonScheme::QuadraticExponential) {
+        hestonQeStep(spot, variance, z1, z2, grid.qeSteps[step], n);
+    } else {
+        hestonEulerStep(spot, variance, z1, z2, grid.steps[step], n);
+    }
+}
+
+// Carry drift r dt of substep 'step'.
+double stepDrift(const HestonStepGrid& grid, std::size_t step) {
+    return grid.scheme == HestonScheme::QuadraticExponential ? grid.qeSteps[step].rDt
+                                                             : grid.steps[step].rDt;
+}
+} // namespace
+
+HestonMC::HestonMC(double v0, double kappa, double theta, double xi, double rho,
+                   std::string underlying, HestonScheme scheme, double maxStep)
+    : v0_(v0), kappa_(kappa), theta_(theta), xi_(xi), rho_(rho),
+      underlying_(std::move(underlying)), scheme_(scheme), maxStep_(maxStep) {
+    if (!(maxStep_ > 0.0)) {
+        throw std::invalid_argument("HestonMC: the substep must be positive");
+    }
+    if (scheme_ == HestonScheme::QuadraticExponential && !(xi_ > 0.0)) {
+        throw std::invalid_argument("HestonMC: the QE scheme needs a positive xi");
+    }
+}
 
 std::vector<double> HestonMC::simulatePath(double spot0,
                                            const std::vector<double>& times,
                                            const MarketData& data,
                                            std::mt19937& rng) const {
     std::vector<double> path(times.size());
-    const double r = data.riskFreeRate();
+    simulateInto(spot0, *data.forwardGrid(underlying_, times), rng, path.data(), 1);
+    return path;
+}
+
+std::string HestonMC::cacheKey() const {
+    // Hex floats keep every bit of the parameters in the key.
+    std::ostringstream key;
+    key << "Heston:" << std::hexfloat << v0_ << ',' << kappa_ << ',' << theta_
+        << ',' << xi_ << ',' << rho_ << ':' << underlying_ << ':'
+        << static_cast<int>(scheme_) << ',' << maxStep_;
+    return key.str();
+}
+
+SpotMarginals HestonMC::marginals(const std::vector<double>& times,
+                                  const MarketData& data) const {
+    // The drift the substeps actually apply, summed per observation date.
+    const auto forward = data.forwardGrid(underlying_, times);
+    const HestonStepGrid& grid = stepGridFor(times, scheme_, maxStep_, kappa_, theta_,
+                                             xi_, rho_, forward->carryRate);
+    SpotMarginals marginals;
+    marginals.forward.resize(times.size());
+    double growth = 0.0;
+    std::size_t step = 0;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        for (; step < grid.observationEnd[i]; ++step) growth += stepDrift(grid, step);
+        marginals.forward[i] = std::exp(growth);
+    }
+    return marginals;
+}
+
+BrownianGrid HestonMC::brownianGrid(const std::vector<double>& times) const {
+    const HestonStepGrid& grid =
+        stepGridFor(times, scheme_, maxStep_, kappa_, theta_, xi_, rho_, {});
+    return {grid.stepTimes, 2};
+}
+
+void HestonMC::simulatePaths(double spot0,
+                             const std::vector<double>& times,
+                             const MarketData& data,
+                             NormalStream& normalStream,
+                             std::size_t paths,
+                             PathBatch& batch) const {
+    simulateBlock(spot0, times, data, normalStream, paths, batch, nullptr);
+}
+
+void HestonMC::simulatePathsUntilTerminated(double spot0,
+                                            const std::vector<double>& times,
+                                            const MarketData& data,
+                                            NormalStream& normalStream,
+                                            std::size_t paths,
+                                            PathBatch& batch,
+                                            const PathTermination& termination) const {
+    simulateBlock(spot0, times, data, normalStream, paths, batch, &termination);
+}
+
+void HestonMC::simulateBlock(double spot0,
+                             const std::vector<double>& times,
+                             const MarketData& data,
+                             NormalStream& normalStream,
+                             std::size_t paths,
+                             PathBatch& batch,
+                             const PathTermination* termination) const {
+    batch.resize(paths, times.size());
+    if (times.empty() || paths == 0) return;
+
+    const auto forward = data.forwardGrid(underlying_, times);
+    const HestonStepGrid& grid = stepGridFor(times, scheme_, maxStep_, kappa_, theta_,
+                                             xi_, rho_, forward->carryRate);
 
+    // Per-thread state of the block: one (spot, variance) pair per live path
+    // and the two normal vectors (z1 then z2) of the current substep. Once
+    // paths terminate, lane k holds path live[k] and 'gathered' its normals.
+    thread_local std::vector<double> spot;
+    thread_local std::vector<double> variance;
+    thread_local std::vector<double> normals;
+    thread_local std::vector<double> gathered;
+    thread_local std::vector<std::size_t> live;
+    spot.assign(paths, spot0);
+    variance.assign(paths, v0_);
+    normals.resize(2 * paths);
+    live.clear();
+    std::size_t lanes = paths;
+
+    // All paths move through the substep grid together, so each substep is a
+    // single lane-parallel kernel call over the whole block.
+    std::size_t step = 0;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        for (; step < grid.observationEnd[i]; ++step) {
+            const double* z1 = normals.data();
+            const double* z2 = normals.data() + paths;
+            if (lanes == paths) {
+                normalStream.next(normals.data(), normals.size());
+            } else {
+                gathered.resize(2 * lanes);
+                normalStream.nextLive(gathered.data(), 2, paths, live.data(), lanes);
+                z1 = gathered.data();
+                z2 = gathered.data() + lanes;
+            }
+            advance(grid, step, spot.data(), variance.data(), z1, z2, lanes);
+        }
+
+        double* row = batch.date(i);
+        if (lanes == paths) {
+            std::copy(spot.begin(), spot.begin() + static_cast<std::ptrdiff_t>(lanes), row);
+        } else {
+            // Terminated paths keep their last spot.
+            std::copy(batch.date(i - 1), batch.date(i - 1) + paths, row);
+            for (std::size_t k = 0; k < lanes; ++k) row[live[k]] = spot[k];
+        }
+
+        if (termination && lanes > 0) {
+            if (live.empty()) {
+                live.resize(paths);
+                for (std::size_t p = 0; p < paths; ++p) live[p] = p;
+            }
+            // Compact the surviving paths to the front, keeping their order.
+            std::size_t kept = 0;
+            for (std::size_t k = 0; k < lanes; ++k) {
+                if (termination->isTerminated(i, spot[k])) continue;
+                spot[kept] = spot[k];
+                variance[kept] = variance[k];
+                live[kept] = live[k];
+                ++kept;
+            }
+            lanes = kept;
+        }
+    }
+}
+
+void HestonMC::simulateInto(double spot0,
+                            const MarketData::ForwardGrid& forward,
+                            std::mt19937& rng,
+                            double* out,
+                            std::size_t stride) const {
     std::normal_distribution<double> dist(0.0, 1.0);
+    const std::vector<double>& times = forward.times;
+
+    // The observation times (e.g., yearly) are too coarse for the variance
+    // process, so each interval is sub-stepped on the same grid as the batch
+    // kernel: ~0.01y for Euler, whose variance would otherwise leave its
+    // stable range, and much coarser for QE, which samples the CIR transition.
+    const HestonStepGrid& grid = stepGridFor(times, scheme_, maxStep_, kappa_, theta_,
+                                             xi_, rho_, forward.carryRate);
 
     double spot = spot0;
     double v = v0_; // Initialize the variance process state.
-    double prevTime = 0.0;
-
-    // CRITICAL: We use a fixed, small time step (sub-stepping) inside the simulation loop.
-    // Why? The observation times (e.g., yearly) are too coarse for the stochastic 
-    // variance process, which would become unstable or negative if stepped too largely.
-    const double dtStep = 0.01; // Max internal step size (e.g., ~3-4 days).
-
+    std::size_t step = 0;
     for (std::size_t i = 0; i < times.size(); ++i) {
-        double currentTime = prevTime;
-        const double targetTime = times[i];
-
-        // Advance from the last observation point to the next one using sub-steps.
-        while (currentTime < targetTime) {
-            // Calculate the actual step size (don't overshoot the target time).
-            const double dt = std::min(dtStep, targetTime - currentTime);
-            if (dt <= 1e-8) break; // Avoid floating point noise near zero.
-
-            // 1. Generate Correlated Brownian Motions (Cholesky decomposition 2D)
-            const double z1 = dist(rng); // Primary noise (dWs) for the Spot.
-            const double z2 = dist(rng); // Independent noise.
-            
-            // Construct the noise for Variance (dWv) using correlation rho.
-            // If rho < 0 (typical for equities), spot drops -> vol spikes.
-            const double zv = rho_ * z1 + std::sqrt(1.0 - rho_ * rho_) * z2;
-
-            // 2. Update Variance Process (CIR Process)
-            // We use the "Full Truncation" scheme (Lord et al.) to handle negative variance.
-            // Even though the continuous math says v > 0, the discrete simulation can 
-            // push v below 0. We force positive values for the drift/diffusion terms.
-            const double v_plus = std::max(v, 0.0);
-            const double sqrt_v = std::sqrt(v_plus);
-
-            // dv = Speed(Mean - v)dt + VolOfVol * sqrt(v) * dWv
-            v += kappa_ * (theta_ - v_plus) * dt + xi_ * sqrt_v * std::sqrt(dt) * zv;
-
-            // 3. Update Spot Price (Log-Euler discretization)
-            // dS = S * r * dt + S * sqrt(v) * dWs
-            // Note: We use the geometric solution form for better accuracy.
-            spot *= std::exp((r - 0.5 * v_plus) * dt + sqrt_v * std::sqrt(dt) * z1);
-
-            currentTime += dt;
+        for (; step < grid.observationEnd[i]; ++step) {
+            // Spot noise, then the independent variance noise; each scheme
+            // correlates them itself.
+            const double z1 = dist(rng);
+            const double z2 = dist(rng);
+            advance(grid, step, &spot, &v, &z1, &z2, 1);
         }
 
         // Record the spot price at the official observation time.
-        path[i] = spot;
-        prevTime = targetTime;
+        out[i * stride] = spot;
     }
-
-    return path;
-}
\ No newline at end of file
+}
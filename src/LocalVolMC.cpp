@@ -0,0 +1,335 @@
+/*
+ * SUMMARY: Implements the Dupire local volatility model.
+ * The implied vol surface is turned into local vols once, on a dense uniform
+ * (time, log-moneyness) grid, using Gatheral's total-variance form of Dupire's
+ * formula. Grids are cached per surface snapshot, so repricing with the same
+ * surface skips calibration. Simulation works on x = ln(S / F(t)): each
+ * substep blends the two grid rows around its time into one row, then all
+ * paths of a block take a vectorized Euler step reading their vol from it;
+ * paths an autocall has finished with leave the lanes.
+ */
+
+#include "LocalVolMC.hpp"
+#include "SimdMath.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+// Max internal step size, as in HestonMC; also the grid's time spacing.
+constexpr double kMaxSubstep = 0.01;
+// Log-moneyness nodes per row; +-kGridStdDevs terminal standard deviations.
+constexpr std::size_t kGridNodes = 201;
+constexpr double kGridStdDevs = 6.0;
+// Local vols are clamped to a sane band: a slice where total variance stops
+// growing with expiry (allowed by ImpliedVolSurface) gives kMinLocalVol and a
+// density close to zero in the far wings caps at kMaxLocalVol. A non-positive
+// density, i.e. butterfly arbitrage in the quotes, is rejected instead.
+constexpr double kMinLocalVol = 0.01;
+constexpr double kMaxLocalVol = 3.0;
+constexpr std::size_t kMaxCachedGrids = 16;
+
+// Gatheral's form of Dupire's formula in total variance w(T, y), y = ln(K / F).
+// The denominator is the strike density up to a positive factor; throws
+// std::invalid_argument where it is not positive.
+double dupireLocalVol(const ImpliedVolSurface& surface, double T, double y) {
+    const ImpliedVolSurface::Point p = surface.totalVariance(T, y);
+    const double w = p.w;
+    const double wy = p.dwdk;
+    const double denominator = 1.0 - y / w * wy +
+                               0.25 * (-0.25 - 1.0 / w + y * y / (w * w)) * wy * wy +
+                               0.5 * p.d2wdk2;
+    if (!(denominator > 0.0)) {
+        std::ostringstream message;
+        message << "LocalVolMC: butterfly arbitrage in the implied vol surface "
+                   "(negative density) at T = "
+                << T << ", ln(K / F) = " << y;
+        throw std::invalid_argument(message.str());
+    }
+    if (!(p.dwdT > 0.0)) return kMinLocalVol;
+    return std::min(std::max(std::sqrt(p.dwdT / denominator), kMinLocalVol), kMaxLocalVol);
+}
+
+std::shared_ptr<const LocalVolGrid> buildGrid(const ImpliedVolSurface& surface) {
+    auto grid = std::make_shared<LocalVolGrid>();
+    // Rows up to one step past the last expiry: beyond it the surface, and so
+    // the local vol, no longer depends on time.
+    const double horizon = surface.lastExpiry() + kMaxSubstep;
+    const double halfWidth =
+        std::max(1.0, kGridStdDevs * surface.maxVol() * std::sqrt(horizon));
+    grid->timeStep = kMaxSubstep;
+    grid->timeNodes = static_cast<std::size_t>(std::ceil(horizon / kMaxSubstep)) + 1;
+    grid->xNodes = kGridNodes;
+    grid->xMin = -halfWidth;
+    grid->xStep = 2.0 * halfWidth / static_cast<double>(kGridNodes - 1);
+    grid->vols.resize(grid->timeNodes * grid->xNodes);
+    for (std::size_t a = 0; a < grid->timeNodes; ++a) {
+        // Row 0 stands for the first step's start; use half a step so w > 0.
+        const double t = a == 0 ? 0.5 * kMaxSubstep : static_cast<double>(a) * kMaxSubstep;
+        double* row = grid->vols.data() + a * grid->xNodes;
+        for (std::size_t j = 0; j < grid->xNodes; ++j) {
+            row[j] = dupireLocalVol(surface, t, grid->xMin + static_cast<double>(j) * grid->xStep);
+        }
+    }
+    return grid;
+}
+
+// Blends the grid rows around time t into 'row' (the vols of substep [t, t + dt]).
+void interpolateRow(const LocalVolGrid& grid, double t, std::vector<double>& row) {
+    row.resize(grid.xNodes);
+    const double u = t / grid.timeStep;
+    const std::size_t last = grid.timeNodes - 1;
+    const std::size_t a = std::min(static_cast<std::size_t>(u), last);
+    const double f = a == last ? 0.0 : u - static_cast<double>(a);
+    const double* lo = grid.row(a);
+    const double* hi = grid.row(std::min(a + 1, last));
+    for (std::size_t j = 0; j < grid.xNodes; ++j) {
+        row[j] = std::fma(f, hi[j] - lo[j], lo[j]);
+    }
+}
+
+// Substep boundaries of one observation grid: each interval is walked in full
+// steps of kMaxSubstep plus a shorter remainder (remainders of 1e-8 or less are
+// dropped). HestonMC instead splits an interval into equal substeps.
+struct LocalVolStepGrid {
+    std::vector<double> stepStart;
+    std::vector<double> stepLength;
+    std::vector<double> stepTimes; // End time of each substep.
+    std::vector<std::size_t> observationEnd;
+    std::vector<double> times;
+    bool valid{false};
+};
+
+const LocalVolStepGrid& stepGridFor(const std::vector<double>& times) {
+    thread_local LocalVolStepGrid grid;
+    if (grid.valid && grid.times == times) return grid;
+
+    grid.stepStart.clear();
+    grid.stepLength.clear();
+    grid.stepTimes.clear();
+    grid.observationEnd.clear();
+    double prevTime = 0.0;
+    for (double targetTime : times) {
+        double currentTime = prevTime;
+        while (currentTime < targetTime) {
+            const double dt = std::min(kMaxSubstep, targetTime - currentTime);
+            if (dt <= 1e-8) break;
+            grid.stepStart.push_back(currentTime);
+            grid.stepLength.push_back(dt);
+            currentTime += dt;
+            grid.stepTimes.push_back(currentTime);
+        }
+        grid.observationEnd.push_back(grid.stepTimes.size());
+        prevTime = targetTime;
+    }
+    grid.times = times;
+    grid.valid = true;
+    return grid;
+}
+
+// Log-growth of the forward F(t) / spot0 at each observation date.
+double forwardGrowth(const MarketData::ForwardGrid& forward, std::size_t i,
+                     double previousGrowth) {
+    const double previous = i == 0 ? 0.0 : forward.times[i - 1];
+    return previousGrowth + forward.carryRate[i] * std::max(forward.times[i] - previous, 0.0);
+}
+} // namespace
+
+std::shared_ptr<const LocalVolGrid> LocalVolMC::calibrate(const ImpliedVolSurface& surface) {
+    // Most recently used first.
+    static std::mutex mutex;
+    static std::list<std::pair<std::string, std::shared_ptr<const LocalVolGrid>>> cache;
+
+    const std::string key = surface.key();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (it->first == key) {
+                cache.splice(cache.begin(), cache, it);
+                return it->second;
+            }
+        }
+    }
+
+    // Calibrate outside the lock; a concurrent miss on the same surface just
+    // builds an identical grid.
+    auto grid = buildGrid(surface);
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.emplace_front(key, grid);
+    if (cache.size() > kMaxCachedGrids) cache.pop_back();
+    return grid;
+}
+
+LocalVolMC::LocalVolMC(const ImpliedVolSurface& surface, std::string underlying)
+    : grid_(calibrate(surface)), surfaceKey_(surface.key()),
+      underlying_(std::move(underlying)) {}
+
+std::string LocalVolMC::cacheKey() const {
+    return "LocalVol:" + surfaceKey_ + ':' + underlying_;
+}
+
+SpotMarginals LocalVolMC::marginals(const std::vector<double>& times,
+                                    const MarketData& data) const {
+    const auto forward = data.forwardGrid(underlying_, times);
+    SpotMarginals marginals;
+    marginals.forward.resize(times.size());
+    double growth = 0.0;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        growth = forwardGrowth(*forward, i, growth);
+        marginals.forward[i] = std::exp(growth);
+    }
+    return marginals;
+}
+
+BrownianGrid LocalVolMC::brownianGrid(const std::vector<double>& times) const {
+    return {stepGridFor(times).stepTimes, 1};
+}
+
+void LocalVolMC::simulatePaths(double spot0,
+                               const std::vector<double>& times,
+                               const MarketData& data,
+                               NormalStream& normalStream,
+                               std::size_t paths,
+                               PathBatch& batch) const {
+    simulateBlock(spot0, times, data, normalStream, paths, batch, nullptr);
+}
+
+void LocalVolMC::simulatePathsUntilTerminated(double spot0,
+                                              const std::vector<double>& times,
+                                              const MarketData& data,
+                                              NormalStream& normalStream,
+                                              std::size_t paths,
+                                              PathBatch& batch,
+                                              const PathTermination& termination) const {
+    simulateBlock(spot0, times, data, normalStream, paths, batch, &termination);
+}
+
+void LocalVolMC::simulateBlock(double spot0,
+                               const std::vector<double>& times,
+                               const MarketData& data,
+                               NormalStream& normalStream,
+                               std::size_t paths,
+                               PathBatch& batch,
+                               const PathTermination* termination) const {
+    batch.resize(paths, times.size());
+    if (times.empty() || paths == 0) return;
+
+    const auto forward = data.forwardGrid(underlying_, times);
+    const LocalVolStepGrid& steps = stepGridFor(times);
+    const LocalVolGrid& grid = *grid_;
+
+    // Per-thread state of the block: the log-moneyness of every live path,
+    // the normals of the current substep and the interpolated vol row. Once
+    // paths terminate, lane k holds path live[k] and 'gathered' its normals.
+    thread_local std::vector<double> x;
+    thread_local std::vector<double> normals;
+    thread_local std::vector<double> gathered;
+    thread_local std::vector<double> row;
+    thread_local std::vector<double> spots;
+    thread_local std::vector<std::size_t> live;
+    x.assign(paths, 0.0);
+    normals.resize(paths);
+    spots.assign(paths, spot0);
+    live.clear();
+    std::size_t lanes = paths;
+
+    LocalVolStepConstants constants{nullptr, grid.xNodes, grid.xMin, 1.0 / grid.xStep,
+                                    0.0, 0.0};
+    double growth = 0.0;
+    std::size_t step = 0;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        for (; step < steps.observationEnd[i]; ++step) {
+            const double dt = steps.stepLength[step];
+            interpolateRow(grid, steps.stepStart[step], row);
+            constants.vols = row.data();
+            constants.minusHalfDt = -0.5 * dt;
+            constants.sqrtDt = std::sqrt(dt);
+            const double* z = normals.data();
+            if (lanes == paths) {
+                normalStream.next(normals.data(), paths);
+            } else {
+                gathered.resize(lanes);
+                normalStream.nextLive(gathered.data(), 1, paths, live.data(), lanes);
+                z = gathered.data();
+            }
+            localVolStep(x.data(), z, constants, lanes);
+        }
+        // S(t_i) = spot0 * exp(growth + x): the forward times the moneyness.
+        growth = forwardGrowth(*forward, i, growth);
+        double* out = batch.date(i);
+        if (lanes == paths) {
+            scaledExp(spots.data(), x.data(), growth, 1.0, out, paths);
+        } else {
+            // Terminated paths keep their last spot.
+            std::copy(batch.date(i - 1), batch.date(i - 1) + paths, out);
+            gathered.resize(lanes);
+            scaledExp(spots.data(), x.data(), growth, 1.0, gathered.data(), lanes);
+            for (std::size_t k = 0; k < lanes; ++k) out[live[k]] = gathered[k];
+        }
+
+        if (termination && lanes > 0) {
+            if (live.empty()) {
+                live.resize(paths);
+                for (std::size_t p = 0; p < paths; ++p) live[p] = p;
+            }
+            // Compact the surviving paths to the front, keeping their order.
+            std::size_t kept = 0;
+            for (std::size_t k = 0; k < lanes; ++k) {
+                if (termination->isTerminated(i, out[live[k]])) continue;
+                x[kept] = x[k];
+                live[kept] = live[k];
+                ++kept;
+            }
+            lanes = kept;
+        }
+    }
+}
+
+std::vector<double> LocalVolMC::simulatePath(double spot0,
+                                             const std::vector<double>& times,
+                                             const MarketData& data,
+                                             std::mt19937& rng) const {
+    std::normal_distribution<double> dist(0.0, 1.0);
+    const auto forward = data.forwardGrid(underlying_, times);
+    const LocalVolGrid& grid = *grid_;
+    const double last = static_cast<double>(grid.xNodes - 1);
+
+    std::vector<double> path(times.size());
+    double x = 0.0;
+    double growth = 0.0;
+    double prevTime = 0.0;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        double currentTime = prevTime;
+        const double targetTime = times[i];
+        while (currentTime < targetTime) {
+            const double dt = std::min(kMaxSubstep, targetTime - currentTime);
+            if (dt <= 1e-8) break;
+
+            // Bilinear lookup of sigma_L(currentTime, x) in the grid.
+            const double ut = currentTime / grid.timeStep;
+            const std::size_t a = std::min(static_cast<std::size_t>(ut), grid.timeNodes - 1);
+            const std::size_t b = std::min(a + 1, grid.timeNodes - 1);
+            const double ft = a == b ? 0.0 : ut - static_cast<double>(a);
+            const double ux = std::min(std::max((x - grid.xMin) / grid.xStep, 0.0), last);
+            const std::size_t j = std::min(static_cast<std::size_t>(ux), grid.xNodes - 2);
+            const double fx = ux - static_cast<double>(j);
+            const double lo = grid.row(a)[j] + ft * (grid.row(b)[j] - grid.row(a)[j]);
+            const double hi =
+                grid.row(a)[j + 1] + ft * (grid.row(b)[j + 1] - grid.row(a)[j + 1]);
+            const double sigma = lo + fx * (hi - lo);
+
+            x += -0.5 * sigma * sigma * dt + sigma * std::sqrt(dt) * dist(rng);
+            currentTime += dt;
+        }
+        growth = forwardGrowth(*forward, i, growth);
+        path[i] = spot0 * std::exp(growth + x);
+        prevTime = targetTime;
+    }
+    return path;
+}
@@ -1,22 +1,57 @@
 /*
  * SUMMARY: A simple container for the market snapshot at time t=0.
- * It centralizes the risk-free rate and per-asset data (spot prices, volatilities)
- * to ensure all pricing models reference the same consistent baseline.
+ * It centralizes the discount curve and per-asset data (spot prices,
+ * volatilities, dividend and vol term structures) to ensure all pricing models
+ * reference the same consistent baseline. Curves are turned into per-interval
+ * drift/variance arrays once per observation grid and cached, so the
+ * simulation loops never interpolate.
  */
 
 #include "MarketData.hpp"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 #include <stdexcept>
+#include <utility>
+
+namespace {
+// Grids kept per MarketData; a pricing touches one or two (e.g. a product grid
+// and a cached superset), scenarios share their base's cache.
+constexpr std::size_t kMaxCachedGrids = 8;
+} // namespace
+
+struct MarketData::GridCache {
+    struct Entry {
+        std::string underlying;
+        std::shared_ptr<const ForwardGrid> grid;
+    };
+
+    std::mutex mutex;
+    std::vector<Entry> entries; // Oldest first.
+};
+
+MarketData::MarketData() : gridCache_(std::make_shared<GridCache>()) {}
 
 void MarketData::setRiskFreeRate(double r) {
-    riskFreeRate_ = r; // Global constant rate used for discounting.
+    setRateCurve(TermCurve(r)); // Flat curve: the constant-rate case.
 }
 
 double MarketData::riskFreeRate() const {
-    return riskFreeRate_;
+    return rateCurve_.value(0.0);
+}
+
+void MarketData::setRateCurve(TermCurve zeroRates) {
+    rateCurve_ = std::move(zeroRates);
+    resetGridCache();
+}
+
+double MarketData::discountFactor(double t) const {
+    return std::exp(-rateCurve_.integral(t));
 }
 
 void MarketData::setQuote(const std::string& underlying, const Quote& quote) {
     // Stores or updates the spot/vol for a specific asset (e.g., "SX5E").
+    // Forward grids do not depend on the quote, so the cache stays valid.
     quotes_[underlying] = quote;
 }
 
@@ -27,4 +62,92 @@ const MarketData::Quote& MarketData::getQuote(const std::string& underlying) con
         throw std::runtime_error("MarketData: Underlying not found: " + underlying);
     }
     return it->second;
-}
\ No newline at end of file
+}
+
+void MarketData::setDividendCurve(const std::string& underlying, TermCurve yields) {
+    dividendCurves_[underlying] = std::move(yields);
+    resetGridCache();
+}
+
+void MarketData::setVolCurve(const std::string& underlying, TermCurve vols) {
+    // Total variance sigma(t)^2 t must not decrease (no calendar arbitrage),
+    // otherwise some interval would get a negative forward variance.
+    TermCurve variance = vols.squared();
+    for (std::size_t i = 1; i < variance.times().size(); ++i) {
+        if (variance.integral(variance.times()[i]) <
+            variance.integral(variance.times()[i - 1])) {
+            throw std::invalid_argument("MarketData: vol curve of " + underlying +
+                                        " has decreasing total variance");
+        }
+    }
+    varianceCurves_[underlying] = std::move(variance);
+    volCurves_[underlying] = std::move(vols);
+    resetGridCache();
+}
+
+const TermCurve* MarketData::volCurve(const std::string& underlying) const {
+    const auto it = volCurves_.find(underlying);
+    return it == volCurves_.end() ? nullptr : &it->second;
+}
+
+const TermCurve* MarketData::dividendCurve(const std::string& underlying) const {
+    const auto it = dividendCurves_.find(underlying);
+    return it == dividendCurves_.end() ? nullptr : &it->second;
+}
+
+void MarketData::resetGridCache() {
+    gridCache_ = std::make_shared<GridCache>();
+}
+
+std::shared_ptr<const MarketData::ForwardGrid> MarketData::forwardGrid(
+    const std::string& underlying, const std::vector<double>& times) const {
+    GridCache& cache = *gridCache_;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (const auto& entry : cache.entries) {
+            if (entry.underlying == underlying && entry.grid->times == times) {
+                return entry.grid;
+            }
+        }
+    }
+
+    const TermCurve* dividends = dividendCurve(underlying);
+    const auto variances = varianceCurves_.find(underlying);
+    const TermCurve* variance =
+        variances == varianceCurves_.end() ? nullptr : &variances->second;
+
+    auto grid = std::make_shared<ForwardGrid>();
+    grid->times = times;
+    grid->carryRate.resize(times.size());
+    if (variance) grid->variance.resize(times.size());
+    // Intervals follow the models' stepping: from the previous date to this
+    // one, empty when the grid does not advance.
+    double previous = 0.0;
+    for (std::size_t d = 0; d < times.size(); ++d) {
+        const double t = times[d];
+        double carry = rateCurve_.forward(previous, t);
+        if (dividends) carry -= dividends->forward(previous, t);
+        grid->carryRate[d] = carry;
+        if (variance) {
+            grid->variance[d] =
+                std::max(variance->integral(t) - variance->integral(previous), 0.0);
+        }
+        previous = t;
+    }
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.entries.size() >= kMaxCachedGrids) cache.entries.erase(cache.entries.begin());
+    cache.entries.push_back({underlying, grid});
+    return grid;
+}
+
+std::string MarketData::curveKey(const std::string& underlying) const {
+    std::string key = "r:" + rateCurve_.key();
+    if (const TermCurve* dividends = dividendCurve(underlying)) {
+        key += "|q:" + dividends->key();
+    }
+    if (const TermCurve* vols = volCurve(underlying)) {
+        key += "|v:" + vols->key();
+    }
+    return key;
+}
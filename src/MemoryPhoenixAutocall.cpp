@@ -17,8 +17,8 @@ MemoryPhoenixAutocall::MemoryPhoenixAutocall(
                    notional, couponRate, callBarrier, protectionBarrier),
       couponBarrier_(couponBarrier) {}
 
-std::vector<CashFlow> MemoryPhoenixAutocall::cashFlows(const std::vector<double>& path) const {
-    std::vector<CashFlow> flows;
+void MemoryPhoenixAutocall::emitCashFlows(const std::vector<double>& path,
+                                          CashFlowSink& sink) const {
     const auto& obs = times();
     const std::size_t steps = std::min(path.size(), obs.size());
 
@@ -32,7 +32,7 @@ std::vector<CashFlow> MemoryPhoenixAutocall::cashFlows(const std::vector<double>
         // 1. Check Memory Coupon Trigger
         // If the condition is met, pay out the ENTIRE stack of accrued coupons.
         if (path[i] >= couponBarrier_) {
-            flows.push_back({accruedCoupons, obs[i]});
+            sink.onCashFlow(i, accruedCoupons);
             accruedCoupons = 0.0; // Reset memory after payment.
         }
 
@@ -40,13 +40,12 @@ std::vector<CashFlow> MemoryPhoenixAutocall::cashFlows(const std::vector<double>
         // If we exit early, repay the principal. 
         // Note: The coupon payment (if applicable) was handled in the block above.
         if (path[i] >= callBarrier()) {
-            flows.push_back({notional(), obs[i]});
-            return flows;
+            sink.onCashFlow(i, notional());
+            return;
         }
     }
 
     // Maturity: calculate final redemption (capital protection check).
     const double finalSpot = (steps > 0) ? path[steps - 1] : spot0();
-    flows.push_back({terminalRedemption(finalSpot), obs.back()});
-    return flows;
+    sink.onCashFlow(maturityIndex(), terminalRedemption(finalSpot));
 }
\ No newline at end of file
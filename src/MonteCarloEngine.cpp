@@ -0,0 +1,1354 @@
+/*
+ * SUMMARY: The Monte Carlo pricing loop.
+ * Paths are split into fixed-size blocks priced in parallel, each with its
+ * own counter-based (Philox) stream and its own statistics, which are merged
+ * in block order; results are therefore reproducible for a given seed
+ * whatever the thread count, and a run's leading blocks match a shorter
+ * run's. Pseudo-random and randomized QMC runs, single-pass Greeks, the
+ * fused bump scenarios, adaptive and observed runs all share this block
+ * machinery; the functions below document each of them.
+ */
+
+#include "MonteCarloEngine.hpp"
+#include "ControlVariates.hpp"
+#include "PaymentSchedule.hpp"
+#include "RunningStats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+// Per-path estimators of runMonteCarloGreeks: the price, then delta, gamma, vega.
+constexpr std::size_t kGreekEstimators = 4;
+
+// Relative bump used to differentiate continuous payoffs along a path tangent.
+constexpr double kPathwiseBump = 1e-5;
+
+// Normals the base scenario drew for one block, call by call. A call made
+// after some paths terminated (nextLive) holds the draws of its live paths
+// only and lists them, so a replay can match the draws path by path.
+struct NormalTape {
+    struct Call {
+        std::size_t factors;
+        std::size_t paths;
+        std::size_t lanes;  // == paths when every path drew
+        std::size_t values; // offset of the call's draws in 'values'
+        std::size_t live;   // offset of its live paths in 'live'
+    };
+
+    void clear() {
+        calls.clear();
+        values.clear();
+        live.clear();
+    }
+
+    std::vector<Call> calls;
+    std::vector<double> values;
+    std::vector<std::size_t> live;
+};
+
+// Buffers reused by every block a given thread prices: once they have grown to
+// the block size, the pricing loop no longer allocates.
+struct BlockWorkspace {
+    PathBatch batch;
+    PathSensitivities sensitivities;
+    std::vector<double> path;
+    std::vector<double> tangent;
+    std::vector<double> bumped;
+    NormalTape tape;
+    std::vector<PathBatch> scenarioBatches;
+    std::vector<double> scenarioValues;
+    std::vector<double> controlValues;
+};
+
+// Redemption dates and amounts of one product's paths (see
+// RedemptionProfile): counts and running statistics, merged in block order
+// like the estimators.
+struct RedemptionTally {
+    RedemptionTally() = default;
+    RedemptionTally(std::size_t dates, bool histogram)
+        : dates(dates, 0.0), bins(histogram ? kRedemptionBins : 0, 0.0) {}
+
+    std::vector<double> dates;
+    std::vector<double> bins;
+    RunningStats amount;
+
+    void merge(const RedemptionTally& other) {
+        for (std::size_t d = 0; d < dates.size(); ++d) dates[d] += other.dates[d];
+        for (std::size_t b = 0; b < bins.size(); ++b) bins[b] += other.bins[b];
+        amount.merge(other.amount);
+    }
+};
+
+// Empty tallies of 'products' on 'dates' observation dates.
+std::vector<RedemptionTally> emptyTallies(const std::vector<const StructuredProduct*>& products,
+                                          std::size_t dates) {
+    std::vector<RedemptionTally> tallies;
+    for (const StructuredProduct* product : products) {
+        tallies.emplace_back(dates, product->notional() > 0.0);
+    }
+    return tallies;
+}
+
+RedemptionProfile makeRedemptionProfile(const RedemptionTally& tally,
+                                        const std::vector<double>& times) {
+    RedemptionProfile profile;
+    const double paths = tally.amount.count();
+    if (!(paths > 0.0)) return profile;
+    profile.probability.resize(tally.dates.size());
+    for (std::size_t d = 0; d < tally.dates.size(); ++d) {
+        profile.probability[d] = tally.dates[d] / paths;
+        profile.expectedLife += profile.probability[d] * times[d];
+    }
+    profile.meanAmount = tally.amount.mean();
+    profile.amountStdDev = std::sqrt(tally.amount.variance());
+    profile.amountHistogram.resize(tally.bins.size());
+    for (std::size_t b = 0; b < tally.bins.size(); ++b) {
+        profile.amountHistogram[b] = tally.bins[b] / paths;
+    }
+    return profile;
+}
+
+// Partial statistics accumulated by one block of paths, one slot per
+// estimator. A sample is the mean of 'pathsPerSample' consecutive paths (the
+// antithetic pairs), added once its last path is in; every slot receives one
+// value per path, in path order.
+struct BlockSums {
+    explicit BlockSums(std::size_t estimators = 0, std::size_t pathsPerSample = 1)
+        : stats(estimators), pathsPerSample(pathsPerSample),
+          pending(pathsPerSample > 1 ? estimators : 0, 0.0),
+          pendingPaths(pending.size(), 0) {}
+
+    std::vector<RunningStats> stats;
+    std::size_t pathsPerSample;
+    std::vector<double> pending;
+    std::vector<std::size_t> pendingPaths;
+    // Payoff and control moments, one per ControlTarget of the run, with
+    // the running sums of the sample in progress (payoff, then controls).
+    std::vector<ControlMoments> controls;
+    std::vector<std::vector<double>> pendingControls;
+    std::vector<std::size_t> pendingControlPaths;
+    // One per product, when the caller asked for redemption profiles.
+    std::vector<RedemptionTally> redemptions;
+
+    void add(std::size_t k, double value) {
+        if (pathsPerSample > 1) {
+            pending[k] += value;
+            if (++pendingPaths[k] < pathsPerSample) return;
+            value = pending[k] / static_cast<double>(pathsPerSample);
+            pending[k] = 0.0;
+            pendingPaths[k] = 0;
+        }
+        stats[k].add(value);
+    }
+};
+
+// An estimator slot priced with control variates: BlockSums::controls[t]
+// holds the moments of targets[t].
+struct ControlTarget {
+    std::size_t slot;
+    std::vector<ControlVariate> controls;
+};
+
+// The control variates of 'product' as estimator 'slot', when the settings
+// ask for them. Pseudo-random sampling only: randomized QMC already
+// integrates these smooth proxies almost exactly, and a regression fitted on
+// its points did not shrink the spread of the replication means.
+void addControlTarget(std::vector<ControlTarget>& targets, std::size_t slot,
+                      const StructuredProduct& product, const PathModelBase& model,
+                      const MarketData& data, double spot0,
+                      const MonteCarloSettings& settings) {
+    if (!settings.controlVariates || settings.sampling != SamplingMode::PseudoRandom) {
+        return;
+    }
+    std::vector<ControlVariate> controls = makeControlVariates(product, model, data, spot0);
+    if (!controls.empty()) targets.push_back({slot, std::move(controls)});
+}
+
+void startControls(BlockSums& sums, const std::vector<ControlTarget>& targets) {
+    sums.controls.clear();
+    sums.pendingControls.clear();
+    for (const ControlTarget& target : targets) {
+        sums.controls.emplace_back(target.controls.size());
+        if (sums.pathsPerSample > 1) {
+            sums.pendingControls.emplace_back(target.controls.size() + 1, 0.0);
+        }
+    }
+    sums.pendingControlPaths.assign(sums.pendingControls.size(), 0);
+}
+
+// Adds one path, of payoff 'value', to the moments of targets[t]; pairs of
+// paths enter as one sample, like BlockSums::add().
+void addControlSample(BlockSums& sums, const std::vector<ControlTarget>& targets,
+                      std::size_t t, const std::vector<double>& path, double value,
+                      std::vector<double>& x) {
+    const std::vector<ControlVariate>& controls = targets[t].controls;
+    x.resize(controls.size());
+    for (std::size_t j = 0; j < controls.size(); ++j) x[j] = controls[j].value(path);
+    if (sums.pathsPerSample == 1) {
+        sums.controls[t].add(value, x.data());
+        return;
+    }
+    std::vector<double>& pending = sums.pendingControls[t];
+    pending[0] += value;
+    for (std::size_t j = 0; j < controls.size(); ++j) pending[j + 1] += x[j];
+    if (++sums.pendingControlPaths[t] < sums.pathsPerSample) return;
+    const double scale = 1.0 / static_cast<double>(sums.pathsPerSample);
+    for (std::size_t j = 0; j < controls.size(); ++j) x[j] = pending[j + 1] * scale;
+    sums.controls[t].add(pending[0] * scale, x.data());
+    std::fill(pending.begin(), pending.end(), 0.0);
+    sums.pendingControlPaths[t] = 0;
+}
+
+// Paths averaged into one sample of the estimators: the antithetic pairs.
+std::size_t pathsPerSample(const MonteCarloSettings& settings) {
+    return settings.sampling == SamplingMode::PseudoRandom &&
+                   settings.normalScheme == NormalScheme::Antithetic
+               ? 2
+               : 1;
+}
+
+// Paths the run simulates: antithetic runs complete their last pair.
+std::size_t simulatedPaths(const MonteCarloSettings& settings) {
+    return settings.paths + settings.paths % pathsPerSample(settings);
+}
+
+// Standard error of the mean of 'n' samples from the sums of the blocks,
+// treated as the independent units (ratio estimator for unequal blocks).
+double blockStandardError(const std::vector<double>& blockSums,
+                          const std::vector<double>& blockCounts, double n) {
+    const std::size_t blocks = blockSums.size();
+    if (blocks < 2 || !(n > 0.0)) return 0.0;
+    double total = 0.0;
+    for (double sum : blockSums) total += sum;
+    const double mean = total / n;
+    double spread = 0.0;
+    for (std::size_t b = 0; b < blocks; ++b) {
+        const double deviation = blockSums[b] - blockCounts[b] * mean;
+        spread += deviation * deviation;
+    }
+    const double b = static_cast<double>(blocks);
+    return std::sqrt(spread * b / (b - 1.0)) / n;
+}
+
+// Sums the flows of one path, discounted from the schedule's table.
+class DiscountingSink : public CashFlowSink {
+public:
+    explicit DiscountingSink(const PaymentSchedule& schedule) : schedule_(schedule) {}
+
+    void onCashFlow(std::size_t dateIndex, double amount) override {
+        value_ += amount * schedule_.discountFactor(dateIndex);
+    }
+
+    double value() const { return value_; }
+
+private:
+    const PaymentSchedule& schedule_;
+    double value_{0.0};
+};
+
+double discountedValue(const StructuredProduct& product, const std::vector<double>& path,
+                       const PaymentSchedule& schedule) {
+    DiscountingSink sink(schedule);
+    product.emitCashFlows(path, sink);
+    return sink.value();
+}
+
+// DiscountingSink that also adds up the undiscounted flows paid on
+// 'redemptionDate'.
+class RedemptionSink : public CashFlowSink {
+public:
+    RedemptionSink(const PaymentSchedule& schedule, std::size_t redemptionDate)
+        : schedule_(schedule), redemptionDate_(redemptionDate) {}
+
+    void onCashFlow(std::size_t dateIndex, double amount) override {
+        value_ += amount * schedule_.discountFactor(dateIndex);
+        if (dateIndex == redemptionDate_) redemption_ += amount;
+    }
+
+    double value() const { return value_; }
+    double redemption() const { return redemption_; }
+
+private:
+    const PaymentSchedule& schedule_;
+    std::size_t redemptionDate_;
+    double value_{0.0};
+    double redemption_{0.0};
+};
+
+// discountedValue() that also records in 'tally' the date and amount at
+// which the path redeems. Early-terminated paths are valid up to that date.
+double tallyRedemption(const StructuredProduct& product, const std::vector<double>& path,
+                       const PaymentSchedule& schedule, RedemptionTally& tally) {
+    const std::size_t last = path.size() - 1;
+    std::size_t date = last;
+    if (product.canTerminateEarly()) {
+        for (std::size_t d = 0; d < last; ++d) {
+            if (product.isTerminated(d, path[d])) {
+                date = d;
+                break;
+            }
+        }
+    }
+    RedemptionSink sink(schedule, date);
+    product.emitCashFlows(path, sink);
+
+    const double amount = sink.redemption();
+    tally.dates[date] += 1.0;
+    tally.amount.add(amount);
+    if (!tally.bins.empty()) {
+        const double bin = amount / (kRedemptionBinWidth * product.notional());
+        const double top = static_cast<double>(tally.bins.size() - 1);
+        tally.bins[bin > 0.0 ? static_cast<std::size_t>(std::min(bin, top)) : 0] += 1.0;
+    }
+    return sink.value();
+}
+
+// Discounted value of the path moved by +/- eps along 'tangent'.
+double bumpedValue(const StructuredProduct& product, const PaymentSchedule& schedule,
+                   BlockWorkspace& workspace, double eps) {
+    const std::size_t n = workspace.path.size();
+    workspace.bumped.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        workspace.bumped[i] = workspace.path[i] + eps * workspace.tangent[i];
+    }
+    return discountedValue(product, workspace.bumped, schedule);
+}
+
+// Central difference of the payoff along the tangent, i.e. the pathwise
+// derivative for a Lipschitz payoff (exact away from its kinks).
+double pathwiseDerivative(const StructuredProduct& product,
+                          const PaymentSchedule& schedule,
+                          BlockWorkspace& workspace, double eps) {
+    const double up = bumpedValue(product, schedule, workspace, eps);
+    const double down = bumpedValue(product, schedule, workspace, -eps);
+    return (up - down) / (2.0 * eps);
+}
+
+// Early termination of a path set shared by 'products', each of which reads
+// the paths multiplied by every factor in 'scales' (spot scenarios rescale the
+// base paths). A path is finished once all of those readings are.
+class ProductTermination : public PathTermination {
+public:
+    ProductTermination(std::vector<const StructuredProduct*> products,
+                       std::vector<double> scales)
+        : products_(std::move(products)), scales_(std::move(scales)) {}
+
+    // False when some product reads every path to maturity.
+    bool canTerminate() const {
+        for (const StructuredProduct* product : products_) {
+            if (!product->canTerminateEarly()) return false;
+        }
+        return !products_.empty();
+    }
+
+    bool isTerminated(std::size_t dateIndex, double spot) const override {
+        for (const StructuredProduct* product : products_) {
+            for (double scale : scales_) {
+                if (!product->isTerminated(dateIndex, spot * scale)) return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<const StructuredProduct*> products_;
+    std::vector<double> scales_;
+};
+
+// simulatePaths(), or its early-terminating variant when 'termination' is set.
+void simulateBlock(const PathModelBase& model, double spot0,
+                   const std::vector<double>& times, const MarketData& data,
+                   NormalStream& normals, std::size_t paths, PathBatch& batch,
+                   const PathTermination* termination) {
+    if (termination) {
+        model.simulatePathsUntilTerminated(spot0, times, data, normals, paths, batch,
+                                           *termination);
+    } else {
+        model.simulatePaths(spot0, times, data, normals, paths, batch);
+    }
+}
+
+// Forwards the draws of 'source' and keeps a copy of all of them in 'tape'.
+class RecordingNormals : public NormalStream {
+public:
+    RecordingNormals(NormalStream& source, NormalTape& tape)
+        : source_(source), tape_(tape) {
+        tape_.clear();
+    }
+
+    void next(double* z, std::size_t count) override {
+        source_.next(z, count);
+        tape_.calls.push_back({1, count, count, tape_.values.size(), tape_.live.size()});
+        tape_.values.insert(tape_.values.end(), z, z + count);
+    }
+
+    void nextLive(double* z, std::size_t factors, std::size_t paths,
+                  const std::size_t* live, std::size_t lanes) override {
+        source_.nextLive(z, factors, paths, live, lanes);
+        tape_.calls.push_back({factors, paths, lanes, tape_.values.size(), tape_.live.size()});
+        tape_.values.insert(tape_.values.end(), z, z + factors * lanes);
+        tape_.live.insert(tape_.live.end(), live, live + lanes);
+    }
+
+private:
+    NormalStream& source_;
+    NormalTape& tape_;
+};
+
+// Plays back a recorded tape, so every scenario sees the same normals. A path
+// the scenario still simulates after the base dropped it gets fresh draws from
+// 'spare', the block's stream of an index no task of the run uses: the base
+// no longer depends on that path, so nothing is lost by not sharing them.
+class ReplayNormals : public NormalStream {
+public:
+    ReplayNormals(const NormalTape& tape, unsigned int seed, std::uint64_t spareBlock)
+        : tape_(tape), seed_(seed), spareBlock_(spareBlock) {}
+
+    void next(double* z, std::size_t count) override {
+        const NormalTape::Call& call = take();
+        if (call.factors * call.paths != count) throw mismatch();
+        if (call.lanes == call.paths) {
+            std::copy(tape_.values.begin() + call.values,
+                      tape_.values.begin() + call.values + count, z);
+            return;
+        }
+        replay(call, z, nullptr, call.paths);
+    }
+
+    void nextLive(double* z, std::size_t factors, std::size_t paths,
+                  const std::size_t* live, std::size_t lanes) override {
+        const NormalTape::Call& call = take();
+        if (call.factors * call.paths != factors * paths) throw mismatch();
+        if (call.lanes == call.paths) {
+            const double* values = tape_.values.data() + call.values;
+            for (std::size_t f = 0; f < factors; ++f) {
+                for (std::size_t k = 0; k < lanes; ++k) {
+                    z[f * lanes + k] = values[f * paths + live[k]];
+                }
+            }
+            return;
+        }
+        if (call.factors != factors) throw mismatch();
+        replay(call, z, live, lanes);
+    }
+
+private:
+    const NormalTape::Call& take() {
+        if (next_ == tape_.calls.size()) {
+            throw std::logic_error("Scenario model consumed more normals than the base model");
+        }
+        return tape_.calls[next_++];
+    }
+
+    static std::logic_error mismatch() {
+        return std::logic_error(
+            "Scenario model drew normals in another layout than the base model");
+    }
+
+    // Lanes of 'live' (every path when null) from a partial call: the base
+    // draws of the paths it kept, spare draws for the others.
+    void replay(const NormalTape::Call& call, double* z, const std::size_t* live,
+                std::size_t lanes) {
+        const double* values = tape_.values.data() + call.values;
+        const std::size_t* kept = tape_.live.data() + call.live;
+        missing_.clear();
+        std::size_t j = 0;
+        for (std::size_t k = 0; k < lanes; ++k) {
+            const std::size_t p = live ? live[k] : k;
+            while (j < call.lanes && kept[j] < p) ++j;
+            if (j == call.lanes || kept[j] != p) {
+                missing_.push_back(k);
+                continue;
+            }
+            for (std::size_t f = 0; f < call.factors; ++f) {
+                z[f * lanes + k] = values[f * call.lanes + j];
+            }
+        }
+        if (missing_.empty()) return;
+
+        if (!spare_) spare_.emplace(makeBlockStream(seed_, spareBlock_));
+        const std::size_t count = missing_.size();
+        spareDraws_.resize(call.factors * count);
+        spare_->next(spareDraws_.data(), spareDraws_.size());
+        for (std::size_t f = 0; f < call.factors; ++f) {
+            for (std::size_t m = 0; m < count; ++m) {
+                z[f * lanes + missing_[m]] = spareDraws_[f * count + m];
+            }
+        }
+    }
+
+    const NormalTape& tape_;
+    std::size_t next_{0};
+    unsigned int seed_;
+    std::uint64_t spareBlock_;
+    std::optional<PhiloxNormals> spare_;
+    std::vector<std::size_t> missing_;
+    std::vector<double> spareDraws_;
+};
+
+// Stands in for the random source of blocks served from the path cache.
+class NoNormals : public NormalStream {
+public:
+    void next(double*, std::size_t) override {
+        throw std::logic_error("Cached Monte Carlo block asked for normals");
+    }
+};
+
+// Task layout of randomized QMC: 'replications' copies of the same point set,
+// each cut into blocks of kPathsPerBlock points.
+struct QmcLayout {
+    explicit QmcLayout(const MonteCarloSettings& settings)
+        : scrambled(settings.scrambling != QmcScrambling::None),
+          replications(scrambled ? std::max<std::size_t>(1, settings.qmcReplications) : 1),
+          pointsPerReplication(std::max<std::size_t>(
+              1, (settings.paths + replications - 1) / replications)),
+          blocksPerReplication((pointsPerReplication + kPathsPerBlock - 1) /
+                               kPathsPerBlock) {}
+
+    bool scrambled;
+    std::size_t replications;
+    std::size_t pointsPerReplication;
+    std::size_t blocksPerReplication;
+};
+
+// Number of tasks (and cached blocks) of one run.
+std::size_t blockTaskCount(const MonteCarloSettings& settings) {
+    if (settings.sampling == SamplingMode::Sobol) {
+        const QmcLayout layout(settings);
+        return layout.replications * layout.blocksPerReplication;
+    }
+    return (simulatedPaths(settings) + kPathsPerBlock - 1) / kPathsPerBlock;
+}
+
+// Replays draw their spare normals from stream indices above every block's.
+constexpr std::uint64_t kSpareStreams = std::uint64_t{1} << 63;
+
+// Stream index of block task 'task': the block itself for pseudo-random
+// runs, (replication, block) for randomized QMC. Neither depends on the path
+// count, so a run's leading blocks draw the same numbers as a shorter run's.
+std::uint64_t blockStreamIndex(const MonteCarloSettings& settings, std::size_t task) {
+    if (settings.sampling != SamplingMode::Sobol) return task;
+    const QmcLayout layout(settings);
+    const std::uint64_t rep = task / layout.blocksPerReplication;
+    return (rep << 32) | (task % layout.blocksPerReplication);
+}
+
+PathCacheKey makeCacheKey(const PathModelBase& model, const MarketData& data,
+                          const std::string& underlying, double spot, double rate,
+                          const MonteCarloSettings& settings) {
+    PathCacheKey key;
+    key.model = model.cacheKey();
+    // Term structures move the paths too; the flat rate alone is not enough.
+    if (!key.model.empty()) key.model += '|' + model.curveKey(data, underlying);
+    key.spot = spot;
+    key.rate = rate;
+    key.seed = settings.seed;
+    key.paths = settings.paths;
+    key.sampling = settings.sampling;
+    key.normalScheme = settings.sampling == SamplingMode::PseudoRandom
+                           ? settings.normalScheme
+                           : NormalScheme::Independent;
+    key.scrambling = settings.scrambling;
+    key.qmcReplications = settings.qmcReplications;
+    return key;
+}
+
+// Path p of 'batch', restricted to 'columns' when given (superset cache hit).
+void gatherPath(const PathBatch& batch, const std::vector<std::size_t>& columns,
+                std::size_t p, std::vector<double>& out) {
+    if (columns.empty()) {
+        batch.copyPath(p, out);
+        return;
+    }
+    out.resize(columns.size());
+    for (std::size_t d = 0; d < columns.size(); ++d) {
+        out[d] = batch.at(columns[d], p);
+    }
+}
+
+// Largest wave of blocks between two progress reports, per thread.
+constexpr std::size_t kMaxProgressWave = 16;
+
+// Whether the run stops on a target error or a time budget.
+bool isAdaptive(const MonteCarloSettings& settings) {
+    return settings.targetStandardError > 0.0 || settings.targetRelativeError > 0.0 ||
+           settings.timeBudget > 0.0;
+}
+
+// Stopping rule of an adaptive run, checked between batches; the clock
+// starts with the rule.
+class ConvergenceRule {
+public:
+    explicit ConvergenceRule(const MonteCarloSettings& settings)
+        : settings_(settings), start_(std::chrono::steady_clock::now()) {}
+
+    // Whether every estimate in 'prices' meets the error target, or the
+    // time budget is spent.
+    bool reached(const std::vector<MonteCarloEstimate>& estimates,
+                 const std::vector<std::size_t>& prices) const {
+        if (settings_.timeBudget > 0.0) {
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start_;
+            if (elapsed.count() >= settings_.timeBudget) return true;
+        }
+        if (!(settings_.targetStandardError > 0.0) && !(settings_.targetRelativeError > 0.0)) {
+            return false;
+        }
+        for (std::size_t slot : prices) {
+            const MonteCarloEstimate& price = estimates[slot];
+            const double tolerance =
+                std::max(settings_.targetStandardError,
+                         settings_.targetRelativeError * std::abs(price.value));
+            if (!(price.standardError <= tolerance)) return false;
+        }
+        return true;
+    }
+
+private:
+    const MonteCarloSettings& settings_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Runs task(0) ... task(count - 1) on the pool and returns how many ran.
+// Adaptive runs go in waves of 'batch' tasks, runs with an observer in waves
+// of one task per thread first, doubling from there; each task checks for
+// cancellation before it starts. After every wave report(done) runs on the
+// caller, once tasks [0, done) are complete, and stops the run by returning
+// true.
+template <typename Task, typename Report>
+std::size_t runTasks(ThreadPool& pool, std::size_t count, std::size_t batch,
+                     MonteCarloObserver* observer, Task& task, Report& report) {
+    if (!observer && batch == 0) {
+        pool.parallelFor(count, task);
+        return count;
+    }
+    const std::size_t threads = pool.size();
+    std::size_t wave = batch > 0 ? batch : threads;
+    std::size_t done = 0;
+    while (done < count) {
+        if (observer && observer->cancelled()) throw MonteCarloCancelled();
+        const std::size_t size = std::min(wave, count - done);
+        pool.parallelFor(size, [&](std::size_t i) {
+            if (observer && observer->cancelled()) throw MonteCarloCancelled();
+            task(done + i);
+        });
+        done += size;
+        if (report(done)) break;
+        if (batch == 0) wave = std::min(2 * wave, kMaxProgressWave * threads);
+    }
+    return done;
+}
+
+// Pseudo-random estimates over the first 'blockCount' blocks, holding the
+// first 'paths' paths of the run.
+std::vector<MonteCarloEstimate> pseudoRandomEstimates(
+    const std::vector<BlockSums>& blocks, std::size_t blockCount, std::size_t paths,
+    const MonteCarloSettings& settings, std::size_t estimators,
+    const std::vector<ControlTarget>& targets) {
+    // Deterministic reduction: always merge in block order.
+    std::vector<MonteCarloEstimate> estimates(estimators);
+    for (std::size_t k = 0; k < estimators; ++k) {
+        RunningStats total;
+        for (std::size_t b = 0; b < blockCount; ++b) total.merge(blocks[b].stats[k]);
+        estimates[k].value = total.mean();
+        estimates[k].standardError = total.standardError();
+        estimates[k].paths = paths;
+    }
+    const double n = static_cast<double>(paths / pathsPerSample(settings));
+
+    // Moment matching ties the paths of a block together; with a single
+    // block the per-path error above is kept as a (conservative) fallback.
+    const bool blockErrors =
+        settings.normalScheme == NormalScheme::MomentMatched && blockCount > 1;
+    std::vector<double> blockSums(blockErrors ? blockCount : 0);
+    std::vector<double> blockCounts(blockSums.size());
+    for (std::size_t b = 0; b < blockCounts.size(); ++b) {
+        blockCounts[b] = static_cast<double>(std::min(kPathsPerBlock, paths - b * kPathsPerBlock));
+    }
+    for (std::size_t k = 0; blockErrors && k < estimators; ++k) {
+        for (std::size_t b = 0; b < blockCount; ++b) blockSums[b] = blocks[b].stats[k].sum();
+        estimates[k].standardError = blockStandardError(blockSums, blockCounts, n);
+    }
+
+    // Control variates: one regression on all samples, then the adjusted
+    // mean and the residual noise replace the plain estimate.
+    for (std::size_t t = 0; t < targets.size(); ++t) {
+        ControlMoments moments(targets[t].controls.size());
+        for (std::size_t b = 0; b < blockCount; ++b) moments.merge(blocks[b].controls[t]);
+        const std::vector<double> beta = moments.beta();
+        MonteCarloEstimate& estimate = estimates[targets[t].slot];
+        estimate.value = moments.adjustedMean(beta, targets[t].controls);
+        if (blockErrors) {
+            for (std::size_t b = 0; b < blockCount; ++b) {
+                blockSums[b] = blocks[b].controls[t].residualSum(beta);
+            }
+            estimate.standardError = blockStandardError(blockSums, blockCounts, n);
+        } else {
+            estimate.standardError =
+                n > 0 ? std::sqrt(moments.residualVariance(beta) / n) : 0.0;
+        }
+    }
+    return estimates;
+}
+
+// Pseudo-random sampling: independent samples, sample mean and variance. A
+// sample is one path, or one antithetic pair; moment-matched blocks take
+// their error from the spread of the block means instead.
+template <typename PriceBlock>
+std::vector<MonteCarloEstimate> runPseudoRandom(
+    const MonteCarloSettings& settings, std::size_t estimators, bool drawNormals,
+    ThreadPool& pool, PriceBlock& priceBlock, const std::vector<ControlTarget>& targets,
+    const std::vector<std::size_t>& prices, std::vector<RedemptionTally>* redemptions) {
+    const std::size_t paths = simulatedPaths(settings);
+    const std::size_t blockCount = (paths + kPathsPerBlock - 1) / kPathsPerBlock;
+    std::vector<BlockSums> blocks(blockCount);
+
+    auto runBlock = [&](std::size_t block) {
+        const std::size_t first = block * kPathsPerBlock;
+        const std::size_t count = std::min(kPathsPerBlock, paths - first);
+        if (!drawNormals) {
+            NoNormals none;
+            blocks[block] = priceBlock(block, none, count);
+            return;
+        }
+        const PhiloxStream stream = makeBlockStream(settings.seed, block);
+        switch (settings.normalScheme) {
+        case NormalScheme::Antithetic: {
+            AntitheticNormals normals(stream, count);
+            blocks[block] = priceBlock(block, normals, count);
+            return;
+        }
+        case NormalScheme::MomentMatched: {
+            MomentMatchedNormals normals(stream, count);
+            blocks[block] = priceBlock(block, normals, count);
+            return;
+        }
+        case NormalScheme::Independent:
+            break;
+        }
+        PhiloxNormals normals(stream);
+        blocks[block] = priceBlock(block, normals, count);
+    };
+    const bool adaptive = isAdaptive(settings);
+    const ConvergenceRule rule(settings);
+    auto report = [&](std::size_t done) {
+        const std::size_t pathsDone = std::min(done * kPathsPerBlock, paths);
+        const auto estimates =
+            pseudoRandomEstimates(blocks, done, pathsDone, settings, estimators, targets);
+        if (settings.observer) settings.observer->onProgress(pathsDone, paths, estimates.front());
+        return adaptive && rule.reached(estimates, prices);
+    };
+    const std::size_t batch =
+        adaptive ? std::max<std::size_t>(
+                       1, (settings.batchPaths + kPathsPerBlock - 1) / kPathsPerBlock)
+                 : 0;
+    const std::size_t done = runTasks(pool, blockCount, batch, settings.observer, runBlock, report);
+    for (std::size_t b = 0; redemptions && b < done; ++b) {
+        for (std::size_t k = 0; k < redemptions->size(); ++k) {
+            (*redemptions)[k].merge(blocks[b].redemptions[k]);
+        }
+    }
+    return pseudoRandomEstimates(blocks, done, std::min(done * kPathsPerBlock, paths), settings,
+                                 estimators, targets);
+}
+
+// Randomized QMC estimates over the first 'blocksDone' blocks of every
+// replication.
+std::vector<MonteCarloEstimate> quasiRandomEstimates(const std::vector<BlockSums>& blocks,
+                                                     const QmcLayout& layout,
+                                                     std::size_t blocksDone,
+                                                     std::size_t estimators) {
+    const std::size_t replications = layout.replications;
+    const std::size_t points =
+        std::min(blocksDone * kPathsPerBlock, layout.pointsPerReplication);
+    std::vector<MonteCarloEstimate> estimates(estimators);
+    for (std::size_t k = 0; k < estimators; ++k) {
+        // The replication means are the independent samples.
+        RunningStats means;
+        for (std::size_t rep = 0; rep < replications; ++rep) {
+            RunningStats replication;
+            for (std::size_t block = 0; block < blocksDone; ++block) {
+                replication.merge(blocks[rep * layout.blocksPerReplication + block].stats[k]);
+            }
+            means.add(replication.mean());
+        }
+        estimates[k].value = means.mean();
+        estimates[k].standardError = means.standardError();
+        estimates[k].paths = points * replications;
+    }
+    return estimates;
+}
+
+// Randomized QMC: 'replications' independently scrambled copies of the same
+// Sobol point set. Each (replication, block) pair is one pool task; the
+// replication means are reduced in a fixed order like the pseudo-random sums.
+// Tasks are run block by block across the replications, so that a progress
+// report always sees the same leading points in every replication.
+template <typename PriceBlock>
+std::vector<MonteCarloEstimate> runQuasiRandom(
+    const PathModelBase& model, const std::vector<double>& times,
+    const MonteCarloSettings& settings, std::size_t estimators, bool drawNormals,
+    ThreadPool& pool, PriceBlock& priceBlock, const std::vector<std::size_t>& prices,
+    std::vector<RedemptionTally>* redemptions) {
+    const QmcLayout layout(settings);
+    const std::size_t replications = layout.replications;
+    const std::size_t pointsPerReplication = layout.pointsPerReplication;
+    const std::size_t blocksPerReplication = layout.blocksPerReplication;
+    // The unscrambled sequence starts at 0 in every coordinate: skip it.
+    const std::uint64_t firstPoint = layout.scrambled ? 0 : 1;
+
+    const BrownianGrid grid = model.brownianGrid(times);
+    const BrownianBridge bridge(grid.stepTimes);
+    const SobolSequence sobol;
+    std::vector<std::vector<std::uint32_t>> scrambleSeeds(replications);
+    for (std::size_t rep = 0; rep < replications; ++rep) {
+        scrambleSeeds[rep] = makeScrambleSeeds(settings.seed, rep);
+    }
+
+    std::vector<BlockSums> blocks(replications * blocksPerReplication);
+    auto runBlock = [&](std::size_t index) {
+        const std::size_t rep = index % replications;
+        const std::size_t block = index / replications;
+        const std::size_t task = rep * blocksPerReplication + block;
+        const std::size_t first = block * kPathsPerBlock;
+        const std::size_t count = std::min(kPathsPerBlock, pointsPerReplication - first);
+        if (!drawNormals) {
+            NoNormals none;
+            blocks[task] = priceBlock(task, none, count);
+            return;
+        }
+        // Pseudo-random padding for the dimensions past the Sobol table.
+        const PhiloxStream pad = makeBlockStream(settings.seed, blockStreamIndex(settings, task));
+        QuasiRandomNormals normals(grid, bridge, sobol, settings.scrambling,
+                                   scrambleSeeds[rep], firstPoint + first, count, pad);
+        blocks[task] = priceBlock(task, normals, count);
+    };
+    const bool adaptive = isAdaptive(settings);
+    const ConvergenceRule rule(settings);
+    auto report = [&](std::size_t done) {
+        const std::size_t blocksDone = done / replications;
+        if (blocksDone == 0) return false;
+        const auto estimates = quasiRandomEstimates(blocks, layout, blocksDone, estimators);
+        if (settings.observer) {
+            settings.observer->onProgress(estimates.front().paths,
+                                          pointsPerReplication * replications,
+                                          estimates.front());
+        }
+        return adaptive && rule.reached(estimates, prices);
+    };
+    // Adaptive batches are whole blocks of every replication.
+    const std::size_t batchBlocks =
+        (settings.batchPaths + replications * kPathsPerBlock - 1) /
+        (replications * kPathsPerBlock);
+    const std::size_t batch =
+        adaptive ? std::max<std::size_t>(1, batchBlocks) * replications : 0;
+    const std::size_t done =
+        runTasks(pool, blocks.size(), batch, settings.observer, runBlock, report);
+    for (std::size_t rep = 0; redemptions && rep < replications; ++rep) {
+        for (std::size_t block = 0; block < done / replications; ++block) {
+            const BlockSums& sums = blocks[rep * blocksPerReplication + block];
+            for (std::size_t k = 0; k < redemptions->size(); ++k) {
+                (*redemptions)[k].merge(sums.redemptions[k]);
+            }
+        }
+    }
+    return quasiRandomEstimates(blocks, layout, done / replications, estimators);
+}
+
+// Runs every block task through priceBlock(task, normals, count). With
+// drawNormals off (all paths cached) no random numbers are generated. With
+// pseudo-random sampling, the estimators named in 'targets' are priced with
+// their control variates (see addControlTarget()). An adaptive run stops
+// once every estimator listed in 'prices' meets the error target. When
+// 'redemptions' is given, the blocks' redemption tallies are merged into it
+// over the same blocks as the estimates.
+template <typename PriceBlock>
+std::vector<MonteCarloEstimate> runBlocks(
+    const PathModelBase& model, const std::vector<double>& times,
+    const MonteCarloSettings& settings, std::size_t estimators, ThreadPool& pool,
+    PriceBlock& priceBlock, bool drawNormals = true,
+    const std::vector<ControlTarget>& targets = {},
+    const std::vector<std::size_t>& prices = {0},
+    std::vector<RedemptionTally>* redemptions = nullptr) {
+    if (settings.sampling == SamplingMode::Sobol) {
+        return runQuasiRandom(model, times, settings, estimators, drawNormals, pool,
+                              priceBlock, prices, redemptions);
+    }
+    return runPseudoRandom(settings, estimators, drawNormals, pool, priceBlock, targets,
+                           prices, redemptions);
+}
+} // namespace
+
+std::mt19937 makeBlockRng(unsigned int seed, std::uint64_t blockIndex) {
+    std::seed_seq sequence{seed,
+                           static_cast<unsigned int>(blockIndex & 0xffffffffu),
+                           static_cast<unsigned int>(blockIndex >> 32)};
+    return std::mt19937(sequence);
+}
+
+PhiloxStream makeBlockStream(unsigned int seed, std::uint64_t blockIndex) {
+    return PhiloxStream{{seed, 0x5eed0b1cu}, blockIndex};
+}
+
+double runMonteCarlo(const StructuredProduct& product,
+                     const MarketData& data,
+                     const PathModelBase& model,
+                     const MonteCarloSettings& settings,
+                     double& standardError,
+                     ThreadPool& pool,
+                     RedemptionProfile* redemption) {
+    const auto& times = product.observationTimes();
+    const auto& quote = data.getQuote(product.underlying());
+    const double r = data.riskFreeRate();
+    const PaymentSchedule schedule(times, data);
+
+    // Edge case: Product with no observation times (immediate payoff).
+    if (times.empty()) {
+        standardError = 0.0;
+        const std::vector<double> immediatePath{quote.spot};
+        return discountedValue(product, immediatePath, schedule);
+    }
+
+    // Path cache: serve the blocks from a cached path set, or record the
+    // simulated ones for the next pricing.
+    PathCacheKey cacheKey;
+    std::optional<PathCache::Hit> cached;
+    std::shared_ptr<CachedPaths> recorded;
+    if (settings.cache) {
+        cacheKey = makeCacheKey(model, data, product.underlying(), quote.spot, r, settings);
+        if (!cacheKey.model.empty()) {
+            cached = settings.cache->find(cacheKey, times);
+            if (!cached && !isAdaptive(settings)) {
+                recorded = std::make_shared<CachedPaths>();
+                recorded->times = times;
+                recorded->blocks.resize(blockTaskCount(settings));
+            }
+        }
+    }
+
+    std::vector<ControlTarget> targets;
+    addControlTarget(targets, 0, product, model, data, quote.spot, settings);
+    const std::size_t sampleSize = pathsPerSample(settings);
+    std::vector<RedemptionTally> tallies;
+    if (redemption) tallies = emptyTallies({&product}, times.size());
+
+    // Paths recorded for the cache must be complete, and so must the paths
+    // the controls read; otherwise the model may drop the paths the product
+    // has finished with.
+    const ProductTermination termination({&product}, {1.0});
+    const PathTermination* stopRule = settings.earlyTermination && !recorded &&
+                                              targets.empty() && termination.canTerminate()
+                                          ? &termination
+                                          : nullptr;
+
+    // Simulates (or fetches) and prices the 'count' paths of one task.
+    auto priceBlock = [&](std::size_t task, NormalStream& normals, std::size_t count) {
+        thread_local BlockWorkspace workspace;
+        const PathBatch* batch = &workspace.batch;
+        if (cached) {
+            batch = &cached->paths->blocks[task];
+        } else {
+            simulateBlock(model, quote.spot, times, data, normals, count, workspace.batch,
+                          stopRule);
+            if (recorded) recorded->blocks[task] = workspace.batch;
+        }
+        static const std::vector<std::size_t> allColumns;
+        const std::vector<std::size_t>& columns = cached ? cached->columns : allColumns;
+
+        BlockSums sums(1, sampleSize);
+        startControls(sums, targets);
+        sums.redemptions = tallies;
+        for (std::size_t i = 0; i < count; ++i) {
+            gatherPath(*batch, columns, i, workspace.path);
+            const double value =
+                redemption ? tallyRedemption(product, workspace.path, schedule, sums.redemptions[0])
+                           : discountedValue(product, workspace.path, schedule);
+            sums.add(0, value);
+            if (!targets.empty()) {
+                addControlSample(sums, targets, 0, workspace.path, value,
+                                 workspace.controlValues);
+            }
+        }
+        return sums;
+    };
+
+    const auto estimates = runBlocks(model, times, settings, 1, pool, priceBlock,
+                                     !cached.has_value(), targets, {0},
+                                     redemption ? &tallies : nullptr);
+    if (recorded) settings.cache->insert(cacheKey, std::move(recorded));
+    if (redemption) *redemption = makeRedemptionProfile(tallies[0], times);
+    standardError = estimates[0].standardError;
+    return estimates[0].value;
+}
+
+bool supportsSinglePassGreeks(const StructuredProduct& product,
+                              const PathModelBase& model) {
+    return model.supportsPathSensitivities() &&
+           !model.brownianGrid(product.observationTimes()).stepTimes.empty();
+}
+
+MonteCarloGreeks runMonteCarloGreeks(const StructuredProduct& product,
+                                     const MarketData& data,
+                                     const PathModelBase& model,
+                                     const MonteCarloSettings& settings,
+                                     ThreadPool& pool,
+                                     RedemptionProfile* redemption) {
+    if (!supportsSinglePassGreeks(product, model)) {
+        throw std::invalid_argument(
+            "Single-pass Greeks need a model with path sensitivities and at "
+            "least one Brownian step");
+    }
+
+    const auto& times = product.observationTimes();
+    const double spot0 = data.getQuote(product.underlying()).spot;
+    const PaymentSchedule schedule(times, data);
+    const bool pathwise = product.hasContinuousPayoff();
+
+    // Likelihood-ratio weights have zero mean, so (V - baseline) * weight is
+    // unbiased for any baseline fixed in advance. The value of the forward
+    // path sits close to the typical payoff and removes most of the noise
+    // that the level of V would otherwise add to the Greeks.
+    double baseline = 0.0;
+    if (!pathwise) {
+        const auto forward = data.forwardGrid(product.underlying(), times);
+        std::vector<double> forwardPath(times.size());
+        double logGrowth = 0.0;
+        double previous = 0.0;
+        for (std::size_t d = 0; d < times.size(); ++d) {
+            logGrowth += forward->carryRate[d] * std::max(times[d] - previous, 0.0);
+            previous = times[d];
+            forwardPath[d] = spot0 * std::exp(logGrowth);
+        }
+        baseline = discountedValue(product, forwardPath, schedule);
+    }
+
+    // Control variates sharpen the price only; the Greek estimators keep
+    // their own variance reduction.
+    std::vector<ControlTarget> targets;
+    addControlTarget(targets, 0, product, model, data, spot0, settings);
+    const std::size_t sampleSize = pathsPerSample(settings);
+    std::vector<RedemptionTally> tallies;
+    if (redemption) tallies = emptyTallies({&product}, times.size());
+
+    auto priceBlock = [&](std::size_t, NormalStream& normals, std::size_t count) {
+        thread_local BlockWorkspace workspace;
+        model.simulatePathsWithSensitivities(spot0, times, data, normals, count,
+                                             workspace.batch,
+                                             workspace.sensitivities);
+        const PathSensitivities& sens = workspace.sensitivities;
+
+        BlockSums sums(kGreekEstimators, sampleSize);
+        startControls(sums, targets);
+        sums.redemptions = tallies;
+        for (std::size_t i = 0; i < count; ++i) {
+            workspace.batch.copyPath(i, workspace.path);
+            const double value =
+                redemption ? tallyRedemption(product, workspace.path, schedule, sums.redemptions[0])
+                           : discountedValue(product, workspace.path, schedule);
+            sums.add(0, value);
+            if (!targets.empty()) {
+                addControlSample(sums, targets, 0, workspace.path, value,
+                                 workspace.controlValues);
+            }
+
+            if (pathwise) {
+                // Spots are proportional to spot0: dS_d/dspot0 = S_d / spot0.
+                workspace.tangent.resize(workspace.path.size());
+                for (std::size_t d = 0; d < workspace.path.size(); ++d) {
+                    workspace.tangent[d] = workspace.path[d] / spot0;
+                }
+                const double delta =
+                    pathwiseDerivative(product, schedule, workspace,
+                                       kPathwiseBump * spot0);
+                sums.add(1, delta);
+                // LR on the pathwise delta; the -1/spot0 term is the explicit
+                // dependence of the tangent S_d / spot0 on spot0.
+                sums.add(2, delta * (sens.deltaScore[i] - 1.0 / spot0));
+
+                sens.vegaTangent.copyPath(i, workspace.tangent);
+                sums.add(3, pathwiseDerivative(product, schedule, workspace, kPathwiseBump));
+            } else {
+                const double centred = value - baseline;
+                sums.add(1, centred * sens.deltaScore[i]);
+                sums.add(2, centred * sens.gammaScore[i]);
+                sums.add(3, centred * sens.vegaScore[i]);
+            }
+        }
+        return sums;
+    };
+
+    const auto estimates = runBlocks(model, times, settings, kGreekEstimators, pool, priceBlock,
+                                     true, targets, {0}, redemption ? &tallies : nullptr);
+    if (redemption) *redemption = makeRedemptionProfile(tallies[0], times);
+    return {estimates[0], estimates[1], estimates[2], estimates[3]};
+}
+
+std::vector<std::vector<ScenarioEstimate>> runMonteCarloScenarios(
+    const std::vector<const StructuredProduct*>& products,
+    const std::vector<MonteCarloScenario>& scenarios,
+    const MonteCarloSettings& settings,
+    ThreadPool& pool,
+    std::vector<RedemptionProfile>* redemptions) {
+    if (redemptions) redemptions->assign(products.size(), RedemptionProfile{});
+    if (products.empty() || scenarios.empty()) {
+        return std::vector<std::vector<ScenarioEstimate>>(products.size());
+    }
+    for (const auto& scenario : scenarios) {
+        if (!scenario.data || !scenario.model) {
+            throw std::invalid_argument("Monte Carlo scenario without market data or model");
+        }
+    }
+    const StructuredProduct& lead = *products.front();
+    for (const StructuredProduct* product : products) {
+        if (!product || product->underlying() != lead.underlying() ||
+            product->observationTimes() != lead.observationTimes()) {
+            throw std::invalid_argument(
+                "Products priced on shared paths need the same underlying and observation times");
+        }
+    }
+
+    const std::size_t count = scenarios.size();
+    const std::size_t productCount = products.size();
+    const auto& times = lead.observationTimes();
+    const MonteCarloScenario& base = scenarios.front();
+    const double baseSpot = base.data->getQuote(lead.underlying()).spot;
+
+    // How each scenario obtains its paths: by rescaling the base paths
+    // (spotScale > 0) or by its own simulation on the replayed normals.
+    std::vector<double> spots(count);
+    std::vector<double> rates(count);
+    std::vector<std::string> curves(count);
+    std::vector<PaymentSchedule> schedules(count);
+    std::vector<double> spotScale(count, 0.0);
+    const BrownianGrid baseGrid = base.model->brownianGrid(times);
+    for (std::size_t s = 0; s < count; ++s) {
+        const MonteCarloScenario& scenario = scenarios[s];
+        spots[s] = scenario.data->getQuote(lead.underlying()).spot;
+        rates[s] = scenario.data->riskFreeRate();
+        curves[s] = scenario.model->curveKey(*scenario.data, lead.underlying());
+        schedules[s] = PaymentSchedule(times, *scenario.data);
+        if (s > 0 && scenario.model == base.model && curves[s] == curves[0] &&
+            base.model->isSpotHomogeneous() && baseSpot > 0.0) {
+            spotScale[s] = spots[s] / baseSpot;
+            continue;
+        }
+        const BrownianGrid grid = scenario.model->brownianGrid(times);
+        if (grid.stepTimes != baseGrid.stepTimes || grid.factors != baseGrid.factors) {
+            throw std::invalid_argument(
+                "Monte Carlo scenarios must share the Brownian grid of the base scenario");
+        }
+    }
+
+    std::vector<std::vector<ScenarioEstimate>> results(
+        productCount, std::vector<ScenarioEstimate>(count));
+
+    if (times.empty()) {
+        for (std::size_t k = 0; k < productCount; ++k) {
+            for (std::size_t s = 0; s < count; ++s) {
+                const std::vector<double> immediatePath{spots[s]};
+                results[k][s].value.value =
+                    discountedValue(*products[k], immediatePath, schedules[s]);
+                results[k][s].changeFromBase.value =
+                    results[k][s].value.value - results[k][0].value.value;
+            }
+        }
+        return results;
+    }
+
+    // Path cache, for the scenarios that simulate. Superset grids are only
+    // used when every one of them hits on the same cached grid; mixing
+    // sources would break the common random numbers between scenarios.
+    std::vector<PathCacheKey> cacheKeys(count);
+    std::vector<std::optional<PathCache::Hit>> cached(count);
+    std::vector<std::shared_ptr<CachedPaths>> recorded(count);
+    bool allCached = settings.cache != nullptr;
+    if (settings.cache) {
+        for (int pass = 0; pass < 2; ++pass) {
+            const bool exactGridOnly = pass == 1;
+            allCached = true;
+            const std::vector<double>* sharedGrid = nullptr;
+            bool consistent = true;
+            for (std::size_t s = 0; s < count; ++s) {
+                cached[s].reset();
+                if (spotScale[s] > 0.0) continue;
+                cacheKeys[s] = makeCacheKey(*scenarios[s].model, *scenarios[s].data,
+                                            lead.underlying(), spots[s], rates[s], settings);
+                if (cacheKeys[s].model.empty()) {
+                    allCached = false;
+                    continue;
+                }
+                cached[s] = settings.cache->find(cacheKeys[s], times, exactGridOnly);
+                if (!cached[s]) {
+                    allCached = false;
+                    continue;
+                }
+                const std::vector<double>& grid = cached[s]->paths->times;
+                if (sharedGrid && grid != *sharedGrid) consistent = false;
+                sharedGrid = &grid;
+            }
+            const bool onlyExact = !sharedGrid || *sharedGrid == times;
+            if ((allCached && consistent) || onlyExact) break;
+        }
+        for (std::size_t s = 0; s < count && !isAdaptive(settings); ++s) {
+            if (spotScale[s] > 0.0 || cached[s] || cacheKeys[s].model.empty()) continue;
+            recorded[s] = std::make_shared<CachedPaths>();
+            recorded[s]->times = times;
+            recorded[s]->blocks.resize(blockTaskCount(settings));
+        }
+    }
+    static const std::vector<std::size_t> allColumns;
+
+    // Early termination: the base paths are read by every product at every
+    // rescaled spot, the other simulated scenarios at their own spot only.
+    std::vector<double> baseScales{1.0};
+    for (std::size_t s = 1; s < count; ++s) {
+        if (spotScale[s] > 0.0) baseScales.push_back(spotScale[s]);
+    }
+    const ProductTermination baseTermination(products, baseScales);
+    const ProductTermination ownTermination(products, {1.0});
+
+    // Estimators of product k: its value in every scenario, then the change
+    // of each scenario from the base, i.e. slots [2 * count * k, 2 * count * (k + 1)).
+    // Control variates adjust the base value of each product (slot 2 * count * k).
+    const std::size_t estimators = 2 * count * productCount;
+    std::vector<ControlTarget> targets;
+    std::vector<std::size_t> targetOf(productCount, productCount);
+    for (std::size_t k = 0; k < productCount; ++k) {
+        addControlTarget(targets, 2 * count * k, *products[k], *base.model, *base.data,
+                         baseSpot, settings);
+        if (!targets.empty() && targets.back().slot == 2 * count * k) {
+            targetOf[k] = targets.size() - 1;
+        }
+    }
+
+    // Cached paths are complete and were drawn from complete base tapes, so
+    // a run touching the cache simulates in full; so does a run whose
+    // controls read the whole path.
+    bool stopEarly = settings.earlyTermination && targets.empty() &&
+                     baseTermination.canTerminate();
+    for (std::size_t s = 0; s < count; ++s) {
+        if (cached[s] || recorded[s]) stopEarly = false;
+    }
+    std::vector<const PathTermination*> stopRules(count, nullptr);
+    for (std::size_t s = 0; stopEarly && s < count; ++s) {
+        stopRules[s] = s == 0 ? &baseTermination : &ownTermination;
+    }
+    const std::size_t sampleSize = pathsPerSample(settings);
+    std::vector<RedemptionTally> tallies;
+    if (redemptions) tallies = emptyTallies(products, times.size());
+
+    auto priceBlock = [&](std::size_t task, NormalStream& normals, std::size_t paths) {
+        thread_local BlockWorkspace workspace;
+        thread_local std::vector<const PathBatch*> sources;
+        thread_local std::vector<const std::vector<std::size_t>*> columns;
+        workspace.scenarioBatches.resize(count);
+        workspace.scenarioValues.resize(count * productCount);
+        sources.assign(count, nullptr);
+        columns.assign(count, &allColumns);
+
+        // Draw once for the base scenario, replay for the other simulated
+        // ones. The base is re-simulated even when cached if another scenario
+        // needs the tape: cache and simulation agree on an exact grid.
+        if (!allCached) {
+            {
+                RecordingNormals recorder(normals, workspace.tape);
+                simulateBlock(*base.model, baseSpot, times, *base.data, recorder, paths,
+                              workspace.batch, stopRules[0]);
+            }
+            sources[0] = &workspace.batch;
+            if (recorded[0]) recorded[0]->blocks[task] = workspace.batch;
+        }
+        for (std::size_t s = 0; s < count; ++s) {
+            if (spotScale[s] > 0.0) continue;
+            if (cached[s]) {
+                sources[s] = &cached[s]->paths->blocks[task];
+                columns[s] = &cached[s]->columns;
+            } else if (s > 0) {
+                ReplayNormals replay(workspace.tape, settings.seed,
+                                     kSpareStreams | blockStreamIndex(settings, task));
+                simulateBlock(*scenarios[s].model, spots[s], times, *scenarios[s].data,
+                              replay, paths, workspace.scenarioBatches[s], stopRules[s]);
+                sources[s] = &workspace.scenarioBatches[s];
+                if (recorded[s]) recorded[s]->blocks[task] = workspace.scenarioBatches[s];
+            }
+        }
+
+        BlockSums sums(estimators, sampleSize);
+        startControls(sums, targets);
+        sums.redemptions = tallies;
+        for (std::size_t i = 0; i < paths; ++i) {
+            for (std::size_t s = 0; s < count; ++s) {
+                if (spotScale[s] > 0.0) {
+                    gatherPath(*sources[0], *columns[0], i, workspace.path);
+                    for (double& spot : workspace.path) spot *= spotScale[s];
+                } else {
+                    gatherPath(*sources[s], *columns[s], i, workspace.path);
+                }
+                for (std::size_t k = 0; k < productCount; ++k) {
+                    workspace.scenarioValues[k * count + s] =
+                        s == 0 && redemptions
+                            ? tallyRedemption(*products[k], workspace.path, schedules[0],
+                                              sums.redemptions[k])
+                            : discountedValue(*products[k], workspace.path, schedules[s]);
+                }
+                if (s > 0 || targets.empty()) continue;
+                for (std::size_t k = 0; k < productCount; ++k) {
+                    if (targetOf[k] == productCount) continue;
+                    addControlSample(sums, targets, targetOf[k], workspace.path,
+                                     workspace.scenarioValues[k * count],
+                                     workspace.controlValues);
+                }
+            }
+            for (std::size_t k = 0; k < productCount; ++k) {
+                const double* values = workspace.scenarioValues.data() + k * count;
+                const std::size_t slot = 2 * count * k;
+                for (std::size_t s = 0; s < count; ++s) {
+                    sums.add(slot + s, values[s]);
+                    sums.add(slot + count + s, values[s] - values[0]);
+                }
+            }
+        }
+        return sums;
+    };
+
+    // An adaptive run goes on until the base value of every product converged.
+    std::vector<std::size_t> prices(productCount);
+    for (std::size_t k = 0; k < productCount; ++k) prices[k] = 2 * count * k;
+    const auto estimates = runBlocks(*base.model, times, settings, estimators, pool,
+                                     priceBlock, !allCached, targets, prices,
+                                     redemptions ? &tallies : nullptr);
+    for (std::size_t s = 0; s < count; ++s) {
+        if (recorded[s]) settings.cache->insert(cacheKeys[s], std::move(recorded[s]));
+    }
+    for (std::size_t k = 0; k < productCount; ++k) {
+        const std::size_t slot = 2 * count * k;
+        for (std::size_t s = 0; s < count; ++s) {
+            results[k][s].value = estimates[slot + s];
+            results[k][s].changeFromBase = estimates[slot + count + s];
+        }
+        if (redemptions) (*redemptions)[k] = makeRedemptionProfile(tallies[k], times);
+    }
+    return results;
+}
+
+std::vector<ScenarioEstimate> runMonteCarloScenarios(
+    const StructuredProduct& product,
+    const std::vector<MonteCarloScenario>& scenarios,
+    const MonteCarloSettings& settings,
+    ThreadPool& pool,
+    RedemptionProfile* redemption) {
+    std::vector<RedemptionProfile> redemptions;
+    auto results = runMonteCarloScenarios(std::vector<const StructuredProduct*>{&product},
+                                          scenarios, settings, pool,
+                                          redemption ? &redemptions : nullptr);
+    if (redemption) *redemption = std::move(redemptions.front());
+    return std::move(results.front());
+}
@@ -0,0 +1,297 @@
+/*
+ * SUMMARY: Correlated multi-asset Black-Scholes path generator.
+ * The correlation matrix is factorized once (Cholesky); each moving date
+ * draws one block of independent normals for all assets, correlates it in
+ * place with the vectorized SimdMath kernel and advances every asset with the
+ * exp kernel. The assets x dates x paths block is then reduced to a basket
+ * level (worst-of, best-of or average of the performances, or compounded
+ * from those of the period returns) so the existing single-asset payoffs
+ * price worst-of and basket products unchanged.
+ */
+
+#include "MultiAssetMC.hpp"
+#include "SimdMath.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+// Row-major lower-triangular L with L L^T = matrix.
+std::vector<double> cholesky(const std::vector<double>& matrix, std::size_t n) {
+    std::vector<double> lower(n * n, 0.0);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j <= i; ++j) {
+            double sum = matrix[i * n + j];
+            for (std::size_t k = 0; k < j; ++k) sum -= lower[i * n + k] * lower[j * n + k];
+            if (i == j) {
+                if (!(sum > 0.0)) {
+                    throw std::invalid_argument(
+                        "MultiAssetMC: correlation matrix is not positive definite");
+                }
+                lower[i * n + i] = std::sqrt(sum);
+            } else {
+                lower[i * n + j] = sum / lower[j * n + j];
+            }
+        }
+    }
+    return lower;
+}
+
+// level[p] = spot0 * basket of perf_a[p] over the assets of date d. With
+// 'previous' (the level of date d - 1), level[p] = previous[p] * basket of the
+// period returns perf_a(d)[p] / perf_a(d - 1)[p] instead.
+void reduceBasket(const MultiAssetBatch& assets, std::size_t d, BasketType type,
+                  double spot0, const double* previous, double* level) {
+    const std::size_t paths = assets.paths();
+    thread_local std::vector<double> returns;
+    for (std::size_t a = 0; a < assets.assets(); ++a) {
+        const double* perf = assets.row(a, d);
+        if (previous) {
+            const double* start = assets.row(a, d - 1);
+            returns.resize(paths);
+            for (std::size_t p = 0; p < paths; ++p) returns[p] = perf[p] / start[p];
+            perf = returns.data();
+        }
+        if (a == 0) {
+            std::copy(perf, perf + paths, level);
+            continue;
+        }
+        switch (type) {
+        case BasketType::WorstOf:
+            for (std::size_t p = 0; p < paths; ++p) level[p] = std::min(level[p], perf[p]);
+            break;
+        case BasketType::BestOf:
+            for (std::size_t p = 0; p < paths; ++p) level[p] = std::max(level[p], perf[p]);
+            break;
+        case BasketType::Average:
+            for (std::size_t p = 0; p < paths; ++p) level[p] += perf[p];
+            break;
+        }
+    }
+    const double share = type == BasketType::Average
+                             ? 1.0 / static_cast<double>(assets.assets())
+                             : 1.0;
+    if (previous) {
+        for (std::size_t p = 0; p < paths; ++p) level[p] *= share * previous[p];
+    } else {
+        for (std::size_t p = 0; p < paths; ++p) level[p] *= share * spot0;
+    }
+}
+} // namespace
+
+MultiAssetMC::MultiAssetMC(std::vector<BasketAsset> assets,
+                           const std::vector<double>& correlation, BasketType type,
+                           BasketObservation observation)
+    : assets_(std::move(assets)), correlation_(correlation), type_(type),
+      observation_(observation) {
+    const std::size_t n = assets_.size();
+    if (n == 0) throw std::invalid_argument("MultiAssetMC: empty basket");
+    if (correlation_.size() != n * n) {
+        throw std::invalid_argument("MultiAssetMC: correlation matrix must be " +
+                                    std::to_string(n) + " x " + std::to_string(n));
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        if (correlation_[i * n + i] != 1.0) {
+            throw std::invalid_argument("MultiAssetMC: correlation diagonal must be 1");
+        }
+        for (std::size_t j = 0; j < i; ++j) {
+            if (correlation_[i * n + j] != correlation_[j * n + i]) {
+                throw std::invalid_argument("MultiAssetMC: correlation matrix must be symmetric");
+            }
+        }
+    }
+    cholesky_ = cholesky(correlation_, n);
+}
+
+std::string MultiAssetMC::cacheKey() const {
+    // Hex floats keep every bit of the parameters in the key.
+    std::ostringstream key;
+    key << "MultiAsset:" << static_cast<int>(type_) << ':' << static_cast<int>(observation_)
+        << std::hexfloat;
+    for (const BasketAsset& asset : assets_) key << ':' << asset.underlying << '=' << asset.sigma;
+    key << ":rho";
+    for (double rho : correlation_) key << ',' << rho;
+    return key.str();
+}
+
+std::string MultiAssetMC::curveKey(const MarketData& data,
+                                   const std::string& underlying) const {
+    std::string key = data.curveKey(underlying);
+    for (const BasketAsset& asset : assets_) {
+        key += '|' + asset.underlying + '=' + data.curveKey(asset.underlying);
+    }
+    return key;
+}
+
+BrownianGrid MultiAssetMC::brownianGrid(const std::vector<double>& times) const {
+    // Same clock as BlackScholesMC, one factor per asset.
+    BrownianGrid grid;
+    grid.factors = assets_.size();
+    double currentTime = 0.0;
+    double clock = 0.0;
+    for (double t : times) {
+        const double dt = t - currentTime;
+        if (dt > 1e-8) {
+            clock += dt;
+            grid.stepTimes.push_back(clock);
+        }
+        currentTime = t;
+    }
+    return grid;
+}
+
+SpotMarginals MultiAssetMC::marginals(const std::vector<double>& times,
+                                      const MarketData& data) const {
+    SpotMarginals marginals;
+    if (type_ != BasketType::Average) return marginals;
+    const std::size_t n = assets_.size();
+    const bool periodic = observation_ == BasketObservation::PeriodReturns;
+    marginals.forward.assign(times.size(), 0.0);
+    for (std::size_t a = 0; a < n; ++a) {
+        const auto forward = data.forwardGrid(assets_[a].underlying, times);
+        double growth = 0.0;
+        double currentTime = 0.0;
+        for (std::size_t d = 0; d < times.size(); ++d) {
+            const double dt = std::max(times[d] - currentTime, 0.0);
+            if (periodic) growth = 0.0;
+            if (dt > 1e-8) growth += forward->carryRate[d] * dt;
+            marginals.forward[d] += std::exp(growth) / static_cast<double>(n);
+            currentTime = times[d];
+        }
+    }
+    // Period returns are independent from one period to the next, so the
+    // mean of their compounded average is the product of the mean averages.
+    if (periodic) {
+        for (std::size_t d = 1; d < times.size(); ++d) {
+            marginals.forward[d] *= marginals.forward[d - 1];
+        }
+    }
+    return marginals;
+}
+
+void MultiAssetMC::stepParameters(std::size_t a, const MarketData::ForwardGrid& forward,
+                                  std::size_t d, double dt, double& drift,
+                                  double& vol) const {
+    if (forward.variance.empty()) {
+        const double sigma = assets_[a].sigma;
+        vol = sigma;
+        drift = (forward.carryRate[d] - 0.5 * sigma * sigma) * dt;
+    } else {
+        vol = std::sqrt(forward.variance[d] / dt);
+        drift = forward.carryRate[d] * dt - 0.5 * forward.variance[d];
+    }
+}
+
+void MultiAssetMC::simulateAssets(const std::vector<double>& times,
+                                  const MarketData& data,
+                                  NormalStream& normalStream,
+                                  std::size_t paths,
+                                  MultiAssetBatch& batch) const {
+    const std::size_t n = assets_.size();
+    batch.resize(n, paths, times.size());
+    if (times.empty() || paths == 0) return;
+
+    std::vector<std::shared_ptr<const MarketData::ForwardGrid>> forwards(n);
+    for (std::size_t a = 0; a < n; ++a) {
+        forwards[a] = data.forwardGrid(assets_[a].underlying, times);
+    }
+
+    // One date's worth of normals for every asset and path, factor-major.
+    thread_local std::vector<double> normals;
+    normals.resize(n * paths);
+
+    double currentTime = 0.0;
+    for (std::size_t d = 0; d < times.size(); ++d) {
+        for (std::size_t a = 0; a < n; ++a) {
+            double* row = batch.row(a, d);
+            if (d == 0) {
+                std::fill(row, row + paths, 1.0);
+            } else {
+                std::copy(batch.row(a, d - 1), batch.row(a, d - 1) + paths, row);
+            }
+        }
+
+        const double dt = std::max(times[d] - currentTime, 0.0);
+        if (dt > 1e-8) {
+            normalStream.next(normals.data(), normals.size());
+            correlateNormals(cholesky_.data(), n, normals.data(), paths);
+            for (std::size_t a = 0; a < n; ++a) {
+                double drift = 0.0;
+                double vol = 0.0;
+                stepParameters(a, *forwards[a], d, dt, drift, vol);
+                double* row = batch.row(a, d);
+                scaledExp(row, normals.data() + a * paths, drift, vol * std::sqrt(dt), row,
+                          paths);
+            }
+        }
+        currentTime = times[d];
+    }
+}
+
+void MultiAssetMC::simulatePaths(double spot0,
+                                 const std::vector<double>& times,
+                                 const MarketData& data,
+                                 NormalStream& normalStream,
+                                 std::size_t paths,
+                                 PathBatch& batch) const {
+    batch.resize(paths, times.size());
+    thread_local MultiAssetBatch assets;
+    simulateAssets(times, data, normalStream, paths, assets);
+    if (times.empty() || paths == 0) return;
+    const bool periodic = observation_ == BasketObservation::PeriodReturns;
+    for (std::size_t d = 0; d < times.size(); ++d) {
+        const double* previous = periodic && d > 0 ? batch.date(d - 1) : nullptr;
+        reduceBasket(assets, d, type_, spot0, previous, batch.date(d));
+    }
+}
+
+std::vector<double> MultiAssetMC::simulatePath(double spot0,
+                                               const std::vector<double>& times,
+                                               const MarketData& data,
+                                               std::mt19937& rng) const {
+    const std::size_t n = assets_.size();
+    std::vector<std::shared_ptr<const MarketData::ForwardGrid>> forwards(n);
+    for (std::size_t a = 0; a < n; ++a) {
+        forwards[a] = data.forwardGrid(assets_[a].underlying, times);
+    }
+
+    std::normal_distribution<double> dist(0.0, 1.0);
+    std::vector<double> path(times.size());
+    std::vector<double> performance(n, 1.0);
+    std::vector<double> start(n, 1.0); // Performances of the previous date.
+    std::vector<double> z(n);
+    const bool periodic = observation_ == BasketObservation::PeriodReturns;
+    double currentTime = 0.0;
+    for (std::size_t d = 0; d < times.size(); ++d) {
+        const double dt = std::max(times[d] - currentTime, 0.0);
+        if (dt > 1e-8) {
+            for (double& value : z) value = dist(rng);
+            for (std::size_t a = 0; a < n; ++a) {
+                // Correlated draw of asset a: row a of L times z.
+                double w = 0.0;
+                for (std::size_t k = 0; k <= a; ++k) w += cholesky_[a * n + k] * z[k];
+                double drift = 0.0;
+                double vol = 0.0;
+                stepParameters(a, *forwards[a], d, dt, drift, vol);
+                performance[a] *= std::exp(drift + vol * std::sqrt(dt) * w);
+            }
+        }
+
+        double level = performance[0] / start[0];
+        for (std::size_t a = 1; a < n; ++a) {
+            const double value = performance[a] / start[a];
+            if (type_ == BasketType::WorstOf) level = std::min(level, value);
+            else if (type_ == BasketType::BestOf) level = std::max(level, value);
+            else level += value;
+        }
+        if (type_ == BasketType::Average) level /= static_cast<double>(n);
+        path[d] = (periodic && d > 0 ? path[d - 1] : spot0) * level;
+        if (periodic) start = performance;
+        currentTime = times[d];
+    }
+    return path;
+}
@@ -0,0 +1,107 @@
+/*
+ * SUMMARY: Counter-based pseudo-random normal streams.
+ * Every stream reads its values off a Philox stream by position, so a model
+ * that drops terminated paths gets, for the paths it keeps, exactly the
+ * values a full step would have given them. Antithetic streams read one
+ * normal per pair of neighbouring paths and hand its negation to the second
+ * path, halving the random numbers a block consumes. Moment-matched streams
+ * rescale each step's row so that its first two sample moments are exact.
+ */
+
+#include "NormalStream.hpp"
+
+#include <cmath>
+
+namespace {
+// Shifts and scales z[0 .. n) to a sample mean of 0 and a mean square of 1.
+void matchMoments(double* z, std::size_t n) {
+    if (n < 2) return;
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; ++i) sum += z[i];
+    const double mean = sum / static_cast<double>(n);
+    double sumSq = 0.0;
+    for (std::size_t i = 0; i < n; ++i) sumSq += (z[i] - mean) * (z[i] - mean);
+    if (!(sumSq > 0.0)) return;
+    const double scale = std::sqrt(static_cast<double>(n) / sumSq);
+    for (std::size_t i = 0; i < n; ++i) z[i] = (z[i] - mean) * scale;
+}
+
+// Positions next() would read for the live lanes of a factors x paths step
+// starting at 'first', factor-major over the lanes.
+void livePositions(std::uint64_t first, std::size_t factors, std::size_t paths,
+                   const std::size_t* live, std::size_t lanes,
+                   std::vector<std::uint64_t>& positions) {
+    positions.resize(factors * lanes);
+    for (std::size_t f = 0; f < factors; ++f) {
+        for (std::size_t k = 0; k < lanes; ++k) {
+            positions[f * lanes + k] = first + f * paths + live[k];
+        }
+    }
+}
+} // namespace
+
+void PhiloxNormals::next(double* z, std::size_t count) {
+    fillPhiloxNormals(stream_, position_, z, count);
+    position_ += count;
+}
+
+void PhiloxNormals::nextLive(double* z, std::size_t factors, std::size_t paths,
+                             const std::size_t* live, std::size_t lanes) {
+    livePositions(position_, factors, paths, live, lanes, positions_);
+    gatherPhiloxNormals(stream_, positions_.data(), z, positions_.size());
+    position_ += factors * paths;
+}
+
+void AntitheticNormals::next(double* z, std::size_t count) {
+    // A count that is not whole rows of the block is paired as one row.
+    const std::size_t row = paths_ > 0 && count % paths_ == 0 ? paths_ : count;
+    if (row == 0) return;
+    const std::size_t rows = count / row;
+    const std::size_t half = (row + 1) / 2;
+    draws_.resize(rows * half);
+    fillPhiloxNormals(stream_, position_, draws_.data(), draws_.size());
+    position_ += draws_.size();
+    for (std::size_t r = 0; r < rows; ++r) {
+        const double* x = draws_.data() + r * half;
+        double* out = z + r * row;
+        for (std::size_t j = 0; j < row / 2; ++j) {
+            out[2 * j] = x[j];
+            out[2 * j + 1] = -x[j];
+        }
+        if (row % 2 == 1) out[row - 1] = x[half - 1];
+    }
+}
+
+void AntitheticNormals::nextLive(double* z, std::size_t factors, std::size_t paths,
+                                 const std::size_t* live, std::size_t lanes) {
+    // Path p reads value p / 2 of its row, negated when p is odd.
+    const std::size_t half = (paths + 1) / 2;
+    positions_.resize(factors * lanes);
+    for (std::size_t f = 0; f < factors; ++f) {
+        for (std::size_t k = 0; k < lanes; ++k) {
+            positions_[f * lanes + k] = position_ + f * half + live[k] / 2;
+        }
+    }
+    gatherPhiloxNormals(stream_, positions_.data(), z, positions_.size());
+    for (std::size_t f = 0; f < factors; ++f) {
+        for (std::size_t k = 0; k < lanes; ++k) {
+            if (live[k] % 2 == 1) z[f * lanes + k] = -z[f * lanes + k];
+        }
+    }
+    position_ += factors * half;
+}
+
+void MomentMatchedNormals::next(double* z, std::size_t count) {
+    fillPhiloxNormals(stream_, position_, z, count);
+    position_ += count;
+    const std::size_t row = paths_ > 0 && count % paths_ == 0 ? paths_ : count;
+    for (std::size_t first = 0; first < count; first += row) matchMoments(z + first, row);
+}
+
+void MomentMatchedNormals::nextLive(double* z, std::size_t factors, std::size_t paths,
+                                    const std::size_t* live, std::size_t lanes) {
+    livePositions(position_, factors, paths, live, lanes, positions_);
+    gatherPhiloxNormals(stream_, positions_.data(), z, positions_.size());
+    position_ += factors * paths;
+    for (std::size_t f = 0; f < factors; ++f) matchMoments(z + f * lanes, lanes);
+}
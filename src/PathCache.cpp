@@ -0,0 +1,160 @@
+/*
+ * SUMMARY: LRU cache of simulated path sets.
+ * Keys combine the model parameters, the market inputs of the simulation and
+ * the Monte Carlo settings; the observation grid is matched separately so a
+ * product observing a subset of a cached grid can reuse its columns. Entries
+ * are shared_ptr-owned, so eviction never pulls paths from under a pricing
+ * that is still reading them.
+ */
+
+#include "PathCache.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace {
+void combineHash(std::size_t& seed, std::size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+// Date index in 'grid' of every date of 'times'; false if one is missing.
+bool mapColumns(const std::vector<double>& grid, const std::vector<double>& times,
+                std::vector<std::size_t>& columns) {
+    columns.clear();
+    std::size_t from = 0;
+    for (double t : times) {
+        const auto it = std::find(grid.begin() + from, grid.end(), t);
+        if (it == grid.end()) return false;
+        columns.push_back(static_cast<std::size_t>(it - grid.begin()));
+        from = columns.back();
+    }
+    return true;
+}
+} // namespace
+
+std::size_t PathCacheKey::hash() const {
+    std::size_t h = std::hash<std::string>{}(model);
+    combineHash(h, std::hash<double>{}(spot));
+    combineHash(h, std::hash<double>{}(rate));
+    combineHash(h, seed);
+    combineHash(h, paths);
+    combineHash(h, static_cast<std::size_t>(sampling));
+    combineHash(h, static_cast<std::size_t>(normalScheme));
+    combineHash(h, static_cast<std::size_t>(scrambling));
+    combineHash(h, qmcReplications);
+    return h;
+}
+
+bool PathCacheKey::operator==(const PathCacheKey& other) const {
+    return model == other.model && spot == other.spot && rate == other.rate &&
+           seed == other.seed && paths == other.paths &&
+           sampling == other.sampling && normalScheme == other.normalScheme &&
+           scrambling == other.scrambling &&
+           qmcReplications == other.qmcReplications;
+}
+
+std::size_t CachedPaths::bytes() const {
+    std::size_t total = times.size() * sizeof(double);
+    for (const auto& block : blocks) {
+        total += block.paths() * block.dates() * sizeof(double);
+    }
+    return total;
+}
+
+PathCache::PathCache(std::size_t byteBudget, bool reuseSupersetGrids)
+    : byteBudget_(byteBudget), reuseSupersetGrids_(reuseSupersetGrids) {}
+
+std::optional<PathCache::Hit> PathCache::find(const PathCacheKey& key,
+                                              const std::vector<double>& times,
+                                              bool exactGridOnly) {
+    const std::size_t hash = key.hash();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // An exact grid wins; otherwise the most recently used superset grid.
+    auto best = entries_.end();
+    std::vector<std::size_t> columns;
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->hash != hash || !(it->key == key)) continue;
+        if (it->paths->times == times) {
+            best = it;
+            break;
+        }
+        if (best == entries_.end() && reuseSupersetGrids_ && !exactGridOnly &&
+            mapColumns(it->paths->times, times, columns)) {
+            best = it;
+        }
+    }
+    if (best == entries_.end()) {
+        ++misses_;
+        return std::nullopt;
+    }
+    if (best->paths->times == times) {
+        columns.clear();
+    } else {
+        mapColumns(best->paths->times, times, columns);
+    }
+
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, best);
+    return Hit{entries_.front().paths, std::move(columns)};
+}
+
+void PathCache::insert(const PathCacheKey& key,
+                       std::shared_ptr<const CachedPaths> paths) {
+    if (!paths) return;
+    const std::size_t size = paths->bytes();
+    if (size > byteBudget_) return;
+
+    const std::size_t hash = key.hash();
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Replace an entry on the same grid (e.g. filled concurrently).
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->hash == hash && it->key == key && it->paths->times == paths->times) {
+            bytes_ -= it->bytes;
+            entries_.erase(it);
+            break;
+        }
+    }
+    entries_.push_front({key, hash, std::move(paths), size});
+    bytes_ += size;
+    evictToFit();
+}
+
+void PathCache::evictToFit() {
+    while (bytes_ > byteBudget_ && !entries_.empty()) {
+        bytes_ -= entries_.back().bytes;
+        entries_.pop_back();
+    }
+}
+
+void PathCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    bytes_ = 0;
+}
+
+std::size_t PathCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+std::size_t PathCache::entries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::size_t PathCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+std::size_t PathCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+PathCache& PathCache::shared() {
+    static PathCache cache;
+    return cache;
+}
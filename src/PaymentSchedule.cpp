@@ -0,0 +1,17 @@
+/*
+ * SUMMARY: Per-pricing table of payment dates and discount factors.
+ * Built once before the Monte Carlo loop from the product's observation dates
+ * and the market's discount curve; the loop then discounts every flow with a
+ * single multiply by date index.
+ */
+
+#include "PaymentSchedule.hpp"
+
+#include <utility>
+
+PaymentSchedule::PaymentSchedule(std::vector<double> times, const MarketData& data)
+    : times_(std::move(times)), discountFactors_(times_.size()) {
+    for (std::size_t d = 0; d < times_.size(); ++d) {
+        discountFactors_[d] = data.discountFactor(times_[d]);
+    }
+}
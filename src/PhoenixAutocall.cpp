@@ -21,8 +21,8 @@ PhoenixAutocall::PhoenixAutocall(std::string underlying,
                    notional, couponRate, callBarrier, protectionBarrier),
       couponBarrier_(couponBarrier) {}
 
-std::vector<CashFlow> PhoenixAutocall::cashFlows(const std::vector<double>& path) const {
-    std::vector<CashFlow> flows;
+void PhoenixAutocall::emitCashFlows(const std::vector<double>& path,
+                                    CashFlowSink& sink) const {
     const auto& obs = times();
     const std::size_t steps = std::min(path.size(), obs.size());
 
@@ -30,20 +30,19 @@ std::vector<CashFlow> PhoenixAutocall::cashFlows(const std::vector<double>& path
         // 1. Check Autocall Condition (Priority #1)
         if (path[i] >= callBarrier()) {
             // Success: Pay capital + current coupon and terminate immediately.
-            flows.push_back({notional() * (1.0 + couponRate()), obs[i]});
-            return flows;
+            sink.onCashFlow(i, notional() * (1.0 + couponRate()));
+            return;
         }
 
         // 2. Check Coupon Condition (Phoenix specific)
         // If we are here, we didn't autocall. However, we still check if 
         // the spot is high enough to warrant a coupon payment for this period.
         if (path[i] >= couponBarrier_) {
-            flows.push_back({notional() * couponRate(), obs[i]});
+            sink.onCashFlow(i, notional() * couponRate());
         }
     }
 
     // No early exit occurred; calculate the final redemption at maturity.
     const double finalSpot = (steps > 0) ? path[steps - 1] : spot0();
-    flows.push_back({terminalRedemption(finalSpot), obs.back()});
-    return flows;
+    sink.onCashFlow(maturityIndex(), terminalRedemption(finalSpot));
 }
\ No newline at end of file
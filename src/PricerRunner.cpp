@@ -1,9 +1,12 @@
 /*
  * SUMMARY: The central orchestration layer for the pricing engine.
  * It acts as a factory to instantiate the specific product (e.g., Phoenix, Airbag)
- * and stochastic model (Black-Scholes or Heston) based on user inputs.
- * It then executes the Monte Carlo simulation and calculates key risk metrics
- * (Delta, Vega) by re-running the pricing loop with perturbed market data.
+ * and stochastic model (Black-Scholes, Heston, local vol or a correlated
+ * multi-asset basket) based on user inputs.
+ * It then executes the (multithreaded) Monte Carlo simulation and calculates key
+ * risk metrics (Delta, Gamma, Vega), either by re-running the pricing loop with
+ * perturbed market data on the same random streams, or from the base paths in
+ * a single pass (pathwise / likelihood-ratio estimators) when the model allows.
  */
 
 #include "PricerRunner.hpp"
@@ -17,97 +20,81 @@
 #include "StepDownAutocall.hpp"
 
 #include "BlackScholesMC.hpp"
+#include "Calibration.hpp"
 #include "HestonMC.hpp"
+#include "LocalVolMC.hpp"
 #include "MarketData.hpp"
+#include "MonteCarloEngine.hpp"
+#include "MultiAssetMC.hpp"
+#include "PathCache.hpp"
 #include "PathModel.hpp"
+#include "TermCurve.hpp"
+#include "ThreadPool.hpp"
 
 #include <algorithm>
 #include <cmath>
+#include <map>
 #include <memory>
-#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 namespace {
 constexpr double kSpotBumpFraction = 0.005;
 constexpr double kVolBumpAdd = 0.01;
 
+ImpliedVolSurface makeVolSurface(const PricingInputs &inputs) {
+  if (inputs.surfaceVols.empty()) return ImpliedVolSurface(inputs.sigma);
+  return ImpliedVolSurface(inputs.surfaceExpiries, inputs.surfaceMoneyness,
+                           inputs.surfaceVols);
+}
+
+// Capped-coupon cliquets pay on period returns, so their basket level must
+// compound the basket of the assets' period returns; every other payoff reads
+// the basket of the performances.
+BasketObservation basketObservation(const PricingInputs &inputs) {
+  return inputs.productFamily == ProductFamily::Cliquet &&
+                 inputs.cliquetType == CliquetType::CappedCoupons
+             ? BasketObservation::PeriodReturns
+             : BasketObservation::Performance;
+}
+
 // Factory helper to create the model with the correct parameters
 std::unique_ptr<PathModelBase> makePathModel(const PricingInputs &inputs) {
+  if (!inputs.basketUnderlyings.empty()) {
+    if (inputs.modelType != ModelType::BlackScholes) {
+      throw std::invalid_argument("Basket products support the Black-Scholes model only");
+    }
+    if (inputs.basketVols.size() != inputs.basketUnderlyings.size()) {
+      throw std::invalid_argument("Basket needs one vol per underlying");
+    }
+    std::vector<BasketAsset> assets;
+    for (std::size_t i = 0; i < inputs.basketUnderlyings.size(); ++i) {
+      assets.push_back({inputs.basketUnderlyings[i], inputs.basketVols[i]});
+    }
+    return std::make_unique<MultiAssetMC>(std::move(assets),
+                                          inputs.basketCorrelation,
+                                          inputs.basketType,
+                                          basketObservation(inputs));
+  }
   switch (inputs.modelType) {
   case ModelType::BlackScholes:
     // Pass sigma directly to the BS model
-    return std::make_unique<BlackScholesMC>(inputs.sigma);
+    return std::make_unique<BlackScholesMC>(inputs.sigma, inputs.underlying);
   case ModelType::Heston:
     return std::make_unique<HestonMC>(inputs.hestonV0, inputs.hestonKappa,
                                       inputs.hestonTheta, inputs.hestonXi,
-                                      inputs.hestonRho);
-  }
-  return std::make_unique<BlackScholesMC>(inputs.sigma);
-}
-
-// -----------------------------------------------------------------------------
-// CORE PRICING LOOP
-// -----------------------------------------------------------------------------
-double runMonteCarlo(const StructuredProduct &product, const MarketData &data,
-                     const PathModelBase &model, std::size_t paths,
-                     unsigned int seed, double &standardError) {
-  const auto &times = product.observationTimes();
-  const auto &quote = data.getQuote(product.underlying());
-  const double r = data.riskFreeRate();
-
-  std::vector<double> immediatePath{quote.spot};
-
-  // Edge case: Product with no observation times (immediate payoff?)
-  if (times.empty()) {
-    // UPDATED: Use cashFlows instead of discountedPayoff
-    auto flows = product.cashFlows(immediatePath);
-    double val = 0.0;
-    for (const auto &flow : flows) {
-      val += flow.amount * std::exp(-r * flow.time);
-    }
-    standardError = 0.0;
-    return val;
+                                      inputs.hestonRho, inputs.underlying,
+                                      inputs.hestonScheme, inputs.hestonMaxStep);
+  case ModelType::LocalVol:
+    return std::make_unique<LocalVolMC>(makeVolSurface(inputs), inputs.underlying);
   }
-
-  std::mt19937 rng(seed);
-  double payoffSum = 0.0;
-  double payoffSqSum = 0.0;
-
-  for (std::size_t i = 0; i < paths; ++i) {
-    // 1. Simulate Path
-    const std::vector<double> path =
-        model.simulatePath(quote.spot, times, data, rng);
-
-    // 2. Retrieve Cash Flows (New Architecture)
-    // We handle the case where the path might be empty (rare) by using immediatePath
-    std::vector<CashFlow> flows = product.cashFlows(path.empty() ? immediatePath : path);
-
-    // 3. Manual Discounting
-    double pathValue = 0.0;
-    for (const auto &flow : flows) {
-        pathValue += flow.amount * std::exp(-r * flow.time);
-    }
-
-    payoffSum += pathValue;
-    payoffSqSum += pathValue * pathValue;
-  }
-
-  const double n = static_cast<double>(paths);
-  const double mean = payoffSum / n;
-  const double numerator = payoffSqSum - n * mean * mean;
-  const double sampleVariance =
-      n > 1 ? std::max(numerator / (n - 1.0), 0.0) : 0.0;
-  standardError = n > 0 ? std::sqrt(sampleVariance / n) : 0.0;
-  return mean;
+  return std::make_unique<BlackScholesMC>(inputs.sigma, inputs.underlying);
 }
-} // namespace
-
-PricingResults priceAutocall(const PricingInputs &inputs) {
-  MarketData marketData;
-  marketData.setRiskFreeRate(inputs.rate);
-  marketData.setQuote(inputs.underlying,
-                      MarketData::Quote{inputs.spot, inputs.sigma});
 
+std::unique_ptr<StructuredProduct> makeProduct(const PricingInputs &inputs) {
   std::unique_ptr<StructuredProduct> product;
   if (inputs.productFamily == ProductFamily::Autocall) {
     switch (inputs.autocallType) {
@@ -160,66 +147,389 @@ PricingResults priceAutocall(const PricingInputs &inputs) {
       break;
     }
   }
+  return product;
+}
 
-  double stdError = 0.0;
-  auto pathModel = makePathModel(inputs);
+MarketData makeMarketData(const PricingInputs &inputs) {
+  MarketData marketData;
+  marketData.setRiskFreeRate(inputs.rate);
+  marketData.setQuote(inputs.underlying,
+                      MarketData::Quote{inputs.spot, inputs.sigma});
+  if (!inputs.rateCurve.empty()) {
+    marketData.setRateCurve(TermCurve(inputs.curveTimes, inputs.rateCurve));
+  }
+  if (!inputs.dividendCurve.empty()) {
+    marketData.setDividendCurve(
+        inputs.underlying, TermCurve(inputs.curveTimes, inputs.dividendCurve));
+  }
+  if (!inputs.volCurve.empty()) {
+    marketData.setVolCurve(inputs.underlying,
+                           TermCurve(inputs.curveTimes, inputs.volCurve));
+  }
+  // Basket assets are simulated on their own names' curves.
+  const auto assetCurve = [](const std::vector<std::vector<double>> &curves,
+                             std::size_t i) {
+    return i < curves.size() ? curves[i] : std::vector<double>{};
+  };
+  for (std::size_t i = 0; i < inputs.basketUnderlyings.size(); ++i) {
+    const std::vector<double> times = assetCurve(inputs.basketCurveTimes, i);
+    const std::vector<double> dividends = assetCurve(inputs.basketDividendCurves, i);
+    const std::vector<double> vols = assetCurve(inputs.basketVolCurves, i);
+    if (!dividends.empty()) {
+      marketData.setDividendCurve(inputs.basketUnderlyings[i],
+                                  TermCurve(times, dividends));
+    }
+    if (!vols.empty()) {
+      marketData.setVolCurve(inputs.basketUnderlyings[i], TermCurve(times, vols));
+    }
+  }
+  return marketData;
+}
 
-  // 1. Base price calculation
-  const double price = runMonteCarlo(*product, marketData, *pathModel,
-                                     inputs.paths, inputs.seed, stdError);
+MonteCarloSettings makeSettings(const PricingInputs &inputs) {
+  MonteCarloSettings settings;
+  settings.paths = inputs.paths;
+  settings.seed = inputs.seed;
+  settings.sampling = inputs.sampling;
+  settings.normalScheme = inputs.normalScheme;
+  settings.scrambling = inputs.qmcScrambling;
+  settings.qmcReplications = inputs.qmcReplications;
+  settings.cache = inputs.usePathCache ? &PathCache::shared() : nullptr;
+  settings.earlyTermination = inputs.earlyTermination;
+  settings.controlVariates = inputs.controlVariates;
+  settings.targetStandardError = inputs.targetStdError;
+  settings.targetRelativeError = inputs.targetRelativeError;
+  settings.timeBudget = inputs.timeBudgetSeconds;
+  settings.batchPaths = inputs.batchPaths;
+  return settings;
+}
 
-  // Bid/Ask
-  const double spread = inputs.notional * inputs.spreadFraction;
-  const double bid = price - spread;
-  const double ask = price + spread;
-
-  // 2. Delta calculation (Bump Spot)
-  const double spotBumpSize = inputs.spot * kSpotBumpFraction;
-  double delta = 0.0;
-  if (spotBumpSize > 0.0) {
-    MarketData spotUp = marketData;
-    auto bumpedQuote = spotUp.getQuote(inputs.underlying);
-    bumpedQuote.spot += spotBumpSize;
+// Market states and models of a fused bump-and-revalue run: base, vol up,
+// then spot up and down (when the spot can be bumped). Heston shocks v0,
+// Black-Scholes shocks sigma (or every implied vol pillar of its vol curve, the
+// vega convention of the single-pass estimators too),
+// local vol shifts the implied vol surface it is calibrated from and baskets
+// shift every asset's vol (or vol curve).
+struct BumpScenarios {
+  BumpScenarios(const PricingInputs &inputs, const PathModelBase &model)
+      : base(makeMarketData(inputs)), spotUp(base), spotDown(base), volUp(base),
+        spotBumpSize(inputs.spot * kSpotBumpFraction) {
+    auto bumpedQuote = base.getQuote(inputs.underlying);
+    bumpedQuote.spot = inputs.spot + spotBumpSize;
     spotUp.setQuote(inputs.underlying, bumpedQuote);
+    bumpedQuote.spot = inputs.spot - spotBumpSize;
+    spotDown.setQuote(inputs.underlying, bumpedQuote);
+
+    PricingInputs bumpedInputs = inputs;
+    if (inputs.modelType == ModelType::Heston) {
+      bumpedInputs.hestonV0 += kVolBumpAdd;
+    } else {
+      bumpedInputs.sigma += kVolBumpAdd;
+      for (double &vol : bumpedInputs.surfaceVols) vol += kVolBumpAdd;
+      for (double &vol : bumpedInputs.basketVols) vol += kVolBumpAdd;
+      auto q = volUp.getQuote(inputs.underlying);
+      q.sigma += kVolBumpAdd;
+      volUp.setQuote(inputs.underlying, q);
+      if (const TermCurve *vols = volUp.volCurve(inputs.underlying)) {
+        volUp.setVolCurve(inputs.underlying, vols->shifted(kVolBumpAdd));
+      }
+      for (const std::string &name : inputs.basketUnderlyings) {
+        if (const TermCurve *vols = volUp.volCurve(name)) {
+          volUp.setVolCurve(name, vols->shifted(kVolBumpAdd));
+        }
+      }
+    }
+    vegaModel = makePathModel(bumpedInputs);
+
+    scenarios = {{&base, &model}, {&volUp, vegaModel.get()}};
+    if (spotBumpSize > 0.0) {
+      scenarios.push_back({&spotUp, &model});
+      scenarios.push_back({&spotDown, &model});
+    }
+  }
 
-    double ignore = 0.0;
-    const double bumpedPrice = runMonteCarlo(*product, spotUp, *pathModel,
-                                             inputs.paths, inputs.seed, ignore);
-    delta = (bumpedPrice - price) / spotBumpSize;
+  // Turns the scenario estimates of one product into its results.
+  PricingResults results(const std::vector<ScenarioEstimate> &estimates,
+                         double spread) const {
+    PricingResults results;
+    results.price = estimates[0].value.value;
+    results.stdError = estimates[0].value.standardError;
+    results.pathsUsed = estimates[0].value.paths;
+    results.bid = results.price - spread;
+    results.ask = results.price + spread;
+    results.vega = estimates[1].changeFromBase.value / kVolBumpAdd;
+    if (spotBumpSize > 0.0) {
+      const double upChange = estimates[2].changeFromBase.value;
+      const double downChange = estimates[3].changeFromBase.value;
+      results.delta = (upChange - downChange) / (2.0 * spotBumpSize);
+      results.gamma = (upChange + downChange) / (spotBumpSize * spotBumpSize);
+    }
+    return results;
   }
 
-  // 3. Vega calculation (Bump Volatility)
-  double vega = 0.0;
+  MarketData base;
+  MarketData spotUp;
+  MarketData spotDown;
+  MarketData volUp;
+  double spotBumpSize;
+  std::unique_ptr<PathModelBase> vegaModel;
+  std::vector<MonteCarloScenario> scenarios;
+};
+
+void setRedemption(PricingResults &results, RedemptionProfile profile) {
+  results.redemptionProbabilities = std::move(profile.probability);
+  results.expectedLife = profile.expectedLife;
+  results.redemptionMean = profile.meanAmount;
+  results.redemptionStdDev = profile.amountStdDev;
+  results.redemptionHistogram = std::move(profile.amountHistogram);
+}
+
+// Single pass: price and Greeks from the same paths, each with its error.
+PricingResults priceSinglePass(const StructuredProduct &product,
+                               const MarketData &marketData,
+                               const PathModelBase &model,
+                               const MonteCarloSettings &settings,
+                               ThreadPool &pool, double spread) {
+  RedemptionProfile redemption;
+  const MonteCarloGreeks greeks = runMonteCarloGreeks(
+      product, marketData, model, settings, pool, &redemption);
+  PricingResults results;
+  results.price = greeks.price.value;
+  results.stdError = greeks.price.standardError;
+  results.delta = greeks.delta.value;
+  results.deltaStdError = greeks.delta.standardError;
+  results.gamma = greeks.gamma.value;
+  results.gammaStdError = greeks.gamma.standardError;
+  results.vega = greeks.vega.value;
+  results.vegaStdError = greeks.vega.standardError;
+  results.pathsUsed = greeks.price.paths;
+  results.bid = results.price - spread;
+  results.ask = results.price + spread;
+  setRedemption(results, std::move(redemption));
+  return results;
+}
+
+// Everything that determines the simulated paths of a trade and how its
+// results are estimated. Trades with equal keys are priced together.
+using SimulationKey =
+    std::tuple<std::string, double, double, double, int, std::vector<double>,
+               std::vector<double>, std::size_t, unsigned int, int, int, int,
+               std::size_t, std::vector<std::vector<double>>, std::vector<double>,
+               std::vector<int>>;
 
+SimulationKey simulationKey(const PricingInputs &inputs) {
+  std::vector<double> modelParams{inputs.sigma};
   if (inputs.modelType == ModelType::Heston) {
-    // HESTON LOGIC: Shock the model parameters (v0)
-    PricingInputs bumpedInputs = inputs;
-    bumpedInputs.hestonV0 += kVolBumpAdd;
+    modelParams = {inputs.hestonV0, inputs.hestonKappa, inputs.hestonTheta,
+                   inputs.hestonXi, inputs.hestonRho,
+                   static_cast<double>(inputs.hestonScheme), inputs.hestonMaxStep};
+  }
+  std::string names = inputs.underlying;
+  for (const std::string &name : inputs.basketUnderlyings) names += '|' + name;
+  if (!inputs.basketUnderlyings.empty()) {
+    modelParams.push_back(static_cast<double>(inputs.basketType));
+    modelParams.push_back(static_cast<double>(basketObservation(inputs)));
+  }
+  std::vector<std::vector<double>> curves{
+      inputs.curveTimes, inputs.rateCurve, inputs.dividendCurve,
+      inputs.volCurve, inputs.surfaceExpiries, inputs.surfaceMoneyness,
+      inputs.surfaceVols, inputs.basketVols, inputs.basketCorrelation};
+  for (const auto *assetCurves : {&inputs.basketCurveTimes,
+                                  &inputs.basketDividendCurves,
+                                  &inputs.basketVolCurves}) {
+    for (std::size_t i = 0; i < inputs.basketUnderlyings.size(); ++i) {
+      curves.push_back(i < assetCurves->size() ? (*assetCurves)[i]
+                                                : std::vector<double>{});
+    }
+  }
+  return {names,
+          inputs.spot,
+          inputs.sigma,
+          inputs.rate,
+          static_cast<int>(inputs.modelType),
+          modelParams,
+          inputs.observationTimes,
+          inputs.paths,
+          inputs.seed,
+          static_cast<int>(inputs.sampling),
+          static_cast<int>(inputs.normalScheme),
+          static_cast<int>(inputs.qmcScrambling),
+          inputs.qmcReplications,
+          curves,
+          {inputs.targetStdError, inputs.targetRelativeError,
+           inputs.timeBudgetSeconds, static_cast<double>(inputs.batchPaths)},
+          {static_cast<int>(inputs.greekMethod), inputs.usePathCache,
+           inputs.earlyTermination, inputs.controlVariates}};
+}
 
-    auto vegaModel = makePathModel(bumpedInputs);
-    double ignore = 0.0;
-    const double vegaPrice = runMonteCarlo(*product, marketData, *vegaModel,
-                                           inputs.paths, inputs.seed, ignore);
+// Everything calibrateModel() reads: trades with equal keys share one fit.
+using CalibrationKey =
+    std::tuple<std::string, int, std::vector<std::vector<double>>>;
 
-    vega = (vegaPrice - price) / kVolBumpAdd;
+CalibrationKey calibrationKey(const PricingInputs &inputs) {
+  std::vector<double> guess;
+  if (inputs.modelType == ModelType::Heston) {
+    guess = {inputs.hestonV0, inputs.hestonKappa, inputs.hestonTheta,
+             inputs.hestonXi, inputs.hestonRho};
+  }
+  return {inputs.underlying,
+          static_cast<int>(inputs.modelType),
+          {inputs.surfaceExpiries, inputs.surfaceMoneyness, inputs.surfaceVols,
+           guess}};
+}
+} // namespace
 
-  } else {
-    // BLACK-SCHOLES LOGIC: Shock the sigma
-    PricingInputs bumpedInputs = inputs;
-    bumpedInputs.sigma += kVolBumpAdd;
+PricingInputs calibrateModel(const PricingInputs &inputs) {
+  if (!inputs.basketUnderlyings.empty()) {
+    throw std::invalid_argument("Basket models cannot be calibrated to a surface");
+  }
+  if (inputs.surfaceVols.empty()) {
+    throw std::invalid_argument("Calibration needs an implied vol surface");
+  }
+  PricingInputs fitted = inputs;
+  fitted.calibrateToSurface = false;
+  const ImpliedVolSurface surface = makeVolSurface(inputs);
+  if (inputs.modelType == ModelType::Heston) {
+    const HestonCalibration fit = calibrateHeston(
+        surface, {inputs.hestonV0, inputs.hestonKappa, inputs.hestonTheta,
+                  inputs.hestonXi, inputs.hestonRho});
+    fitted.hestonV0 = fit.parameters.v0;
+    fitted.hestonKappa = fit.parameters.kappa;
+    fitted.hestonTheta = fit.parameters.theta;
+    fitted.hestonXi = fit.parameters.xi;
+    fitted.hestonRho = fit.parameters.rho;
+  } else if (inputs.modelType == ModelType::BlackScholes) {
+    fitted.sigma = calibrateBlackScholesVol(surface);
+  }
+  return fitted;
+}
+
+PricingResults priceAutocall(const PricingInputs &rawInputs,
+                             MonteCarloObserver *observer) {
+  const PricingInputs inputs =
+      rawInputs.calibrateToSurface ? calibrateModel(rawInputs) : rawInputs;
+  const MarketData marketData = makeMarketData(inputs);
+  const std::unique_ptr<StructuredProduct> product = makeProduct(inputs);
+  auto pathModel = makePathModel(inputs);
+  ThreadPool pool(inputs.threads);
+  MonteCarloSettings settings = makeSettings(inputs);
+  settings.observer = observer;
+  const double spread = inputs.notional * inputs.spreadFraction;
+
+  if (inputs.greekMethod == GreekMethod::SinglePass &&
+      supportsSinglePassGreeks(*product, *pathModel)) {
+    return priceSinglePass(*product, marketData, *pathModel, settings, pool,
+                           spread);
+  }
 
-    auto vegaModel = makePathModel(bumpedInputs);
+  // Bump and revalue, fused: base, spot up/down and vol up are priced in one
+  // pass on the same normals (see runMonteCarloScenarios).
+  const BumpScenarios bumps(inputs, *pathModel);
+  RedemptionProfile redemption;
+  PricingResults results = bumps.results(
+      runMonteCarloScenarios(*product, bumps.scenarios, settings, pool,
+                             &redemption),
+      spread);
+  setRedemption(results, std::move(redemption));
+  return results;
+}
 
-    MarketData volUp = marketData;
-    auto q = volUp.getQuote(inputs.underlying);
-    q.sigma += kVolBumpAdd;
-    volUp.setQuote(inputs.underlying, q);
+PortfolioResults pricePortfolio(const std::vector<PortfolioTrade> &trades,
+                                std::size_t threads) {
+  PortfolioResults portfolio;
+  portfolio.trades.resize(trades.size());
 
-    double ignore = 0.0;
-    const double vegaPrice = runMonteCarlo(*product, volUp, *vegaModel,
-                                           inputs.paths, inputs.seed, ignore);
+  // Calibrate once per distinct surface, model and starting guess; the fits
+  // then group like any other parameters.
+  std::vector<PricingInputs> inputs(trades.size());
+  std::map<CalibrationKey, PricingInputs> fits;
+  for (std::size_t i = 0; i < trades.size(); ++i) {
+    inputs[i] = trades[i].inputs;
+    if (!inputs[i].calibrateToSurface) continue;
+    const CalibrationKey key = calibrationKey(inputs[i]);
+    auto fit = fits.find(key);
+    if (fit == fits.end()) fit = fits.emplace(key, calibrateModel(inputs[i])).first;
+    inputs[i].sigma = fit->second.sigma;
+    inputs[i].hestonV0 = fit->second.hestonV0;
+    inputs[i].hestonKappa = fit->second.hestonKappa;
+    inputs[i].hestonTheta = fit->second.hestonTheta;
+    inputs[i].hestonXi = fit->second.hestonXi;
+    inputs[i].hestonRho = fit->second.hestonRho;
+    inputs[i].calibrateToSurface = false;
+  }
 
-    vega = (vegaPrice - price) / kVolBumpAdd;
+  // Group trades by simulation; std::map keeps the group order deterministic.
+  std::map<SimulationKey, std::vector<std::size_t>> groups;
+  for (std::size_t i = 0; i < trades.size(); ++i) {
+    groups[simulationKey(inputs[i])].push_back(i);
   }
-  return {price, stdError, delta, vega, bid, ask};
-}
\ No newline at end of file
+
+  ThreadPool pool(threads);
+  for (const auto &group : groups) {
+    const std::vector<std::size_t> &members = group.second;
+    const PricingInputs &lead = inputs[members.front()];
+
+    std::vector<std::unique_ptr<StructuredProduct>> products;
+    std::vector<const StructuredProduct *> productViews;
+    products.reserve(members.size());
+    for (std::size_t index : members) {
+      products.push_back(makeProduct(inputs[index]));
+      productViews.push_back(products.back().get());
+    }
+
+    auto pathModel = makePathModel(lead);
+    const MonteCarloSettings settings = makeSettings(lead);
+
+    // Single-pass Greeks differentiate one payoff along its paths, so those
+    // trades are simulated one by one, as priceAutocall() would.
+    std::vector<std::size_t> fused;
+    std::vector<const StructuredProduct *> fusedViews;
+    for (std::size_t k = 0; k < members.size(); ++k) {
+      const PricingInputs &trade = inputs[members[k]];
+      if (lead.greekMethod == GreekMethod::SinglePass &&
+          supportsSinglePassGreeks(*productViews[k], *pathModel)) {
+        portfolio.trades[members[k]] = priceSinglePass(
+            *productViews[k], makeMarketData(trade), *pathModel, settings, pool,
+            trade.notional * trade.spreadFraction);
+        ++portfolio.simulations;
+      } else {
+        fused.push_back(members[k]);
+        fusedViews.push_back(productViews[k]);
+      }
+    }
+    if (fused.empty()) continue;
+
+    // One simulation for the rest, spread over the pool block by block.
+    const BumpScenarios bumps(lead, *pathModel);
+    std::vector<RedemptionProfile> redemptions;
+    const auto estimates = runMonteCarloScenarios(
+        fusedViews, bumps.scenarios, settings, pool, &redemptions);
+    ++portfolio.simulations;
+
+    for (std::size_t k = 0; k < fused.size(); ++k) {
+      const PricingInputs &trade = inputs[fused[k]];
+      portfolio.trades[fused[k]] =
+          bumps.results(estimates[k], trade.notional * trade.spreadFraction);
+      setRedemption(portfolio.trades[fused[k]], std::move(redemptions[k]));
+    }
+  }
+
+  // Quantity-weighted aggregation, per underlying and for the whole book.
+  std::map<std::string, UnderlyingRisk> risk;
+  for (std::size_t i = 0; i < trades.size(); ++i) {
+    const double quantity = trades[i].quantity;
+    const PricingResults &results = portfolio.trades[i];
+    UnderlyingRisk &entry = risk[trades[i].inputs.underlying];
+    entry.underlying = trades[i].inputs.underlying;
+    entry.value += quantity * results.price;
+    entry.delta += quantity * results.delta;
+    entry.gamma += quantity * results.gamma;
+    entry.vega += quantity * results.vega;
+  }
+  for (const auto &entry : risk) {
+    portfolio.byUnderlying.push_back(entry.second);
+    portfolio.totalValue += entry.second.value;
+    portfolio.totalVega += entry.second.vega;
+  }
+  return portfolio;
+}
@@ -0,0 +1,338 @@
+/*
+ * SUMMARY: Quasi-Monte Carlo normal generation.
+ * Sobol points (Joe-Kuo direction numbers) are optionally randomized by a
+ * digital shift or a hash-based Owen scramble, mapped to normals through the
+ * vectorized inverse CDF, and reordered by a Brownian bridge so that the best
+ * distributed coordinates drive the coarse shape of each path.
+ */
+
+#include "QuasiRandom.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+// Joe-Kuo primitive polynomials (degree s, coefficients a) and initial
+// direction numbers m_1 .. m_s for dimensions 2 .. 37. Dimension 1 is the
+// van der Corput sequence (all m_k = 1).
+struct DirectionEntry {
+    unsigned degree;
+    unsigned a;
+    unsigned m[7];
+};
+
+constexpr DirectionEntry kJoeKuo[] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+    {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}},
+    {6, 19, {1, 1, 1, 15, 7, 5}},
+    {6, 22, {1, 3, 1, 15, 13, 25}},
+    {6, 25, {1, 1, 5, 5, 19, 61}},
+    {7, 1, {1, 3, 7, 11, 23, 15, 103}},
+    {7, 4, {1, 3, 7, 13, 13, 15, 69}},
+    {7, 7, {1, 1, 3, 13, 7, 35, 63}},
+    {7, 8, {1, 3, 5, 9, 1, 25, 53}},
+    {7, 14, {1, 3, 1, 13, 9, 35, 107}},
+    {7, 19, {1, 3, 1, 5, 27, 61, 31}},
+    {7, 21, {1, 1, 5, 11, 19, 41, 61}},
+    {7, 28, {1, 3, 5, 3, 3, 13, 69}},
+    {7, 31, {1, 1, 7, 13, 1, 19, 1}},
+    {7, 32, {1, 3, 7, 5, 13, 19, 59}},
+    {7, 37, {1, 1, 3, 9, 25, 29, 41}},
+    {7, 41, {1, 3, 5, 13, 23, 1, 55}},
+    {7, 42, {1, 3, 7, 3, 13, 59, 17}},
+    {7, 50, {1, 3, 1, 3, 5, 53, 69}},
+    {7, 55, {1, 1, 5, 5, 23, 33, 13}},
+    {7, 56, {1, 1, 7, 7, 1, 61, 123}},
+    {7, 59, {1, 1, 7, 9, 13, 61, 49}},
+    {7, 62, {1, 3, 3, 5, 3, 55, 33}},
+};
+static_assert(sizeof(kJoeKuo) / sizeof(kJoeKuo[0]) + 1 == SobolSequence::kMaxDimensions,
+              "Direction table does not match kMaxDimensions");
+
+std::uint32_t reverseBits(std::uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Burley's variant of the Laine-Karras hash: a permutation in which every bit
+// only depends on the bits below it. Applied to the reversed digits it gives
+// a nested uniform (Owen) scramble.
+std::uint32_t owenScramble(std::uint32_t x, std::uint32_t seed) {
+    x = reverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverseBits(x);
+}
+
+std::uint32_t scramble(std::uint32_t x, QmcScrambling scrambling, std::uint32_t seed) {
+    switch (scrambling) {
+    case QmcScrambling::DigitalShift:
+        return x ^ seed;
+    case QmcScrambling::Owen:
+        return owenScramble(x, seed);
+    case QmcScrambling::None:
+        break;
+    }
+    return x;
+}
+
+int countTrailingZeros(std::uint64_t x) {
+    int count = 0;
+    while ((x & 1u) == 0 && count < 64) {
+        x >>= 1;
+        ++count;
+    }
+    return count;
+}
+} // namespace
+
+// -----------------------------------------------------------------------------
+// Sobol sequence
+// -----------------------------------------------------------------------------
+SobolSequence::SobolSequence() : directions_(kMaxDimensions * kBits) {
+    // Dimension 0: v_k = 2^(32 - k).
+    for (std::size_t k = 0; k < kBits; ++k) {
+        directions_[k] = 1u << (kBits - 1 - k);
+    }
+
+    for (std::size_t dim = 1; dim < kMaxDimensions; ++dim) {
+        const DirectionEntry& entry = kJoeKuo[dim - 1];
+        const unsigned s = entry.degree;
+        std::uint32_t* v = directions_.data() + dim * kBits;
+        for (unsigned k = 0; k < s && k < kBits; ++k) {
+            v[k] = entry.m[k] << (kBits - 1 - k);
+        }
+        // Recurrence defined by the primitive polynomial.
+        for (std::size_t k = s; k < kBits; ++k) {
+            v[k] = v[k - s] ^ (v[k - s] >> s);
+            for (unsigned j = 1; j < s; ++j) {
+                if ((entry.a >> (s - 1 - j)) & 1u) {
+                    v[k] ^= v[k - j];
+                }
+            }
+        }
+    }
+}
+
+void SobolSequence::coordinates(std::size_t dim, std::uint64_t first,
+                                std::size_t count, std::uint32_t* out) const {
+    if (dim >= kMaxDimensions) {
+        throw std::out_of_range("SobolSequence: dimension out of range");
+    }
+    if (count == 0) return;
+    const std::uint32_t* v = directions_.data() + dim * kBits;
+
+    // Direct evaluation of the first point from its Gray code...
+    const std::uint64_t gray = first ^ (first >> 1);
+    std::uint32_t x = 0;
+    for (std::size_t k = 0; k < kBits; ++k) {
+        if ((gray >> k) & 1u) x ^= v[k];
+    }
+    out[0] = x;
+
+    // ...then one XOR per point (consecutive Gray codes differ by one bit).
+    for (std::size_t i = 1; i < count; ++i) {
+        x ^= v[countTrailingZeros(first + i)];
+        out[i] = x;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Brownian bridge
+// -----------------------------------------------------------------------------
+BrownianBridge::BrownianBridge(const std::vector<double>& times)
+    : times_(times) {
+    const std::size_t n = times_.size();
+    if (n == 0) return;
+
+    sqrtDt_.resize(n);
+    for (std::size_t j = 0; j < n; ++j) {
+        const double dt = times_[j] - (j == 0 ? 0.0 : times_[j - 1]);
+        if (dt <= 0.0) {
+            throw std::invalid_argument("BrownianBridge: times must be increasing");
+        }
+        sqrtDt_[j] = std::sqrt(dt);
+    }
+
+    bridgeIndex_.assign(n, 0);
+    leftIndex_.assign(n, 0);
+    rightIndex_.assign(n, 0);
+    leftWeight_.assign(n, 0.0);
+    rightWeight_.assign(n, 0.0);
+    stdDev_.assign(n, 0.0);
+
+    // Standard construction (Jaeckel): terminal point first, then repeatedly
+    // the midpoint of the next unfilled gap. 'filled' marks built indices.
+    std::vector<std::size_t> filled(n, 0);
+    filled[n - 1] = 1;
+    bridgeIndex_[0] = n - 1;
+    stdDev_[0] = std::sqrt(times_[n - 1]);
+
+    std::size_t j = 0;
+    for (std::size_t i = 1; i < n; ++i) {
+        while (filled[j]) ++j;      // first unfilled index
+        std::size_t k = j;
+        while (!filled[k]) ++k;     // next filled index on the right
+        const std::size_t l = j + ((k - 1 - j) >> 1);
+        filled[l] = i;
+        bridgeIndex_[i] = l;
+        leftIndex_[i] = j;
+        rightIndex_[i] = k;
+
+        const double tLeft = j == 0 ? 0.0 : times_[j - 1];
+        const double span = times_[k] - tLeft;
+        leftWeight_[i] = (times_[k] - times_[l]) / span;
+        rightWeight_[i] = (times_[l] - tLeft) / span;
+        stdDev_[i] = std::sqrt((times_[l] - tLeft) * (times_[k] - times_[l]) / span);
+
+        j = k + 1;
+        if (j >= n) j = 0;
+    }
+}
+
+void BrownianBridge::transform(const double* z, double* increments,
+                               std::size_t paths, std::vector<double>& work) const {
+    const std::size_t n = size();
+    work.resize(n * paths);
+    double* w = work.data(); // w[j * paths + p] = W(t_j)
+
+    {
+        double* terminal = w + bridgeIndex_[0] * paths;
+        for (std::size_t p = 0; p < paths; ++p) terminal[p] = stdDev_[0] * z[p];
+    }
+    for (std::size_t i = 1; i < n; ++i) {
+        double* target = w + bridgeIndex_[i] * paths;
+        const double* right = w + rightIndex_[i] * paths;
+        const double* zi = z + i * paths;
+        const double rw = rightWeight_[i];
+        const double sd = stdDev_[i];
+        if (leftIndex_[i] != 0) {
+            const double* left = w + (leftIndex_[i] - 1) * paths;
+            const double lw = leftWeight_[i];
+            for (std::size_t p = 0; p < paths; ++p) {
+                target[p] = lw * left[p] + rw * right[p] + sd * zi[p];
+            }
+        } else {
+            for (std::size_t p = 0; p < paths; ++p) {
+                target[p] = rw * right[p] + sd * zi[p];
+            }
+        }
+    }
+
+    // Back to standardized increments.
+    for (std::size_t j = 0; j < n; ++j) {
+        const double* current = w + j * paths;
+        double* out = increments + j * paths;
+        const double scale = 1.0 / sqrtDt_[j];
+        if (j == 0) {
+            for (std::size_t p = 0; p < paths; ++p) out[p] = current[p] * scale;
+        } else {
+            const double* previous = w + (j - 1) * paths;
+            for (std::size_t p = 0; p < paths; ++p) {
+                out[p] = (current[p] - previous[p]) * scale;
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Quasi-random normal stream
+// -----------------------------------------------------------------------------
+QuasiRandomNormals::QuasiRandomNormals(const BrownianGrid& grid,
+                                       const BrownianBridge& bridge,
+                                       const SobolSequence& sobol,
+                                       QmcScrambling scrambling,
+                                       const std::vector<std::uint32_t>& scrambleSeeds,
+                                       std::uint64_t firstPoint,
+                                       std::size_t paths,
+                                       const PhiloxStream& pad) {
+    const std::size_t steps = grid.stepTimes.size();
+    const std::size_t factors = grid.factors;
+    if (bridge.size() != steps) {
+        throw std::invalid_argument("QuasiRandomNormals: bridge does not match grid");
+    }
+
+    thread_local std::vector<double> output;
+    thread_local std::vector<double> bridgeInput;
+    thread_local std::vector<double> factorIncrements;
+    thread_local std::vector<double> work;
+    thread_local std::vector<std::uint32_t> digits;
+    output.resize(steps * factors * paths);
+    bridgeInput.resize(steps * paths);
+    factorIncrements.resize(steps * paths);
+    digits.resize(paths);
+
+    constexpr double kInv2Pow32 = 1.0 / 4294967296.0;
+    for (std::size_t f = 0; f < factors; ++f) {
+        // Bridge-ordered normals of factor f.
+        for (std::size_t c = 0; c < steps; ++c) {
+            double* row = bridgeInput.data() + c * paths;
+            const std::size_t dim = c * factors + f;
+            if (dim < SobolSequence::kMaxDimensions) {
+                sobol.coordinates(dim, firstPoint, paths, digits.data());
+                const std::uint32_t dimSeed = dim < scrambleSeeds.size() ? scrambleSeeds[dim] : 0u;
+                for (std::size_t p = 0; p < paths; ++p) {
+                    row[p] = (scramble(digits[p], scrambling, dimSeed) + 0.5) * kInv2Pow32;
+                }
+                inverseNormal(row, row, paths);
+            } else {
+                // Pad coordinate (c, f) owns positions [dim * paths, (dim + 1) * paths).
+                fillPhiloxNormals(pad, dim * paths, row, paths);
+            }
+        }
+
+        bridge.transform(bridgeInput.data(), factorIncrements.data(), paths, work);
+
+        // Interleave into the step-major, factor-major layout the models read.
+        for (std::size_t j = 0; j < steps; ++j) {
+            std::copy(factorIncrements.data() + j * paths,
+                      factorIncrements.data() + (j + 1) * paths,
+                      output.data() + (j * factors + f) * paths);
+        }
+    }
+
+    increments_ = output.data();
+    size_ = output.size();
+}
+
+void QuasiRandomNormals::next(double* z, std::size_t count) {
+    if (offset_ + count > size_) {
+        throw std::logic_error("QuasiRandomNormals: stream exhausted");
+    }
+    std::copy(increments_ + offset_, increments_ + offset_ + count, z);
+    offset_ += count;
+}
+
+std::vector<std::uint32_t> makeScrambleSeeds(unsigned int seed,
+                                             std::size_t replication) {
+    // Keep the scrambling streams apart from the pseudo-random block streams.
+    const auto wide = static_cast<std::uint64_t>(replication);
+    std::seed_seq sequence{seed, 0x51ab1e5eu, static_cast<unsigned int>(wide & 0xffffffffu),
+                           static_cast<unsigned int>(wide >> 32)};
+    std::mt19937 rng(sequence);
+    std::vector<std::uint32_t> seeds(SobolSequence::kMaxDimensions);
+    for (auto& s : seeds) {
+        s = static_cast<std::uint32_t>(rng());
+    }
+    return seeds;
+}
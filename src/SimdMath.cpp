@@ -0,0 +1,867 @@
+/*
+ * SUMMARY: Vectorized exp, inverse-normal, Heston-step, local-vol-step,
+ * normal-correlation and Philox counter-based RNG kernels.
+ * The Heston QE step is scalar only (see hestonQeStep()).
+ * Each kernel exists in three flavours (scalar, AVX2+FMA, AVX-512F) built from
+ * the same coefficients and the same fused multiply-add sequence, so the
+ * dispatcher can pick the widest one at runtime without changing a single bit
+ * of the results. The x86 flavours are compiled with function-level target
+ * attributes, so the rest of the project does not need -mavx2.
+ */
+
+#include "SimdMath.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PRICER_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC 12 flags the _mm512_undefined_* placeholders inside its own intrinsics.
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#endif
+
+namespace {
+// exp(x) = 2^n * exp(r), n = round(x / ln2), |r| <= ln2 / 2.
+constexpr double kLog2e = 1.4426950408889634;
+constexpr double kLn2Hi = 0.6931471803691238;  // High bits of ln2 (exact product with n).
+constexpr double kLn2Lo = 1.9082149292705877e-10;
+constexpr double kExpMin = -708.0;
+constexpr double kExpMax = 709.0;
+constexpr double kRoundMagic = 6755399441055744.0; // 2^52 + 2^51
+
+// Taylor coefficients 1/k! for k = 11 .. 0 (truncation error ~6e-15 on |r| <= ln2/2).
+constexpr double kExpPoly[] = {
+    2.505210838544172e-08, 2.755731922398589e-07, 2.755731922398589e-06,
+    2.48015873015873e-05,  1.984126984126984e-04, 1.388888888888889e-03,
+    8.333333333333333e-03, 4.166666666666666e-02, 1.666666666666667e-01,
+    0.5,                   1.0,                   1.0};
+constexpr int kExpPolySize = sizeof(kExpPoly) / sizeof(kExpPoly[0]);
+
+// Acklam's inverse normal CDF coefficients.
+constexpr double kA[] = {-3.969683028665376e+01, 2.209460984245205e+02,
+                         -2.759285104469687e+02, 1.383577518672690e+02,
+                         -3.066479806614716e+01, 2.506628277459239e+00};
+constexpr double kB[] = {-5.447609879822406e+01, 1.615858368580409e+02,
+                         -1.556989798598866e+02, 6.680131188771972e+01,
+                         -1.328068155288572e+01};
+constexpr double kC[] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                         -2.400758277161838e+00, -2.549732539343734e+00,
+                         4.374664141464968e+00,  2.938163982698783e+00};
+constexpr double kD[] = {7.784695709041462e-03, 3.224671290700398e-01,
+                         2.445134137142996e+00, 3.754408661907416e+00};
+constexpr double kPLow = 0.02425;
+constexpr double kPHigh = 1.0 - kPLow;
+
+// Philox4x32-10 multipliers and key increments (Salmon et al. 2011).
+constexpr std::uint32_t kPhiloxM0 = 0xD2511F53u;
+constexpr std::uint32_t kPhiloxM1 = 0xCD9E8D57u;
+constexpr std::uint32_t kPhiloxW0 = 0x9E3779B9u;
+constexpr std::uint32_t kPhiloxW1 = 0xBB67AE85u;
+constexpr int kPhiloxRounds = 10;
+
+// Counters generated per pass of the Philox fill/gather loops.
+constexpr std::size_t kPhiloxChunk = 256;
+
+// -----------------------------------------------------------------------------
+// Scalar reference kernels (also used for tails and as the portable fallback)
+// -----------------------------------------------------------------------------
+double expScalar(double x) {
+    x = std::min(std::max(x, kExpMin), kExpMax);
+    const double n = std::nearbyint(x * kLog2e);
+    double r = std::fma(-n, kLn2Hi, x);
+    r = std::fma(-n, kLn2Lo, r);
+
+    double p = kExpPoly[0];
+    for (int k = 1; k < kExpPolySize; ++k) {
+        p = std::fma(p, r, kExpPoly[k]);
+    }
+
+    // Build 2^n directly in the exponent field.
+    const double shifted = n + kRoundMagic;
+    std::uint64_t bits;
+    std::memcpy(&bits, &shifted, sizeof(bits));
+    bits = (bits + 1023) << 52;
+    double scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+double inverseNormalCentral(double p) {
+    const double q = p - 0.5;
+    const double r = q * q;
+    double num = kA[0];
+    for (int k = 1; k < 6; ++k) num = std::fma(num, r, kA[k]);
+    double den = kB[0];
+    for (int k = 1; k < 5; ++k) den = std::fma(den, r, kB[k]);
+    den = std::fma(den, r, 1.0);
+    return num * q / den;
+}
+
+double inverseNormalTail(double p) {
+    // Lower tail formula, mirrored for the upper tail.
+    const bool upper = p > kPHigh;
+    const double q = std::sqrt(-2.0 * std::log(upper ? 1.0 - p : p));
+    double num = kC[0];
+    for (int k = 1; k < 6; ++k) num = std::fma(num, q, kC[k]);
+    double den = kD[0];
+    for (int k = 1; k < 4; ++k) den = std::fma(den, q, kD[k]);
+    den = std::fma(den, q, 1.0);
+    const double x = num / den;
+    return upper ? -x : x;
+}
+
+double inverseNormalScalar(double p) {
+    return (p < kPLow || p > kPHigh) ? inverseNormalTail(p) : inverseNormalCentral(p);
+}
+
+void scaledExpScalar(const double* base, const double* z, double a, double b,
+                     double* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = base[i] * expScalar(std::fma(b, z[i], a));
+    }
+}
+
+void hestonEulerStepScalar(double* spot, double* variance, const double* z1,
+                           const double* z2, const HestonStepConstants& c,
+                           std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        const double v = variance[i];
+        const double vPlus = std::max(v, 0.0);
+        const double sqrtV = std::sqrt(vPlus);
+        const double zv = std::fma(c.rhoBar, z2[i], c.rho * z1[i]);
+        const double meanRevert = c.kappaDt * (c.theta - vPlus);
+        variance[i] = v + std::fma(c.xiSqrtDt * sqrtV, zv, meanRevert);
+        const double logDrift = std::fma(c.minusHalfDt, vPlus, c.rDt);
+        spot[i] *= expScalar(std::fma(sqrtV * c.sqrtDt, z1[i], logDrift));
+    }
+}
+
+// Andersen's switching level between the quadratic and exponential regimes.
+constexpr double kQeCriticalPsi = 1.5;
+
+void hestonQeStepScalar(double* spot, double* variance, const double* z1,
+                        const double* z2, const HestonQeStepConstants& c,
+                        std::size_t n) {
+    // K4 = K3 with the central weights; A is the coefficient of v(t + dt) in
+    // the log-spot exponent, which the correction integrates against.
+    const double a = c.k2 + 0.5 * c.k3;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double v = variance[i];
+        const double m = c.theta + (v - c.theta) * c.decay;
+        const double s2 = v * c.s2PerV + c.s2Const;
+        // ln E[exp(A v(t + dt))], when finite; K0 falls back to its
+        // uncorrected value otherwise.
+        double next = 0.0;
+        double logMoment = 0.0;
+        bool corrected = true;
+        if (!(m > 0.0)) {
+            // v = theta = 0: the variance stays at zero.
+        } else if (!(s2 > 0.0)) {
+            next = m;
+            logMoment = a * m;
+        } else if (s2 <= kQeCriticalPsi * m * m) {
+            const double twoOverPsi = 2.0 * m * m / s2;
+            const double b2 = twoOverPsi - 1.0 +
+                              std::sqrt(twoOverPsi) * std::sqrt(twoOverPsi - 1.0);
+            const double scale = m / (1.0 + b2);
+            const double root = std::sqrt(b2) + z2[i];
+            next = scale * root * root;
+            const double denom = 1.0 - 2.0 * a * scale;
+            corrected = denom > 0.0;
+            if (corrected) logMoment = a * b2 * scale / denom - 0.5 * std::log(denom);
+        } else {
+            const double psi = s2 / (m * m);
+            const double p = (psi - 1.0) / (psi + 1.0);
+            const double beta = (1.0 - p) / m;
+            // 1 - U = Phi(-z2), taken from erfc so the tail keeps its digits.
+            const double tail = 0.5 * std::erfc(z2[i] * 0.7071067811865476);
+            if (tail < 1.0 - p) next = std::log((1.0 - p) / tail) / beta;
+            corrected = a < beta;
+            if (corrected) logMoment = std::log(p + beta * (1.0 - p) / (beta - a));
+        }
+        const double k0 = corrected ? -logMoment - (c.k1 + 0.5 * c.k3) * v : c.k0;
+        variance[i] = next;
+        const double drift = c.rDt + k0 + c.k1 * v + c.k2 * next;
+        spot[i] *= expScalar(drift + std::sqrt(c.k3 * (v + next)) * z1[i]);
+    }
+}
+
+void localVolStepScalar(double* x, const double* z, const LocalVolStepConstants& c,
+                        std::size_t n) {
+    const double last = static_cast<double>(c.nodes - 1);
+    const double lastCell = static_cast<double>(c.nodes - 2);
+    for (std::size_t i = 0; i < n; ++i) {
+        const double u = std::min(std::max((x[i] - c.x0) * c.invDx, 0.0), last);
+        const double cell = std::min(std::floor(u), lastCell);
+        const std::size_t j = static_cast<std::size_t>(cell);
+        const double lo = c.vols[j];
+        const double sigma = std::fma(u - cell, c.vols[j + 1] - lo, lo);
+        x[i] += std::fma(sigma * c.sqrtDt, z[i], c.minusHalfDt * sigma * sigma);
+    }
+}
+
+// Rows are rewritten from the last factor down: row i only reads rows k <= i,
+// which still hold their independent draws at that point.
+void correlateNormalsScalar(const double* lower, std::size_t factors, double* z,
+                            std::size_t n, std::size_t begin) {
+    for (std::size_t i = factors; i-- > 0;) {
+        const double* l = lower + i * factors;
+        double* out = z + i * n;
+        for (std::size_t p = begin; p < n; ++p) {
+            double acc = l[0] * z[p];
+            for (std::size_t k = 1; k <= i; ++k) acc = std::fma(l[k], z[k * n + p], acc);
+            out[p] = acc;
+        }
+    }
+}
+
+void inverseNormalScalarArray(const double* u, double* z, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        z[i] = inverseNormalScalar(u[i]);
+    }
+}
+
+// Philox4x32-10 of counters[i] (words: counter low, counter high, stream low,
+// stream high); word j of the output goes to words[j * n + i].
+void philoxWordsScalar(const PhiloxStream& stream, const std::uint64_t* counters,
+                       std::size_t n, std::uint32_t* words, std::size_t begin) {
+    for (std::size_t i = begin; i < n; ++i) {
+        std::uint32_t c0 = static_cast<std::uint32_t>(counters[i]);
+        std::uint32_t c1 = static_cast<std::uint32_t>(counters[i] >> 32);
+        std::uint32_t c2 = static_cast<std::uint32_t>(stream.stream);
+        std::uint32_t c3 = static_cast<std::uint32_t>(stream.stream >> 32);
+        std::uint32_t k0 = stream.key[0];
+        std::uint32_t k1 = stream.key[1];
+        for (int r = 0; r < kPhiloxRounds; ++r) {
+            if (r > 0) {
+                k0 += kPhiloxW0;
+                k1 += kPhiloxW1;
+            }
+            const std::uint64_t p0 = static_cast<std::uint64_t>(kPhiloxM0) * c0;
+            const std::uint64_t p1 = static_cast<std::uint64_t>(kPhiloxM1) * c2;
+            c0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            c1 = static_cast<std::uint32_t>(p1);
+            c2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c3 = static_cast<std::uint32_t>(p0);
+        }
+        words[i] = c0;
+        words[n + i] = c1;
+        words[2 * n + i] = c2;
+        words[3 * n + i] = c3;
+    }
+}
+
+#ifdef PRICER_HAVE_X86_SIMD
+// -----------------------------------------------------------------------------
+// AVX2 + FMA kernels (4 lanes)
+// -----------------------------------------------------------------------------
+__attribute__((target("avx2,fma"))) inline __m256d expAvx2(__m256d x) {
+    x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(kExpMin)),
+                      _mm256_set1_pd(kExpMax));
+    const __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(kLog2e)),
+                                      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(kLn2Hi), x);
+    r = _mm256_fnmadd_pd(n, _mm256_set1_pd(kLn2Lo), r);
+
+    __m256d p = _mm256_set1_pd(kExpPoly[0]);
+    for (int k = 1; k < kExpPolySize; ++k) {
+        p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(kExpPoly[k]));
+    }
+
+    __m256i bits = _mm256_castpd_si256(_mm256_add_pd(n, _mm256_set1_pd(kRoundMagic)));
+    bits = _mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52);
+    return _mm256_mul_pd(p, _mm256_castsi256_pd(bits));
+}
+
+__attribute__((target("avx2,fma"))) void scaledExpAvx2(const double* base,
+                                                       const double* z, double a,
+                                                       double b, double* out,
+                                                       std::size_t n) {
+    const __m256d va = _mm256_set1_pd(a);
+    const __m256d vb = _mm256_set1_pd(b);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d x = _mm256_fmadd_pd(vb, _mm256_loadu_pd(z + i), va);
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(base + i), expAvx2(x)));
+    }
+    scaledExpScalar(base + i, z + i, a, b, out + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void hestonEulerStepAvx2(
+    double* spot, double* variance, const double* z1, const double* z2,
+    const HestonStepConstants& c, std::size_t n) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d kappaDt = _mm256_set1_pd(c.kappaDt);
+    const __m256d theta = _mm256_set1_pd(c.theta);
+    const __m256d xiSqrtDt = _mm256_set1_pd(c.xiSqrtDt);
+    const __m256d rho = _mm256_set1_pd(c.rho);
+    const __m256d rhoBar = _mm256_set1_pd(c.rhoBar);
+    const __m256d rDt = _mm256_set1_pd(c.rDt);
+    const __m256d minusHalfDt = _mm256_set1_pd(c.minusHalfDt);
+    const __m256d sqrtDt = _mm256_set1_pd(c.sqrtDt);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d v = _mm256_loadu_pd(variance + i);
+        const __m256d w1 = _mm256_loadu_pd(z1 + i);
+        const __m256d vPlus = _mm256_max_pd(v, zero);
+        const __m256d sqrtV = _mm256_sqrt_pd(vPlus);
+        const __m256d zv = _mm256_fmadd_pd(rhoBar, _mm256_loadu_pd(z2 + i),
+                                           _mm256_mul_pd(rho, w1));
+        const __m256d meanRevert = _mm256_mul_pd(kappaDt, _mm256_sub_pd(theta, vPlus));
+        _mm256_storeu_pd(variance + i,
+                         _mm256_add_pd(v, _mm256_fmadd_pd(_mm256_mul_pd(xiSqrtDt, sqrtV),
+                                                          zv, meanRevert)));
+        const __m256d logDrift = _mm256_fmadd_pd(minusHalfDt, vPlus, rDt);
+        const __m256d x = _mm256_fmadd_pd(_mm256_mul_pd(sqrtV, sqrtDt), w1, logDrift);
+        _mm256_storeu_pd(spot + i, _mm256_mul_pd(_mm256_loadu_pd(spot + i), expAvx2(x)));
+    }
+    hestonEulerStepScalar(spot + i, variance + i, z1 + i, z2 + i, c, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void localVolStepAvx2(
+    double* x, const double* z, const LocalVolStepConstants& c, std::size_t n) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d last = _mm256_set1_pd(static_cast<double>(c.nodes - 1));
+    const __m256d lastCell = _mm256_set1_pd(static_cast<double>(c.nodes - 2));
+    const __m256d x0 = _mm256_set1_pd(c.x0);
+    const __m256d invDx = _mm256_set1_pd(c.invDx);
+    const __m256d minusHalfDt = _mm256_set1_pd(c.minusHalfDt);
+    const __m256d sqrtDt = _mm256_set1_pd(c.sqrtDt);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d xi = _mm256_loadu_pd(x + i);
+        const __m256d u = _mm256_min_pd(
+            _mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(xi, x0), invDx), zero), last);
+        const __m256d cell = _mm256_min_pd(_mm256_floor_pd(u), lastCell);
+        const __m128i j = _mm256_cvttpd_epi32(cell);
+        const __m256d lo = _mm256_i32gather_pd(c.vols, j, 8);
+        const __m256d hi = _mm256_i32gather_pd(c.vols + 1, j, 8);
+        const __m256d sigma = _mm256_fmadd_pd(_mm256_sub_pd(u, cell),
+                                              _mm256_sub_pd(hi, lo), lo);
+        const __m256d drift = _mm256_mul_pd(_mm256_mul_pd(minusHalfDt, sigma), sigma);
+        const __m256d step = _mm256_fmadd_pd(_mm256_mul_pd(sigma, sqrtDt),
+                                             _mm256_loadu_pd(z + i), drift);
+        _mm256_storeu_pd(x + i, _mm256_add_pd(xi, step));
+    }
+    localVolStepScalar(x + i, z + i, c, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void correlateNormalsAvx2(
+    const double* lower, std::size_t factors, double* z, std::size_t n) {
+    const std::size_t vectorEnd = n - n % 4;
+    for (std::size_t i = factors; i-- > 0;) {
+        const double* l = lower + i * factors;
+        double* out = z + i * n;
+        for (std::size_t p = 0; p < vectorEnd; p += 4) {
+            __m256d acc = _mm256_mul_pd(_mm256_set1_pd(l[0]), _mm256_loadu_pd(z + p));
+            for (std::size_t k = 1; k <= i; ++k) {
+                acc = _mm256_fmadd_pd(_mm256_set1_pd(l[k]), _mm256_loadu_pd(z + k * n + p),
+                                      acc);
+            }
+            _mm256_storeu_pd(out + p, acc);
+        }
+    }
+    correlateNormalsScalar(lower, factors, z, n, vectorEnd);
+}
+
+__attribute__((target("avx2,fma"))) void inverseNormalAvx2(const double* u,
+                                                           double* z,
+                                                           std::size_t n) {
+    const __m256d lo = _mm256_set1_pd(kPLow);
+    const __m256d hi = _mm256_set1_pd(kPHigh);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d p = _mm256_loadu_pd(u + i);
+        const __m256d q = _mm256_sub_pd(p, _mm256_set1_pd(0.5));
+        const __m256d r = _mm256_mul_pd(q, q);
+        __m256d num = _mm256_set1_pd(kA[0]);
+        for (int k = 1; k < 6; ++k) num = _mm256_fmadd_pd(num, r, _mm256_set1_pd(kA[k]));
+        __m256d den = _mm256_set1_pd(kB[0]);
+        for (int k = 1; k < 5; ++k) den = _mm256_fmadd_pd(den, r, _mm256_set1_pd(kB[k]));
+        den = _mm256_fmadd_pd(den, r, _mm256_set1_pd(1.0));
+        const __m256d tails = _mm256_or_pd(_mm256_cmp_pd(p, lo, _CMP_LT_OQ),
+                                           _mm256_cmp_pd(p, hi, _CMP_GT_OQ));
+        const int tailMask = _mm256_movemask_pd(tails);
+        if (tailMask == 0) {
+            _mm256_storeu_pd(z + i, _mm256_div_pd(_mm256_mul_pd(num, q), den));
+            continue;
+        }
+        // Keep the inputs: 'z' may alias 'u'.
+        alignas(32) double in[4];
+        _mm256_store_pd(in, p);
+        _mm256_storeu_pd(z + i, _mm256_div_pd(_mm256_mul_pd(num, q), den));
+        for (int lane = 0; lane < 4; ++lane) {
+            if (tailMask & (1 << lane)) {
+                z[i + lane] = inverseNormalTail(in[lane]);
+            }
+        }
+    }
+    inverseNormalScalarArray(u + i, z + i, n - i);
+}
+
+// hi:lo = x * m for the eight 32-bit lanes of x (two 4 x 64-bit multiplies).
+__attribute__((target("avx2,fma"))) inline void mulHiLoAvx2(__m256i x, __m256i m,
+                                                           __m256i& hi, __m256i& lo) {
+    const __m256i even = _mm256_mul_epu32(x, m);
+    const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), m);
+    lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+__attribute__((target("avx2,fma"))) void philoxWordsAvx2(const PhiloxStream& stream,
+                                                         const std::uint64_t* counters,
+                                                         std::size_t n,
+                                                         std::uint32_t* words) {
+    const std::size_t vectorEnd = n - n % 8;
+    const __m256i m0 = _mm256_set1_epi32(static_cast<int>(kPhiloxM0));
+    const __m256i m1 = _mm256_set1_epi32(static_cast<int>(kPhiloxM1));
+    for (std::size_t i = 0; i < vectorEnd; i += 8) {
+        alignas(32) std::uint32_t low[8];
+        alignas(32) std::uint32_t high[8];
+        for (int lane = 0; lane < 8; ++lane) {
+            low[lane] = static_cast<std::uint32_t>(counters[i + lane]);
+            high[lane] = static_cast<std::uint32_t>(counters[i + lane] >> 32);
+        }
+        __m256i c0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(low));
+        __m256i c1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(high));
+        const auto streamLow = static_cast<std::uint32_t>(stream.stream);
+        const auto streamHigh = static_cast<std::uint32_t>(stream.stream >> 32);
+        __m256i c2 = _mm256_set1_epi32(static_cast<int>(streamLow));
+        __m256i c3 = _mm256_set1_epi32(static_cast<int>(streamHigh));
+        std::uint32_t k0 = stream.key[0];
+        std::uint32_t k1 = stream.key[1];
+        for (int r = 0; r < kPhiloxRounds; ++r) {
+            if (r > 0) {
+                k0 += kPhiloxW0;
+                k1 += kPhiloxW1;
+            }
+            __m256i hi0, lo0, hi1, lo1;
+            mulHiLoAvx2(c0, m0, hi0, lo0);
+            mulHiLoAvx2(c2, m1, hi1, lo1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1),
+                                  _mm256_set1_epi32(static_cast<int>(k0)));
+            c1 = lo1;
+            c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3),
+                                  _mm256_set1_epi32(static_cast<int>(k1)));
+            c3 = lo0;
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + i), c0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + n + i), c1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + 2 * n + i), c2);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + 3 * n + i), c3);
+    }
+    philoxWordsScalar(stream, counters, n, words, vectorEnd);
+}
+
+// -----------------------------------------------------------------------------
+// AVX-512F kernels (8 lanes)
+// -----------------------------------------------------------------------------
+__attribute__((target("avx512f"))) inline __m512d expAvx512(__m512d x) {
+    x = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(kExpMin)),
+                      _mm512_set1_pd(kExpMax));
+    const __m512d n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(kLog2e)),
+                                           _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(kLn2Hi), x);
+    r = _mm512_fnmadd_pd(n, _mm512_set1_pd(kLn2Lo), r);
+
+    __m512d p = _mm512_set1_pd(kExpPoly[0]);
+    for (int k = 1; k < kExpPolySize; ++k) {
+        p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(kExpPoly[k]));
+    }
+
+    __m512i bits = _mm512_castpd_si512(_mm512_add_pd(n, _mm512_set1_pd(kRoundMagic)));
+    bits = _mm512_slli_epi64(_mm512_add_epi64(bits, _mm512_set1_epi64(1023)), 52);
+    return _mm512_mul_pd(p, _mm512_castsi512_pd(bits));
+}
+
+__attribute__((target("avx512f"))) void scaledExpAvx512(const double* base,
+                                                        const double* z, double a,
+                                                        double b, double* out,
+                                                        std::size_t n) {
+    const __m512d va = _mm512_set1_pd(a);
+    const __m512d vb = _mm512_set1_pd(b);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d x = _mm512_fmadd_pd(vb, _mm512_loadu_pd(z + i), va);
+        _mm512_storeu_pd(out + i, _mm512_mul_pd(_mm512_loadu_pd(base + i), expAvx512(x)));
+    }
+    scaledExpScalar(base + i, z + i, a, b, out + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void hestonEulerStepAvx512(
+    double* spot, double* variance, const double* z1, const double* z2,
+    const HestonStepConstants& c, std::size_t n) {
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d kappaDt = _mm512_set1_pd(c.kappaDt);
+    const __m512d theta = _mm512_set1_pd(c.theta);
+    const __m512d xiSqrtDt = _mm512_set1_pd(c.xiSqrtDt);
+    const __m512d rho = _mm512_set1_pd(c.rho);
+    const __m512d rhoBar = _mm512_set1_pd(c.rhoBar);
+    const __m512d rDt = _mm512_set1_pd(c.rDt);
+    const __m512d minusHalfDt = _mm512_set1_pd(c.minusHalfDt);
+    const __m512d sqrtDt = _mm512_set1_pd(c.sqrtDt);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d v = _mm512_loadu_pd(variance + i);
+        const __m512d w1 = _mm512_loadu_pd(z1 + i);
+        const __m512d vPlus = _mm512_max_pd(v, zero);
+        const __m512d sqrtV = _mm512_sqrt_pd(vPlus);
+        const __m512d zv = _mm512_fmadd_pd(rhoBar, _mm512_loadu_pd(z2 + i),
+                                           _mm512_mul_pd(rho, w1));
+        const __m512d meanRevert = _mm512_mul_pd(kappaDt, _mm512_sub_pd(theta, vPlus));
+        _mm512_storeu_pd(variance + i,
+                         _mm512_add_pd(v, _mm512_fmadd_pd(_mm512_mul_pd(xiSqrtDt, sqrtV),
+                                                          zv, meanRevert)));
+        const __m512d logDrift = _mm512_fmadd_pd(minusHalfDt, vPlus, rDt);
+        const __m512d x = _mm512_fmadd_pd(_mm512_mul_pd(sqrtV, sqrtDt), w1, logDrift);
+        _mm512_storeu_pd(spot + i, _mm512_mul_pd(_mm512_loadu_pd(spot + i), expAvx512(x)));
+    }
+    hestonEulerStepScalar(spot + i, variance + i, z1 + i, z2 + i, c, n - i);
+}
+
+__attribute__((target("avx512f"))) void localVolStepAvx512(
+    double* x, const double* z, const LocalVolStepConstants& c, std::size_t n) {
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d last = _mm512_set1_pd(static_cast<double>(c.nodes - 1));
+    const __m512d lastCell = _mm512_set1_pd(static_cast<double>(c.nodes - 2));
+    const __m512d x0 = _mm512_set1_pd(c.x0);
+    const __m512d invDx = _mm512_set1_pd(c.invDx);
+    const __m512d minusHalfDt = _mm512_set1_pd(c.minusHalfDt);
+    const __m512d sqrtDt = _mm512_set1_pd(c.sqrtDt);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d xi = _mm512_loadu_pd(x + i);
+        const __m512d u = _mm512_min_pd(
+            _mm512_max_pd(_mm512_mul_pd(_mm512_sub_pd(xi, x0), invDx), zero), last);
+        const __m512d cell = _mm512_min_pd(
+            _mm512_roundscale_pd(u, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), lastCell);
+        const __m256i j = _mm512_cvttpd_epi32(cell);
+        const __m512d lo = _mm512_i32gather_pd(j, c.vols, 8);
+        const __m512d hi = _mm512_i32gather_pd(j, c.vols + 1, 8);
+        const __m512d sigma = _mm512_fmadd_pd(_mm512_sub_pd(u, cell),
+                                              _mm512_sub_pd(hi, lo), lo);
+        const __m512d drift = _mm512_mul_pd(_mm512_mul_pd(minusHalfDt, sigma), sigma);
+        const __m512d step = _mm512_fmadd_pd(_mm512_mul_pd(sigma, sqrtDt),
+                                             _mm512_loadu_pd(z + i), drift);
+        _mm512_storeu_pd(x + i, _mm512_add_pd(xi, step));
+    }
+    localVolStepScalar(x + i, z + i, c, n - i);
+}
+
+__attribute__((target("avx512f"))) void correlateNormalsAvx512(
+    const double* lower, std::size_t factors, double* z, std::size_t n) {
+    const std::size_t vectorEnd = n - n % 8;
+    for (std::size_t i = factors; i-- > 0;) {
+        const double* l = lower + i * factors;
+        double* out = z + i * n;
+        for (std::size_t p = 0; p < vectorEnd; p += 8) {
+            __m512d acc = _mm512_mul_pd(_mm512_set1_pd(l[0]), _mm512_loadu_pd(z + p));
+            for (std::size_t k = 1; k <= i; ++k) {
+                acc = _mm512_fmadd_pd(_mm512_set1_pd(l[k]), _mm512_loadu_pd(z + k * n + p),
+                                      acc);
+            }
+            _mm512_storeu_pd(out + p, acc);
+        }
+    }
+    correlateNormalsScalar(lower, factors, z, n, vectorEnd);
+}
+
+__attribute__((target("avx512f"))) void inverseNormalAvx512(const double* u,
+                                                            double* z,
+                                                            std::size_t n) {
+    const __m512d lo = _mm512_set1_pd(kPLow);
+    const __m512d hi = _mm512_set1_pd(kPHigh);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d p = _mm512_loadu_pd(u + i);
+        const __m512d q = _mm512_sub_pd(p, _mm512_set1_pd(0.5));
+        const __m512d r = _mm512_mul_pd(q, q);
+        __m512d num = _mm512_set1_pd(kA[0]);
+        for (int k = 1; k < 6; ++k) num = _mm512_fmadd_pd(num, r, _mm512_set1_pd(kA[k]));
+        __m512d den = _mm512_set1_pd(kB[0]);
+        for (int k = 1; k < 5; ++k) den = _mm512_fmadd_pd(den, r, _mm512_set1_pd(kB[k]));
+        den = _mm512_fmadd_pd(den, r, _mm512_set1_pd(1.0));
+        const __mmask8 tailMask = _mm512_cmp_pd_mask(p, lo, _CMP_LT_OQ) |
+                                  _mm512_cmp_pd_mask(p, hi, _CMP_GT_OQ);
+        if (tailMask == 0) {
+            _mm512_storeu_pd(z + i, _mm512_div_pd(_mm512_mul_pd(num, q), den));
+            continue;
+        }
+        // Keep the inputs: 'z' may alias 'u'.
+        alignas(64) double in[8];
+        _mm512_store_pd(in, p);
+        _mm512_storeu_pd(z + i, _mm512_div_pd(_mm512_mul_pd(num, q), den));
+        for (int lane = 0; lane < 8; ++lane) {
+            if (tailMask & (1u << lane)) {
+                z[i + lane] = inverseNormalTail(in[lane]);
+            }
+        }
+    }
+    inverseNormalScalarArray(u + i, z + i, n - i);
+}
+
+// hi:lo = x * m for the sixteen 32-bit lanes of x.
+__attribute__((target("avx512f"))) inline void mulHiLoAvx512(__m512i x, __m512i m,
+                                                             __m512i& hi, __m512i& lo) {
+    const __m512i even = _mm512_mul_epu32(x, m);
+    const __m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(x, 32), m);
+    lo = _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+    hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+}
+
+__attribute__((target("avx512f"))) void philoxWordsAvx512(const PhiloxStream& stream,
+                                                          const std::uint64_t* counters,
+                                                          std::size_t n,
+                                                          std::uint32_t* words) {
+    const std::size_t vectorEnd = n - n % 16;
+    const __m512i m0 = _mm512_set1_epi32(static_cast<int>(kPhiloxM0));
+    const __m512i m1 = _mm512_set1_epi32(static_cast<int>(kPhiloxM1));
+    for (std::size_t i = 0; i < vectorEnd; i += 16) {
+        alignas(64) std::uint32_t low[16];
+        alignas(64) std::uint32_t high[16];
+        for (int lane = 0; lane < 16; ++lane) {
+            low[lane] = static_cast<std::uint32_t>(counters[i + lane]);
+            high[lane] = static_cast<std::uint32_t>(counters[i + lane] >> 32);
+        }
+        __m512i c0 = _mm512_load_si512(low);
+        __m512i c1 = _mm512_load_si512(high);
+        const auto streamLow = static_cast<std::uint32_t>(stream.stream);
+        const auto streamHigh = static_cast<std::uint32_t>(stream.stream >> 32);
+        __m512i c2 = _mm512_set1_epi32(static_cast<int>(streamLow));
+        __m512i c3 = _mm512_set1_epi32(static_cast<int>(streamHigh));
+        std::uint32_t k0 = stream.key[0];
+        std::uint32_t k1 = stream.key[1];
+        for (int r = 0; r < kPhiloxRounds; ++r) {
+            if (r > 0) {
+                k0 += kPhiloxW0;
+                k1 += kPhiloxW1;
+            }
+            __m512i hi0, lo0, hi1, lo1;
+            mulHiLoAvx512(c0, m0, hi0, lo0);
+            mulHiLoAvx512(c2, m1, hi1, lo1);
+            c0 = _mm512_xor_si512(_mm512_xor_si512(hi1, c1),
+                                  _mm512_set1_epi32(static_cast<int>(k0)));
+            c1 = lo1;
+            c2 = _mm512_xor_si512(_mm512_xor_si512(hi0, c3),
+                                  _mm512_set1_epi32(static_cast<int>(k1)));
+            c3 = lo0;
+        }
+        _mm512_storeu_si512(words + i, c0);
+        _mm512_storeu_si512(words + n + i, c1);
+        _mm512_storeu_si512(words + 2 * n + i, c2);
+        _mm512_storeu_si512(words + 3 * n + i, c3);
+    }
+    philoxWordsScalar(stream, counters, n, words, vectorEnd);
+}
+#endif // PRICER_HAVE_X86_SIMD
+
+SimdLevel detectSimdLevel() {
+    SimdLevel level = SimdLevel::Scalar;
+#ifdef PRICER_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        level = SimdLevel::AVX512;
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        level = SimdLevel::AVX2;
+    }
+#endif
+    // Optional cap from the environment (never raises the level).
+    if (const char* env = std::getenv("PRICER_SIMD")) {
+        const std::string requested(env);
+        if (requested == "scalar") {
+            level = SimdLevel::Scalar;
+        } else if (requested == "avx2" && level == SimdLevel::AVX512) {
+            level = SimdLevel::AVX2;
+        }
+    }
+    return level;
+}
+
+// Uniform in (0, 1) from two 32-bit words: 53 bits, at the midpoint of its
+// cell so it is never exactly 0 or 1.
+inline double uniformFromWords(std::uint32_t high, std::uint32_t low) {
+    constexpr double kInv2Pow53 = 1.0 / 9007199254740992.0;
+    return ((high >> 5) * 67108864.0 + (low >> 6) + 0.5) * kInv2Pow53;
+}
+} // namespace
+
+SimdLevel activeSimdLevel() {
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX512:
+        return "avx512";
+    case SimdLevel::AVX2:
+        return "avx2";
+    case SimdLevel::Scalar:
+        break;
+    }
+    return "scalar";
+}
+
+void scaledExp(const double* base, const double* z, double a, double b,
+               double* out, std::size_t n) {
+    switch (activeSimdLevel()) {
+#ifdef PRICER_HAVE_X86_SIMD
+    case SimdLevel::AVX512:
+        scaledExpAvx512(base, z, a, b, out, n);
+        return;
+    case SimdLevel::AVX2:
+        scaledExpAvx2(base, z, a, b, out, n);
+        return;
+#endif
+    default:
+        scaledExpScalar(base, z, a, b, out, n);
+        return;
+    }
+}
+
+void hestonEulerStep(double* spot, double* variance, const double* z1,
+                     const double* z2, const HestonStepConstants& c,
+                     std::size_t n) {
+    switch (activeSimdLevel()) {
+#ifdef PRICER_HAVE_X86_SIMD
+    case SimdLevel::AVX512:
+        hestonEulerStepAvx512(spot, variance, z1, z2, c, n);
+        return;
+    case SimdLevel::AVX2:
+        hestonEulerStepAvx2(spot, variance, z1, z2, c, n);
+        return;
+#endif
+    default:
+        hestonEulerStepScalar(spot, variance, z1, z2, c, n);
+        return;
+    }
+}
+
+void hestonQeStep(double* spot, double* variance, const double* z1,
+                  const double* z2, const HestonQeStepConstants& c,
+                  std::size_t n) {
+    hestonQeStepScalar(spot, variance, z1, z2, c, n);
+}
+
+void localVolStep(double* x, const double* z, const LocalVolStepConstants& c,
+                  std::size_t n) {
+    switch (activeSimdLevel()) {
+#ifdef PRICER_HAVE_X86_SIMD
+    case SimdLevel::AVX512:
+        localVolStepAvx512(x, z, c, n);
+        return;
+    case SimdLevel::AVX2:
+        localVolStepAvx2(x, z, c, n);
+        return;
+#endif
+    default:
+        localVolStepScalar(x, z, c, n);
+        return;
+    }
+}
+
+void correlateNormals(const double* lower, std::size_t factors, double* z,
+                      std::size_t n) {
+    switch (activeSimdLevel()) {
+#ifdef PRICER_HAVE_X86_SIMD
+    case SimdLevel::AVX512:
+        correlateNormalsAvx512(lower, factors, z, n);
+        return;
+    case SimdLevel::AVX2:
+        correlateNormalsAvx2(lower, factors, z, n);
+        return;
+#endif
+    default:
+        correlateNormalsScalar(lower, factors, z, n, 0);
+        return;
+    }
+}
+
+void inverseNormal(const double* u, double* z, std::size_t n) {
+    switch (activeSimdLevel()) {
+#ifdef PRICER_HAVE_X86_SIMD
+    case SimdLevel::AVX512:
+        inverseNormalAvx512(u, z, n);
+        return;
+    case SimdLevel::AVX2:
+        inverseNormalAvx2(u, z, n);
+        return;
+#endif
+    default:
+        inverseNormalScalarArray(u, z, n);
+        return;
+    }
+}
+
+void fillStandardNormals(std::mt19937& rng, double* z, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint32_t hi = static_cast<std::uint32_t>(rng());
+        const std::uint32_t lo = static_cast<std::uint32_t>(rng());
+        z[i] = uniformFromWords(hi, lo);
+    }
+    inverseNormal(z, z, n);
+}
+
+void philoxWords(const PhiloxStream& stream, const std::uint64_t* counters, std::size_t n,
+                 std::uint32_t* words) {
+    switch (activeSimdLevel()) {
+#ifdef PRICER_HAVE_X86_SIMD
+    case SimdLevel::AVX512:
+        philoxWordsAvx512(stream, counters, n, words);
+        return;
+    case SimdLevel::AVX2:
+        philoxWordsAvx2(stream, counters, n, words);
+        return;
+#endif
+    default:
+        philoxWordsScalar(stream, counters, n, words, 0);
+        return;
+    }
+}
+
+void fillPhiloxNormals(const PhiloxStream& stream, std::uint64_t first, double* z,
+                       std::size_t n) {
+    std::uint64_t counters[kPhiloxChunk];
+    std::uint32_t words[4 * kPhiloxChunk];
+    std::size_t done = 0;
+    while (done < n) {
+        // Counter c holds normals 2c and 2c + 1; skip the first half when the
+        // next position is odd.
+        const std::uint64_t position = first + done;
+        const std::size_t skip = static_cast<std::size_t>(position & 1u);
+        const std::size_t count = std::min(kPhiloxChunk, (skip + n - done + 1) / 2);
+        for (std::size_t i = 0; i < count; ++i) counters[i] = (position >> 1) + i;
+        philoxWords(stream, counters, count, words);
+        for (std::size_t k = skip; k < 2 * count && done < n; ++k) {
+            const std::size_t i = k / 2;
+            const std::size_t half = k % 2;
+            z[done++] = uniformFromWords(words[2 * half * count + i],
+                                         words[(2 * half + 1) * count + i]);
+        }
+    }
+    inverseNormal(z, z, n);
+}
+
+void gatherPhiloxNormals(const PhiloxStream& stream, const std::uint64_t* positions,
+                         double* z, std::size_t n) {
+    std::uint64_t counters[kPhiloxChunk];
+    std::uint32_t words[4 * kPhiloxChunk];
+    for (std::size_t begin = 0; begin < n; begin += kPhiloxChunk) {
+        const std::size_t count = std::min(kPhiloxChunk, n - begin);
+        for (std::size_t i = 0; i < count; ++i) counters[i] = positions[begin + i] >> 1;
+        philoxWords(stream, counters, count, words);
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::size_t half = static_cast<std::size_t>(positions[begin + i] & 1u);
+            z[begin + i] = uniformFromWords(words[2 * half * count + i],
+                                            words[(2 * half + 1) * count + i]);
+        }
+    }
+    inverseNormal(z, z, n);
+}
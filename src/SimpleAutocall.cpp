@@ -21,8 +21,8 @@ SimpleAutocall::SimpleAutocall(std::string underlying,
     : AutocallBase(std::move(underlying), std::move(observationTimes), spot0,
                    notional, couponRate, callBarrier, protectionBarrier) {}
 
-std::vector<CashFlow> SimpleAutocall::cashFlows(const std::vector<double>& path) const {
-    std::vector<CashFlow> flows;
+void SimpleAutocall::emitCashFlows(const std::vector<double>& path,
+                                   CashFlowSink& sink) const {
     const auto& obs = times();
     const std::size_t steps = std::min(path.size(), obs.size());
 
@@ -30,13 +30,12 @@ std::vector<CashFlow> SimpleAutocall::cashFlows(const std::vector<double>& path)
     for (std::size_t i = 0; i < steps; ++i) {
         if (path[i] >= callBarrier()) {
             // Trigger condition met: pay capital + yield and stop the product.
-            flows.push_back({notional() * (1.0 + couponRate()), obs[i]});
-            return flows;
+            sink.onCashFlow(i, notional() * (1.0 + couponRate()));
+            return;
         }
     }
 
     // No early exit occurred; calculate the final payoff at maturity.
     const double finalSpot = (steps > 0) ? path[steps - 1] : spot0();
-    flows.push_back({terminalRedemption(finalSpot), obs.back()});
-    return flows;
+    sink.onCashFlow(maturityIndex(), terminalRedemption(finalSpot));
 }
\ No newline at end of file
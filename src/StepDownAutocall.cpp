@@ -23,26 +23,27 @@ StepDownAutocall::StepDownAutocall(std::string underlying,
                    protectionBarrier),
       callBarriers_(std::move(callBarriers)) {}
 
-std::vector<CashFlow> StepDownAutocall::cashFlows(const std::vector<double>& path) const {
-    std::vector<CashFlow> flows;
+void StepDownAutocall::emitCashFlows(const std::vector<double>& path,
+                                     CashFlowSink& sink) const {
     const auto &obs = times();
     const std::size_t steps = std::min(path.size(), obs.size());
 
     for (std::size_t i = 0; i < steps; ++i) {
-        // Retrieve the barrier level for this period. 
-        // If the vector is shorter than the path, stick to the last defined barrier.
-        double currentBarrier = callBarriers_.empty() ? callBarrier() :
-            callBarriers_[std::min(i, callBarriers_.size() - 1)];
-
         // Check against the current (likely lower) barrier level.
-        if (path[i] >= currentBarrier) {
-            flows.push_back({notional() * (1.0 + couponRate()), obs[i]});
-            return flows;
+        if (path[i] >= callBarrierAt(i)) {
+            sink.onCashFlow(i, notional() * (1.0 + couponRate()));
+            return;
         }
     }
 
     // No autocall occurred; handle maturity.
     const double finalSpot = (steps > 0) ? path[steps - 1] : spot0();
-    flows.push_back({terminalRedemption(finalSpot), obs.back()});
-    return flows;
-}
\ No newline at end of file
+    sink.onCashFlow(maturityIndex(), terminalRedemption(finalSpot));
+}
+
+double StepDownAutocall::callBarrierAt(std::size_t i) const {
+    // Retrieve the barrier level for this period.
+    // If the vector is shorter than the path, stick to the last defined barrier.
+    return callBarriers_.empty() ? callBarrier()
+                                 : callBarriers_[std::min(i, callBarriers_.size() - 1)];
+}
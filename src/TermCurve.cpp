@@ -0,0 +1,92 @@
+/*
+ * SUMMARY: Piecewise term structures for rates, dividends and volatility.
+ * Curves are stored as averages at pillar dates and interpolated linearly in
+ * the integral (flat forwards between pillars), the usual convention for
+ * zero-rate and total-variance curves. Flat curves take their own exact
+ * branches so constant inputs price bit for bit as before.
+ */
+
+#include "TermCurve.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+TermCurve::TermCurve(double flatValue) : values_{flatValue} {}
+
+TermCurve::TermCurve(std::vector<double> times, std::vector<double> values)
+    : times_(std::move(times)), values_(std::move(values)) {
+    if (times_.empty() || times_.size() != values_.size()) {
+        throw std::invalid_argument(
+            "TermCurve: need one value per pillar and at least one pillar");
+    }
+    for (std::size_t i = 0; i < times_.size(); ++i) {
+        if (!(times_[i] > 0.0) || (i > 0 && !(times_[i] > times_[i - 1]))) {
+            throw std::invalid_argument(
+                "TermCurve: pillar times must be positive and strictly increasing");
+        }
+    }
+}
+
+double TermCurve::integral(double t) const {
+    if (values_.empty()) return 0.0;
+    if (times_.empty() || t <= times_.front()) return values_.front() * t;
+    if (t >= times_.back()) return values_.back() * t;
+
+    // First pillar at or after t; interpolate the integral from the previous one.
+    const std::size_t hi = static_cast<std::size_t>(
+        std::lower_bound(times_.begin(), times_.end(), t) - times_.begin());
+    const std::size_t lo = hi - 1;
+    const double left = values_[lo] * times_[lo];
+    const double right = values_[hi] * times_[hi];
+    const double w = (t - times_[lo]) / (times_[hi] - times_[lo]);
+    return left + w * (right - left);
+}
+
+double TermCurve::value(double t) const {
+    if (values_.empty()) return 0.0;
+    if (times_.empty() || t <= 0.0) return values_.front();
+    return integral(t) / t;
+}
+
+double TermCurve::forward(double t0, double t1) const {
+    if (values_.empty()) return 0.0;
+    if (times_.empty()) return values_.front();
+    if (t1 > t0) return (integral(t1) - integral(t0)) / (t1 - t0);
+
+    // Zero-length interval: the flat forward of the segment holding t1.
+    if (t1 <= times_.front() || t1 > times_.back()) return value(t1);
+    const std::size_t hi = static_cast<std::size_t>(
+        std::lower_bound(times_.begin(), times_.end(), t1) - times_.begin());
+    const std::size_t lo = hi - 1;
+    return (values_[hi] * times_[hi] - values_[lo] * times_[lo]) /
+           (times_[hi] - times_[lo]);
+}
+
+TermCurve TermCurve::shifted(double amount) const {
+    TermCurve curve = *this;
+    if (curve.values_.empty()) curve.values_.push_back(0.0);
+    for (double& v : curve.values_) v += amount;
+    return curve;
+}
+
+TermCurve TermCurve::squared() const {
+    TermCurve curve = *this;
+    for (double& v : curve.values_) v *= v;
+    return curve;
+}
+
+std::string TermCurve::key() const {
+    // Hex floats keep every bit of the pillars in the key.
+    std::ostringstream key;
+    key << std::hexfloat;
+    if (times_.empty()) {
+        key << (values_.empty() ? 0.0 : values_.front());
+        return key.str();
+    }
+    for (std::size_t i = 0; i < times_.size(); ++i) {
+        key << (i ? ";" : "") << times_[i] << '=' << values_[i];
+    }
+    return key.str();
+}
@@ -0,0 +1,111 @@
+/*
+ * SUMMARY: A small persistent fork/join pool.
+ * Workers sleep on a condition variable until a new batch of indexed tasks is
+ * published, then compete for indices through an atomic counter. The caller
+ * works alongside them and waits until every worker has left the batch.
+ */
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    const std::size_t total = resolveThreadCount(threads);
+    workers_.reserve(total - 1);
+    for (std::size_t i = 1; i < total; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::size_t ThreadPool::resolveThreadCount(std::size_t requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    // hardware_concurrency() may legitimately report 0 when unknown.
+    return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::parallelFor(std::size_t taskCount,
+                             const std::function<void(std::size_t)>& task) {
+    if (taskCount == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> run(runMutex_);
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // A worker woken late by the previous batch may still be draining it.
+        done_.wait(lock, [this] { return busy_ == 0; });
+        task_ = &task;
+        taskCount_ = taskCount;
+        next_.store(0);
+        error_ = nullptr;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    drain();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return busy_ == 0; });
+        task_ = nullptr;
+        error = error_;
+        error_ = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    std::uint64_t seen = 0;
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) {
+            return;
+        }
+        seen = generation_;
+        ++busy_;
+        lock.unlock();
+
+        drain();
+
+        lock.lock();
+        if (--busy_ == 0) {
+            done_.notify_all();
+        }
+    }
+}
+
+void ThreadPool::drain() {
+    for (;;) {
+        const std::size_t index = next_.fetch_add(1);
+        if (index >= taskCount_) {
+            return;
+        }
+        try {
+            (*task_)(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            // Make every other thread skip the remaining tasks.
+            next_.store(taskCount_);
+        }
+    }
+}
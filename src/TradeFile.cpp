@@ -0,0 +1,371 @@
+/*
+ * SUMMARY: CSV input/output for the headless batch pricer.
+ * Market files describe each underlying (spot, vol, rate and model), trade
+ * files describe the products, on one underlying or a basket; both are
+ * header-driven so columns may come in any order and optional ones may be
+ * left out. Errors carry the file name and line number so a bad row in an
+ * overnight batch is easy to find.
+ */
+
+#include "TradeFile.hpp"
+#include "MultiAssetMC.hpp"
+#include "TermCurve.hpp"
+#include "VolSurface.hpp"
+
+#include <cctype>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+std::string trim(const std::string& input) {
+    std::size_t first = 0;
+    while (first < input.size() &&
+           std::isspace(static_cast<unsigned char>(input[first]))) {
+        ++first;
+    }
+    std::size_t last = input.size();
+    while (last > first &&
+           std::isspace(static_cast<unsigned char>(input[last - 1]))) {
+        --last;
+    }
+    return input.substr(first, last - first);
+}
+
+std::string lower(std::string text) {
+    for (char& c : text) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return text;
+}
+
+std::vector<std::string> split(const std::string& line, char separator) {
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, separator)) {
+        fields.push_back(trim(field));
+    }
+    if (!line.empty() && line.back() == separator) {
+        fields.emplace_back();
+    }
+    return fields;
+}
+
+// One data row of a header-driven CSV file, addressed by column name.
+class CsvRow {
+public:
+    CsvRow(const std::unordered_map<std::string, std::size_t>& columns,
+           std::vector<std::string> fields, std::string where)
+        : columns_(columns), fields_(std::move(fields)), where_(std::move(where)) {}
+
+    bool has(const std::string& name) const {
+        const auto it = columns_.find(name);
+        return it != columns_.end() && it->second < fields_.size() &&
+               !fields_[it->second].empty();
+    }
+
+    const std::string& text(const std::string& name) const {
+        if (!has(name)) fail("missing value for column '" + name + "'");
+        return fields_[columns_.at(name)];
+    }
+
+    double number(const std::string& name) const {
+        const std::string& value = text(name);
+        try {
+            std::size_t used = 0;
+            const double parsed = std::stod(value, &used);
+            if (used == value.size()) return parsed;
+        } catch (const std::exception&) {
+        }
+        fail("invalid number '" + value + "' in column '" + name + "'");
+    }
+
+    double number(const std::string& name, double fallback) const {
+        return has(name) ? number(name) : fallback;
+    }
+
+    std::vector<double> numbers(const std::string& name) const {
+        std::vector<double> values;
+        for (const std::string& token : split(text(name), ';')) {
+            if (token.empty()) continue;
+            try {
+                values.push_back(std::stod(token));
+            } catch (const std::exception&) {
+                fail("invalid number '" + token + "' in column '" + name + "'");
+            }
+        }
+        return values;
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error(where_ + ": " + message);
+    }
+
+private:
+    const std::unordered_map<std::string, std::size_t>& columns_;
+    std::vector<std::string> fields_;
+    std::string where_;
+};
+
+// Reads the header, then hands every non-empty, non-comment row to 'handle'.
+template <typename Handler>
+void forEachRow(std::istream& in, const std::string& source,
+                const std::vector<std::string>& required, Handler handle) {
+    std::string line;
+    std::size_t lineNumber = 0;
+    std::unordered_map<std::string, std::size_t> columns;
+    bool haveHeader = false;
+
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        const std::string cleaned = trim(line);
+        if (cleaned.empty() || cleaned.front() == '#') continue;
+
+        const std::vector<std::string> fields = split(cleaned, ',');
+        if (!haveHeader) {
+            for (std::size_t i = 0; i < fields.size(); ++i) {
+                columns[lower(fields[i])] = i;
+            }
+            for (const std::string& name : required) {
+                if (!columns.count(name)) {
+                    throw std::runtime_error(source + ": header lacks column '" + name + "'");
+                }
+            }
+            haveHeader = true;
+            continue;
+        }
+        handle(CsvRow(columns, fields, source + ":" + std::to_string(lineNumber)));
+    }
+    if (!haveHeader) {
+        throw std::runtime_error(source + ": empty file (header row expected)");
+    }
+}
+
+std::ifstream openInput(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open " + path);
+    return in;
+}
+} // namespace
+
+MarketFile readMarketCsv(std::istream& in, const std::string& source) {
+    MarketFile market;
+    forEachRow(in, source, {"underlying", "spot", "sigma", "rate"}, [&](const CsvRow& row) {
+        UnderlyingMarket entry;
+        entry.spot = row.number("spot");
+        entry.sigma = row.number("sigma");
+        entry.rate = row.number("rate");
+        if (row.has("model")) {
+            const std::string model = lower(row.text("model"));
+            if (model == "heston") {
+                entry.model = ModelType::Heston;
+            } else if (model == "localvol") {
+                entry.model = ModelType::LocalVol;
+            } else if (model != "bs" && model != "blackscholes") {
+                row.fail("unknown model '" + model + "' (bs|heston|localvol)");
+            }
+        }
+        entry.hestonV0 = row.number("v0", entry.hestonV0);
+        entry.hestonKappa = row.number("kappa", entry.hestonKappa);
+        entry.hestonTheta = row.number("theta", entry.hestonTheta);
+        entry.hestonXi = row.number("xi", entry.hestonXi);
+        entry.hestonRho = row.number("rho", entry.hestonRho);
+        if (row.has("scheme")) {
+            const std::string scheme = lower(row.text("scheme"));
+            if (scheme == "qe") {
+                entry.hestonScheme = HestonScheme::QuadraticExponential;
+            } else if (scheme != "euler") {
+                row.fail("unknown scheme '" + scheme + "' (euler|qe)");
+            }
+        }
+        entry.hestonMaxStep = row.number("step", entry.hestonMaxStep);
+        if (!(entry.hestonMaxStep > 0.0)) row.fail("column 'step' must be positive");
+        if (row.has("curve_times")) entry.curveTimes = row.numbers("curve_times");
+        const auto curve = [&](const std::string& name) {
+            if (!row.has(name)) return std::vector<double>{};
+            std::vector<double> values = row.numbers(name);
+            try {
+                TermCurve(entry.curveTimes, values); // Validates the pillars.
+            } catch (const std::invalid_argument& error) {
+                row.fail("column '" + name + "': " + error.what());
+            }
+            return values;
+        };
+        entry.rateCurve = curve("zero_rates");
+        entry.dividendCurve = curve("dividend_yields");
+        entry.volCurve = curve("vols");
+        if (row.has("surface_vols")) {
+            entry.surfaceExpiries = row.numbers("surface_expiries");
+            entry.surfaceMoneyness = row.numbers("surface_moneyness");
+            entry.surfaceVols = row.numbers("surface_vols");
+            try {
+                ImpliedVolSurface(entry.surfaceExpiries, entry.surfaceMoneyness,
+                                  entry.surfaceVols); // Validates the grid.
+            } catch (const std::invalid_argument& error) {
+                row.fail(std::string("vol surface: ") + error.what());
+            }
+        }
+        entry.calibrate = row.number("calibrate", 0.0) != 0.0;
+        if (entry.calibrate && entry.surfaceVols.empty()) {
+            row.fail("calibrate needs surface_vols");
+        }
+        if (!market.emplace(row.text("underlying"), entry).second) {
+            row.fail("duplicate underlying '" + row.text("underlying") + "'");
+        }
+    });
+    return market;
+}
+
+MarketFile readMarketFile(const std::string& path) {
+    std::ifstream in = openInput(path);
+    return readMarketCsv(in, path);
+}
+
+std::vector<TradeRecord> readTradeCsv(std::istream& in, const std::string& source,
+                                      const MarketFile& market) {
+    std::vector<TradeRecord> trades;
+    forEachRow(in, source, {"id", "underlying", "family", "type", "times"},
+               [&](const CsvRow& row) {
+        TradeRecord record;
+        record.id = row.text("id");
+        PricingInputs& inputs = record.trade.inputs;
+        record.trade.quantity = row.number("quantity", 1.0);
+
+        inputs.underlying = row.text("underlying");
+        // A ';'-separated list of underlyings makes a basket trade.
+        std::vector<const UnderlyingMarket*> assets;
+        for (const std::string& name : split(inputs.underlying, ';')) {
+            const auto quote = market.find(name);
+            if (quote == market.end()) {
+                row.fail("no market data for underlying '" + name + "'");
+            }
+            assets.push_back(&quote->second);
+            inputs.basketUnderlyings.push_back(name);
+        }
+        if (assets.empty()) row.fail("missing value for column 'underlying'");
+        const UnderlyingMarket& m = *assets.front();
+        inputs.spot = m.spot;
+        inputs.sigma = m.sigma;
+        inputs.rate = m.rate;
+        inputs.modelType = m.model;
+        inputs.hestonV0 = m.hestonV0;
+        inputs.hestonKappa = m.hestonKappa;
+        inputs.hestonTheta = m.hestonTheta;
+        inputs.hestonXi = m.hestonXi;
+        inputs.hestonRho = m.hestonRho;
+        inputs.hestonScheme = m.hestonScheme;
+        inputs.hestonMaxStep = m.hestonMaxStep;
+        inputs.curveTimes = m.curveTimes;
+        inputs.rateCurve = m.rateCurve;
+        inputs.dividendCurve = m.dividendCurve;
+        inputs.volCurve = m.volCurve;
+        inputs.surfaceExpiries = m.surfaceExpiries;
+        inputs.surfaceMoneyness = m.surfaceMoneyness;
+        inputs.surfaceVols = m.surfaceVols;
+        inputs.calibrateToSurface = m.calibrate;
+        if (assets.size() == 1) {
+            inputs.basketUnderlyings.clear();
+        } else {
+            // Correlated Black-Scholes on each asset's sigma, dividend and vol
+            // curves; the first asset supplies the rate and rate curve, prices
+            // are per reference level.
+            inputs.modelType = ModelType::BlackScholes;
+            inputs.calibrateToSurface = false;
+            inputs.spot = row.number("reference_level", 100.0);
+            inputs.dividendCurve.clear();
+            inputs.volCurve.clear();
+            for (const UnderlyingMarket* asset : assets) {
+                inputs.basketVols.push_back(asset->sigma);
+                inputs.basketCurveTimes.push_back(asset->curveTimes);
+                inputs.basketDividendCurves.push_back(asset->dividendCurve);
+                inputs.basketVolCurves.push_back(asset->volCurve);
+            }
+            const std::string basket = lower(row.has("basket") ? row.text("basket")
+                                                                : "worst_of");
+            if (basket == "worst_of") inputs.basketType = BasketType::WorstOf;
+            else if (basket == "best_of") inputs.basketType = BasketType::BestOf;
+            else if (basket == "average") inputs.basketType = BasketType::Average;
+            else row.fail("unknown basket '" + basket + "' (worst_of|best_of|average)");
+
+            const std::size_t n = assets.size();
+            const std::vector<double> rho =
+                row.has("correlation") ? row.numbers("correlation") : std::vector<double>{0.0};
+            if (rho.size() == 1) {
+                inputs.basketCorrelation.assign(n * n, rho.front());
+                for (std::size_t i = 0; i < n; ++i) inputs.basketCorrelation[i * n + i] = 1.0;
+            } else if (rho.size() == n * n) {
+                inputs.basketCorrelation = rho;
+            } else {
+                row.fail("correlation needs 1 or " + std::to_string(n * n) + " values");
+            }
+            try {
+                std::vector<BasketAsset> basket;
+                for (std::size_t i = 0; i < n; ++i) {
+                    basket.push_back({inputs.basketUnderlyings[i], inputs.basketVols[i]});
+                }
+                MultiAssetMC(basket, inputs.basketCorrelation, inputs.basketType);
+            } catch (const std::invalid_argument& error) {
+                row.fail(error.what());
+            }
+        }
+
+        const std::string family = lower(row.text("family"));
+        const std::string type = lower(row.text("type"));
+        if (family == "autocall") {
+            inputs.productFamily = ProductFamily::Autocall;
+            if (type == "simple") inputs.autocallType = AutocallType::Simple;
+            else if (type == "phoenix") inputs.autocallType = AutocallType::Phoenix;
+            else if (type == "memory_phoenix") inputs.autocallType = AutocallType::MemoryPhoenix;
+            else if (type == "step_down") inputs.autocallType = AutocallType::StepDown;
+            else if (type == "airbag") inputs.autocallType = AutocallType::Airbag;
+            else row.fail("unknown autocall type '" + type + "'");
+        } else if (family == "cliquet") {
+            inputs.productFamily = ProductFamily::Cliquet;
+            if (type == "max_return") inputs.cliquetType = CliquetType::MaxReturn;
+            else if (type == "capped_coupons") inputs.cliquetType = CliquetType::CappedCoupons;
+            else row.fail("unknown cliquet type '" + type + "'");
+        } else {
+            row.fail("unknown family '" + family + "' (autocall|cliquet)");
+        }
+
+        inputs.observationTimes = row.numbers("times");
+        if (inputs.observationTimes.empty()) row.fail("no observation times");
+        inputs.notional = row.number("notional", inputs.notional);
+        inputs.coupon = row.number("coupon", inputs.coupon);
+        inputs.autocallBarrier = row.number("autocall_barrier", inputs.autocallBarrier);
+        inputs.protectionBarrier =
+            row.number("protection_barrier", inputs.protectionBarrier);
+        inputs.couponBarrier = row.number("coupon_barrier", inputs.autocallBarrier);
+        if (row.has("call_barriers")) inputs.callBarriers = row.numbers("call_barriers");
+        inputs.airbagFloor = row.number("airbag_floor", inputs.airbagFloor);
+        inputs.cliquetParticipation =
+            row.number("participation", inputs.cliquetParticipation);
+        inputs.cliquetCap = row.number("cap", inputs.cliquetCap);
+        inputs.spreadFraction = row.number("spread", inputs.spreadFraction);
+
+        trades.push_back(std::move(record));
+    });
+    return trades;
+}
+
+std::vector<TradeRecord> readTradeFile(const std::string& path, const MarketFile& market) {
+    std::ifstream in = openInput(path);
+    return readTradeCsv(in, path, market);
+}
+
+void writeResultsCsv(std::ostream& out, const std::vector<TradeRecord>& trades,
+                     const PortfolioResults& results) {
+    const auto precision = out.precision(std::numeric_limits<double>::max_digits10);
+    out << "id,quantity,price,std_error,delta,gamma,vega,bid,ask,paths,expected_life\n";
+    for (std::size_t i = 0; i < trades.size() && i < results.trades.size(); ++i) {
+        const PricingResults& r = results.trades[i];
+        out << trades[i].id << ',' << trades[i].trade.quantity << ',' << r.price << ','
+            << r.stdError << ',' << r.delta << ',' << r.gamma << ',' << r.vega << ','
+            << r.bid << ',' << r.ask << ',' << r.pathsUsed << ',' << r.expectedLife << '\n';
+    }
+    out.precision(precision);
+}
@@ -0,0 +1,176 @@
+/*
+ * SUMMARY: Implied volatility surface used to calibrate the local-vol model.
+ * Smiles are natural cubic splines in forward log-moneyness, so the Dupire
+ * formula gets smooth analytic first and second strike derivatives; expiries
+ * are joined linearly in total variance, the usual arbitrage-friendly choice.
+ */
+
+#include "VolSurface.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+ImpliedVolSurface::ImpliedVolSurface(double sigma)
+    : ImpliedVolSurface({1.0}, {0.0}, {sigma}) {}
+
+ImpliedVolSurface::ImpliedVolSurface(std::vector<double> expiries,
+                                     std::vector<double> logMoneyness,
+                                     std::vector<double> vols)
+    : expiries_(std::move(expiries)), strikes_(std::move(logMoneyness)),
+      vols_(std::move(vols)) {
+    if (expiries_.empty() || strikes_.empty() ||
+        vols_.size() != expiries_.size() * strikes_.size()) {
+        throw std::invalid_argument(
+            "ImpliedVolSurface: need one vol per (expiry, strike) and at least one of each");
+    }
+    for (std::size_t i = 0; i < expiries_.size(); ++i) {
+        if (!(expiries_[i] > 0.0) || (i > 0 && !(expiries_[i] > expiries_[i - 1]))) {
+            throw std::invalid_argument(
+                "ImpliedVolSurface: expiries must be positive and strictly increasing");
+        }
+    }
+    for (std::size_t j = 1; j < strikes_.size(); ++j) {
+        if (!(strikes_[j] > strikes_[j - 1])) {
+            throw std::invalid_argument(
+                "ImpliedVolSurface: log-moneyness must be strictly increasing");
+        }
+    }
+    for (double v : vols_) {
+        if (!(v > 0.0)) throw std::invalid_argument("ImpliedVolSurface: vols must be positive");
+    }
+    // Same rule as MarketData::setVolCurve, strike by strike.
+    const std::size_t n = strikes_.size();
+    for (std::size_t i = 1; i < expiries_.size(); ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            const double before = vols_[(i - 1) * n + j];
+            const double after = vols_[i * n + j];
+            if (after * after * expiries_[i] < before * before * expiries_[i - 1]) {
+                throw std::invalid_argument(
+                    "ImpliedVolSurface: total variance decreases with expiry");
+            }
+        }
+    }
+    buildSplines();
+}
+
+void ImpliedVolSurface::buildSplines() {
+    // Natural cubic spline per expiry: solve the tridiagonal system for the
+    // second derivatives (Thomas algorithm), zero at both ends.
+    const std::size_t n = strikes_.size();
+    curvature_.assign(vols_.size(), 0.0);
+    if (n < 3) return;
+
+    std::vector<double> diag(n), rhs(n);
+    for (std::size_t i = 0; i < expiries_.size(); ++i) {
+        const double* v = vols_.data() + i * n;
+        double* m = curvature_.data() + i * n;
+        for (std::size_t j = 1; j + 1 < n; ++j) {
+            const double h0 = strikes_[j] - strikes_[j - 1];
+            const double h1 = strikes_[j + 1] - strikes_[j];
+            diag[j] = 2.0 * (h0 + h1);
+            rhs[j] = 6.0 * ((v[j + 1] - v[j]) / h1 - (v[j] - v[j - 1]) / h0);
+            if (j > 1) {
+                const double factor = h0 / diag[j - 1];
+                diag[j] -= factor * h0;
+                rhs[j] -= factor * rhs[j - 1];
+            }
+        }
+        for (std::size_t j = n - 2; j >= 1; --j) {
+            const double h1 = strikes_[j + 1] - strikes_[j];
+            m[j] = (rhs[j] - h1 * m[j + 1]) / diag[j];
+        }
+    }
+}
+
+void ImpliedVolSurface::smile(std::size_t i, double k, double& v, double& dv,
+                              double& d2v) const {
+    const std::size_t n = strikes_.size();
+    const double* vols = vols_.data() + i * n;
+    const double* m = curvature_.data() + i * n;
+    dv = 0.0;
+    d2v = 0.0;
+    if (n == 1 || k <= strikes_.front()) {
+        v = vols[0];
+        return;
+    }
+    if (k >= strikes_.back()) {
+        v = vols[n - 1];
+        return;
+    }
+    const std::size_t hi = static_cast<std::size_t>(
+        std::upper_bound(strikes_.begin(), strikes_.end(), k) - strikes_.begin());
+    const std::size_t lo = hi - 1;
+    const double h = strikes_[hi] - strikes_[lo];
+    const double a = (strikes_[hi] - k) / h;
+    const double b = (k - strikes_[lo]) / h;
+    v = a * vols[lo] + b * vols[hi] +
+        ((a * a * a - a) * m[lo] + (b * b * b - b) * m[hi]) * h * h / 6.0;
+    dv = (vols[hi] - vols[lo]) / h +
+         ((1.0 - 3.0 * a * a) * m[lo] + (3.0 * b * b - 1.0) * m[hi]) * h / 6.0;
+    d2v = a * m[lo] + b * m[hi];
+}
+
+ImpliedVolSurface::Point ImpliedVolSurface::totalVariance(double T, double k) const {
+    // w_i(k) = sigma_i(k)^2 T_i and its k-derivatives on the smile of expiry i.
+    const auto smileVariance = [&](std::size_t i, double t, Point& p, double& sigma2) {
+        double v, dv, d2v;
+        smile(i, k, v, dv, d2v);
+        sigma2 = v * v;
+        p.w = sigma2 * t;
+        p.dwdk = 2.0 * v * dv * t;
+        p.d2wdk2 = 2.0 * t * (dv * dv + v * d2v);
+    };
+
+    Point point{};
+    double sigma2 = 0.0;
+    if (T <= expiries_.front() || expiries_.size() == 1 || T >= expiries_.back()) {
+        const std::size_t i = T <= expiries_.front() ? 0 : expiries_.size() - 1;
+        smileVariance(i, T, point, sigma2);
+        point.dwdT = sigma2;
+        return point;
+    }
+
+    const std::size_t hi = static_cast<std::size_t>(
+        std::upper_bound(expiries_.begin(), expiries_.end(), T) - expiries_.begin());
+    const std::size_t lo = hi - 1;
+    Point left{}, right{};
+    smileVariance(lo, expiries_[lo], left, sigma2);
+    smileVariance(hi, expiries_[hi], right, sigma2);
+    const double span = expiries_[hi] - expiries_[lo];
+    const double a = (T - expiries_[lo]) / span;
+    point.w = left.w + a * (right.w - left.w);
+    point.dwdT = (right.w - left.w) / span;
+    point.dwdk = left.dwdk + a * (right.dwdk - left.dwdk);
+    point.d2wdk2 = left.d2wdk2 + a * (right.d2wdk2 - left.d2wdk2);
+    return point;
+}
+
+double ImpliedVolSurface::vol(double T, double k) const {
+    if (T <= 0.0) T = expiries_.front();
+    return std::sqrt(totalVariance(T, k).w / T);
+}
+
+double ImpliedVolSurface::maxVol() const {
+    return *std::max_element(vols_.begin(), vols_.end());
+}
+
+ImpliedVolSurface ImpliedVolSurface::shifted(double amount) const {
+    std::vector<double> vols = vols_;
+    for (double& v : vols) v += amount;
+    return ImpliedVolSurface(expiries_, strikes_, std::move(vols));
+}
+
+std::string ImpliedVolSurface::key() const {
+    // Hex floats keep every bit of the quotes in the key.
+    std::ostringstream key;
+    key << std::hexfloat;
+    for (std::size_t i = 0; i < expiries_.size(); ++i) key << (i ? ";" : "") << expiries_[i];
+    key << '/';
+    for (std::size_t j = 0; j < strikes_.size(); ++j) key << (j ? ";" : "") << strikes_[j];
+    key << '/';
+    for (std::size_t i = 0; i < vols_.size(); ++i) key << (i ? ";" : "") << vols_[i];
+    return key.str();
+}
@@ -0,0 +1,23 @@
+// Minimal checks for the ctest executables, so the tests need no framework.
+#pragma once
+
+#include <cstdio>
+
+/**
+ * @brief Number of failed CHECKs so far. Each test's main() returns it, so
+ * any failure fails the ctest test.
+ */
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+// Reports 'condition' with its location when it is false and counts it.
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, \
+                         #condition);                                           \
+            ++testFailures();                                                   \
+        }                                                                       \
+    } while (false)
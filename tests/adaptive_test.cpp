@@ -0,0 +1,85 @@
+/*
+ * SUMMARY: Adaptive path counts of the Monte Carlo engine.
+ * An adaptive run simulates batches of the same path sequence a fixed run
+ * does, so once it stops at pathsUsed paths its results must be
+ * bit-identical to a fixed run of pathsUsed paths. Checked for each stopping
+ * rule, for Sobol sampling, control variates, single-pass Greeks and for
+ * several thread counts.
+ */
+
+#include "PricerRunner.hpp"
+#include "TestCheck.hpp"
+
+#include <cstddef>
+#include <cstdio>
+
+namespace {
+constexpr std::size_t kMaxPaths = 2000000;
+
+void checkMatchesFixedRun(PricingInputs inputs) {
+    inputs.paths = kMaxPaths;
+    inputs.batchPaths = 10000;
+    const PricingResults adaptive = priceAutocall(inputs);
+    CHECK(adaptive.pathsUsed > 0);
+    CHECK(adaptive.pathsUsed < kMaxPaths);
+    if (inputs.targetStdError > 0.0) {
+        CHECK(adaptive.stdError <= inputs.targetStdError);
+    }
+    if (inputs.targetRelativeError > 0.0) {
+        CHECK(adaptive.stdError <= inputs.targetRelativeError * adaptive.price);
+    }
+
+    PricingInputs fixed = inputs;
+    fixed.targetStdError = 0.0;
+    fixed.targetRelativeError = 0.0;
+    fixed.timeBudgetSeconds = 0.0;
+    fixed.paths = adaptive.pathsUsed;
+    const PricingResults reference = priceAutocall(fixed);
+    CHECK(adaptive.pathsUsed == reference.pathsUsed);
+    CHECK(adaptive.price == reference.price);
+    CHECK(adaptive.stdError == reference.stdError);
+    CHECK(adaptive.delta == reference.delta);
+    CHECK(adaptive.gamma == reference.gamma);
+    CHECK(adaptive.vega == reference.vega);
+}
+} // namespace
+
+int main() {
+    PricingInputs base;
+    base.autocallType = AutocallType::Phoenix;
+
+    PricingInputs absolute = base;
+    absolute.modelType = ModelType::Heston;
+    absolute.targetStdError = 0.5;
+    checkMatchesFixedRun(absolute);
+
+    PricingInputs relative = base;
+    relative.targetRelativeError = 5e-4;
+    for (std::size_t threads : {1, 3}) {
+        relative.threads = threads;
+        checkMatchesFixedRun(relative);
+    }
+
+    PricingInputs sobol = absolute;
+    sobol.sampling = SamplingMode::Sobol;
+    sobol.targetStdError = 0.1;
+    checkMatchesFixedRun(sobol);
+
+    PricingInputs controls = base;
+    controls.controlVariates = true;
+    controls.targetStdError = 0.2;
+    checkMatchesFixedRun(controls);
+
+    PricingInputs singlePass = relative;
+    singlePass.greekMethod = GreekMethod::SinglePass;
+    checkMatchesFixedRun(singlePass);
+
+    // Stops at whatever count the clock allows; that count must still
+    // reproduce.
+    PricingInputs budget = base;
+    budget.timeBudgetSeconds = 0.05;
+    checkMatchesFixedRun(budget);
+
+    std::printf("%d failed checks\n", testFailures());
+    return testFailures();
+}
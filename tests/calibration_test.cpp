@@ -0,0 +1,57 @@
+/*
+ * SUMMARY: Round trip of the Heston and Black-Scholes calibrations.
+ * Builds implied vol surfaces from known parameters with hestonImpliedVols()
+ * and checks that calibrateHeston() recovers them, from the default guess and
+ * from a distant one, and that calibrateBlackScholesVol() recovers the vol
+ * of a flat surface.
+ */
+
+#include "Calibration.hpp"
+#include "TestCheck.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+const std::vector<double> kExpiries{0.25, 0.5, 1.0, 2.0, 3.0, 5.0};
+const std::vector<double> kLogMoneyness{-0.5, -0.4, -0.3, -0.2, -0.1,
+                                        0.0,  0.1,  0.2,  0.3,  0.4};
+
+// Fits are exact up to the pricer's accuracy, so the parameters come back to
+// well within this.
+constexpr double kTolerance = 1e-4;
+
+bool close(double a, double b) {
+    return std::abs(a - b) <= kTolerance * std::max(1.0, std::abs(b));
+}
+
+void checkHestonRoundTrip(const HestonParameters& truth, const HestonParameters& guess) {
+    const ImpliedVolSurface surface(kExpiries, kLogMoneyness,
+                                    hestonImpliedVols(truth, kExpiries, kLogMoneyness));
+    const HestonCalibration fit = calibrateHeston(surface, guess);
+    CHECK(fit.rmsVolError < 1e-6);
+    CHECK(close(fit.parameters.v0, truth.v0));
+    CHECK(close(fit.parameters.kappa, truth.kappa));
+    CHECK(close(fit.parameters.theta, truth.theta));
+    CHECK(close(fit.parameters.xi, truth.xi));
+    CHECK(close(fit.parameters.rho, truth.rho));
+    std::printf("v0 %.6f kappa %.6f theta %.6f xi %.6f rho %.6f: rms %.2e in %zu iterations\n",
+                fit.parameters.v0, fit.parameters.kappa, fit.parameters.theta,
+                fit.parameters.xi, fit.parameters.rho, fit.rmsVolError, fit.iterations);
+}
+} // namespace
+
+int main() {
+    checkHestonRoundTrip({0.03, 2.0, 0.05, 0.6, -0.7}, {});
+    checkHestonRoundTrip({0.06, 0.8, 0.03, 0.4, -0.3}, {0.02, 3.0, 0.06, 0.9, 0.2});
+
+    const double sigma = 0.23;
+    const std::vector<double> flatVols(kExpiries.size() * kLogMoneyness.size(), sigma);
+    const ImpliedVolSurface flat(kExpiries, kLogMoneyness, flatVols);
+    CHECK(close(calibrateBlackScholesVol(flat), sigma));
+
+    std::printf("%d failed checks\n", testFailures());
+    return testFailures();
+}
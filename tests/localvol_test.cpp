@@ -0,0 +1,46 @@
+/*
+ * SUMMARY: Arbitrage checks of the local-vol calibration.
+ * A smile with a negative strike density (butterfly arbitrage) must be
+ * rejected by LocalVolMC::calibrate() instead of being clamped to the largest
+ * local vol; skewed and Heston-generated surfaces must calibrate.
+ */
+
+#include "Calibration.hpp"
+#include "LocalVolMC.hpp"
+#include "TestCheck.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+bool calibrates(const ImpliedVolSurface& surface) {
+    try {
+        LocalVolMC::calibrate(surface);
+        return true;
+    } catch (const std::invalid_argument& error) {
+        std::printf("%s\n", error.what());
+        return false;
+    }
+}
+} // namespace
+
+int main() {
+    CHECK(calibrates(ImpliedVolSurface(0.2)));
+    CHECK(calibrates(ImpliedVolSurface(
+        {0.5, 1.0}, {-0.4, -0.2, 0.0, 0.2, 0.4},
+        {0.28, 0.24, 0.20, 0.18, 0.17, 0.27, 0.235, 0.20, 0.185, 0.175})));
+
+    const std::vector<double> expiries{0.25, 0.5, 1.0, 2.0, 3.0, 5.0};
+    const std::vector<double> logMoneyness{-0.5, -0.4, -0.3, -0.2, -0.1,
+                                           0.0,  0.1,  0.2,  0.3,  0.4};
+    const HestonParameters steepSkew{0.04, 1.0, 0.06, 1.0, -0.9};
+    CHECK(calibrates(ImpliedVolSurface(expiries, logMoneyness,
+                                       hestonImpliedVols(steepSkew, expiries, logMoneyness))));
+
+    // A vol spike at the money makes call prices concave in strike there.
+    CHECK(!calibrates(ImpliedVolSurface({1.0}, {-0.1, 0.0, 0.1}, {0.2, 0.6, 0.2})));
+
+    std::printf("%d failed checks\n", testFailures());
+    return testFailures();
+}
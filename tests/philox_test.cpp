@@ -0,0 +1,95 @@
+/*
+ * SUMMARY: Known-answer test of the Philox4x32-10 generator.
+ * Checks philoxWords() against the Random123 Philox4x32-10 vectors in every
+ * vector lane and in the scalar tail, then checks that fillPhiloxNormals()
+ * and gatherPhiloxNormals() map those words to normals as documented. The
+ * SIMD flavour under test is the one activeSimdLevel() picks; ctest runs the
+ * test once per PRICER_SIMD level.
+ */
+
+#include "SimdMath.hpp"
+#include "TestCheck.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+struct KnownAnswer {
+    std::uint64_t counter; // Input words 0 (low) and 1 (high).
+    std::uint64_t stream;  // Input words 2 (low) and 3 (high).
+    std::uint32_t key[2];
+    std::uint32_t output[4];
+};
+
+// Random123 kat_vectors, philox4x32 with 10 rounds.
+const KnownAnswer kKnownAnswers[] = {
+    {0x0000000000000000ull, 0x0000000000000000ull, {0x00000000u, 0x00000000u},
+     {0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u}},
+    {0xffffffffffffffffull, 0xffffffffffffffffull, {0xffffffffu, 0xffffffffu},
+     {0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu}},
+    {0x85a308d3243f6a88ull, 0x0370734413198a2eull, {0xa4093822u, 0x299f31d0u},
+     {0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}},
+};
+
+// Two full AVX-512 passes (four AVX2 ones) and a scalar tail of five.
+constexpr std::size_t kLanes = 37;
+
+// The documented map from two output words to a uniform in (0, 1).
+double uniformFromWords(std::uint32_t high, std::uint32_t low) {
+    return ((high >> 5) * 67108864.0 + (low >> 6) + 0.5) / 9007199254740992.0;
+}
+
+void checkKnownAnswers() {
+    for (const KnownAnswer& answer : kKnownAnswers) {
+        const PhiloxStream stream{{answer.key[0], answer.key[1]}, answer.stream};
+        const std::vector<std::uint64_t> counters(kLanes, answer.counter);
+        std::vector<std::uint32_t> words(4 * kLanes);
+        philoxWords(stream, counters.data(), kLanes, words.data());
+        for (std::size_t i = 0; i < kLanes; ++i) {
+            for (std::size_t j = 0; j < 4; ++j) {
+                CHECK(words[j * kLanes + i] == answer.output[j]);
+            }
+        }
+    }
+}
+
+void checkNormals() {
+    const PhiloxStream stream{{0x12345678u, 0x9abcdef0u}, 42};
+    std::vector<std::uint64_t> counters(kLanes);
+    for (std::size_t i = 0; i < kLanes; ++i) counters[i] = 1000 + i;
+    std::vector<std::uint32_t> words(4 * kLanes);
+    philoxWords(stream, counters.data(), kLanes, words.data());
+
+    // Counter c holds normals 2c (words 0, 1) and 2c + 1 (words 2, 3).
+    std::vector<double> expected(2 * kLanes);
+    for (std::size_t i = 0; i < kLanes; ++i) {
+        expected[2 * i] = uniformFromWords(words[i], words[kLanes + i]);
+        expected[2 * i + 1] = uniformFromWords(words[2 * kLanes + i], words[3 * kLanes + i]);
+    }
+    inverseNormal(expected.data(), expected.data(), expected.size());
+
+    std::vector<double> z(2 * kLanes);
+    fillPhiloxNormals(stream, 2000, z.data(), z.size());
+    CHECK(z == expected);
+
+    // An odd start skips the first half of its counter.
+    fillPhiloxNormals(stream, 2001, z.data(), z.size() - 1);
+    CHECK(std::vector<double>(z.begin(), z.end() - 1) ==
+          std::vector<double>(expected.begin() + 1, expected.end()));
+
+    std::vector<std::uint64_t> positions;
+    for (std::size_t k = expected.size(); k-- > 0;) positions.push_back(2000 + k);
+    gatherPhiloxNormals(stream, positions.data(), z.data(), positions.size());
+    for (std::size_t k = 0; k < positions.size(); ++k) {
+        CHECK(z[k] == expected[positions[k] - 2000]);
+    }
+}
+} // namespace
+
+int main() {
+    std::printf("SIMD level: %s\n", simdLevelName(activeSimdLevel()));
+    checkKnownAnswers();
+    checkNormals();
+    return testFailures();
+}